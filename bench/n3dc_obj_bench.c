@@ -0,0 +1,449 @@
+/******************************************************************************
+ * Copyright 2024 Hayden Donnelly
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ******************************************************************************/
+
+/******************************************************************************
+ * Name: n3dc_obj_bench
+ *
+ * Description: Benchmarks n3dc_obj loads on synthetic OBJ files.
+ *
+ * How-To-Use: Build with `make` in this directory (or compile this file with -O2 -pthread and
+ * -I../libs), then run ./n3dc_obj_bench. Each OBJ file is generated once per size and variant,
+ * written to --dir, and loaded with every mode --repeats times, keeping the fastest run.
+ * ```
+ * ./n3dc_obj_bench --sizes 10000,100000,1000000 --threads 4 --repeats 3 --dir /tmp
+ * ```
+ * The plain variant only has v, vt, vn, and f lines. The annotated variant adds a comment every
+ * 16 lines and a g and usemtl line every 1024 faces, which exercises the line skipping.
+ *
+ * Every result is printed as one JSON object per line on stdout so that runs can be diffed or
+ * compared by a script, e.g. to flag regressions in mb_per_s. Progress and errors go to stderr.
+ * peak_rss_kb is the resident set high-water mark during the load on Linux (it's reset before
+ * every load), and the process lifetime high-water mark elsewhere. allocations and
+ * allocated_bytes count the calls to, and bytes requested from, the load's allocator. The
+ * *_seconds phase timings and peak_scratch_bytes come from the fastest run's n3dc_obj_stats_t.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N3DC_OBJ_IMPLEMENTATION
+#define N3DC_OBJ_ENABLE_STATS
+#include "n3dc_obj.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+typedef enum
+{
+    N3DC_OBJ_BENCH_MEMORY_SERIAL = 0,
+    N3DC_OBJ_BENCH_FILE_SERIAL,
+    N3DC_OBJ_BENCH_MEMORY_PARALLEL,
+    N3DC_OBJ_BENCH_FILE_PARALLEL,
+    N3DC_OBJ_BENCH_MEMORY_INDEXED,
+    N3DC_OBJ_BENCH_MEMORY_COUNT_FIRST,
+    N3DC_OBJ_BENCH_STREAM,
+    N3DC_OBJ_BENCH_MEMORY_POSITIONS,
+    N3DC_OBJ_BENCH_MEMORY_BVH,
+    N3DC_OBJ_BENCH_NUM_MODES
+} n3dc_obj_bench_mode_t;
+
+static const char* n3dc_obj_bench_mode_names[N3DC_OBJ_BENCH_NUM_MODES] = {
+    "memory_serial", "file_serial", "memory_parallel", "file_parallel",
+    "memory_indexed", "memory_count_first", "stream", "memory_positions",
+    "memory_bvh"
+};
+
+// A generated OBJ file and the counts needed to load it with exact maximums.
+typedef struct
+{
+    char* chars;
+    size_t length;
+    size_t capacity;
+    n3dc_obj_counts_t counts;
+    unsigned long long num_faces;
+} n3dc_obj_bench_file_t;
+
+// Counts what a load asks of its allocator. Only the calling thread allocates in the modes that
+// are benchmarked, so the counters aren't synchronized.
+typedef struct
+{
+    unsigned long long allocations;
+    unsigned long long allocated_bytes;
+} n3dc_obj_bench_allocator_stats_t;
+
+static void* n3dc_obj_bench_allocate(size_t size, void* user_data)
+{
+    n3dc_obj_bench_allocator_stats_t* stats = (n3dc_obj_bench_allocator_stats_t*)user_data;
+    stats->allocations++;
+    stats->allocated_bytes += size;
+    return malloc(size);
+}
+
+static void* n3dc_obj_bench_reallocate(void* ptr, size_t old_size, size_t new_size, void* user_data)
+{
+    n3dc_obj_bench_allocator_stats_t* stats = (n3dc_obj_bench_allocator_stats_t*)user_data;
+    stats->allocations++;
+    if(new_size > old_size) { stats->allocated_bytes += new_size - old_size; }
+    return realloc(ptr, new_size);
+}
+
+static void n3dc_obj_bench_deallocate(void* ptr, void* user_data)
+{
+    (void)user_data;
+    free(ptr);
+}
+
+static double n3dc_obj_bench_get_seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
+
+// Resets the resident set high-water mark where the OS allows it, so that the next reading only
+// covers the load that follows.
+static void n3dc_obj_bench_reset_peak_rss(void)
+{
+#if defined(__linux__)
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if(!fp) { return; }
+    fputs("5", fp);
+    fclose(fp);
+#endif
+}
+
+static unsigned long long n3dc_obj_bench_get_peak_rss_kb(void)
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+    return (unsigned long long)counters.PeakWorkingSetSize / 1024;
+#else
+#if defined(__linux__)
+    FILE* fp = fopen("/proc/self/status", "r");
+    if(fp)
+    {
+        char line[256];
+        unsigned long long peak_kb = 0;
+        while(fgets(line, sizeof(line), fp))
+        {
+            if(!strncmp(line, "VmHWM:", 6)) { peak_kb = strtoull(&line[6], NULL, 10); }
+        }
+        fclose(fp);
+        if(peak_kb > 0) { return peak_kb; }
+    }
+#endif
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)) { return 0; }
+#if defined(__APPLE__)
+    // macOS reports bytes instead of kilobytes.
+    return (unsigned long long)usage.ru_maxrss / 1024;
+#else
+    return (unsigned long long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static int n3dc_obj_bench_append(n3dc_obj_bench_file_t* file, const char* chars, const size_t length)
+{
+    if(file->length + length > file->capacity)
+    {
+        size_t new_capacity = file->capacity > 0 ? file->capacity * 2 : 1 << 20;
+        while(new_capacity < file->length + length) { new_capacity *= 2; }
+        char* new_chars = (char*)realloc(file->chars, new_capacity);
+        if(!new_chars) { return -1; }
+        file->chars = new_chars;
+        file->capacity = new_capacity;
+    }
+    memcpy(&file->chars[file->length], chars, length);
+    file->length += length;
+    return 0;
+}
+
+// Generates a grid of quads split into num_faces triangles. Every grid point has a vertex,
+// texture coord, and normal, and every face corner uses all three.
+static int n3dc_obj_bench_generate(
+    const unsigned long long num_faces, const int is_annotated, n3dc_obj_bench_file_t* file
+){
+    memset(file, 0, sizeof(n3dc_obj_bench_file_t));
+    unsigned long long columns = 1;
+    while(columns * columns * 2 < num_faces) { columns++; }
+    const unsigned long long rows = (num_faces / 2 + columns - 1) / columns;
+    const unsigned long long num_points = (rows + 1) * (columns + 1);
+    if(num_points > 0xFFFFFFF0ull || num_faces * 3 > 0xFFFFFFF0ull)
+    {
+        fprintf(stderr, "%llu faces is too many for 32-bit indices\n", num_faces);
+        return -1;
+    }
+    char line[256];
+    unsigned long long num_lines = 0;
+    int error = 0;
+    for(unsigned long long i = 0; i < num_points && !error; i++)
+    {
+        const unsigned long long x = i % (columns + 1);
+        const unsigned long long y = i / (columns + 1);
+        const int length = sprintf(
+            line, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0.000000 0.000000 1.000000\n",
+            (double)x * 0.01, (double)y * 0.01, (double)((x * 7 + y * 13) % 17) * 0.001,
+            (double)x / (double)columns, (double)y / (double)rows
+        );
+        error = n3dc_obj_bench_append(file, line, (size_t)length);
+        num_lines += 3;
+        if(is_annotated && num_lines % 16 < 3 && !error)
+        {
+            error = n3dc_obj_bench_append(file, "# generated by n3dc_obj_bench\n", 30);
+        }
+    }
+    for(unsigned long long i = 0; i < num_faces && !error; i++)
+    {
+        if(is_annotated && i % 1024 == 0)
+        {
+            const int length = sprintf(line, "g group_%llu\nusemtl material_%llu\n", i / 1024, (i / 1024) % 8);
+            error = n3dc_obj_bench_append(file, line, (size_t)length);
+        }
+        const unsigned long long quad = i / 2;
+        const unsigned long long x = quad % columns;
+        const unsigned long long y = quad / columns;
+        const unsigned long long a = y * (columns + 1) + x + 1;
+        const unsigned long long b = a + 1;
+        const unsigned long long c = a + columns + 2;
+        const unsigned long long d = a + columns + 1;
+        const int length = (i % 2 == 0)
+            ? sprintf(line, "f %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\n", a, a, a, b, b, b, c, c, c)
+            : sprintf(line, "f %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\n", a, a, a, c, c, c, d, d, d);
+        if(!error) { error = n3dc_obj_bench_append(file, line, (size_t)length); }
+        num_lines++;
+        if(is_annotated && num_lines % 16 == 0 && !error)
+        {
+            error = n3dc_obj_bench_append(file, "# generated by n3dc_obj_bench\n", 30);
+        }
+    }
+    if(error)
+    {
+        fprintf(stderr, "Could not allocate memory for a %llu face OBJ file\n", num_faces);
+        free(file->chars);
+        return -1;
+    }
+    file->counts.num_vertices = (unsigned int)num_points;
+    file->counts.num_texture_coords = (unsigned int)num_points;
+    file->counts.num_normals = (unsigned int)num_points;
+    file->counts.num_indices = (unsigned int)(num_faces * 3);
+    file->num_faces = num_faces;
+    return 0;
+}
+
+static n3dc_obj_t* n3dc_obj_bench_load(
+    const n3dc_obj_bench_mode_t mode, const n3dc_obj_bench_file_t* file, const char* path,
+    const unsigned int num_threads, n3dc_obj_load_options_t* options
+){
+    const n3dc_obj_counts_t* counts = &file->counts;
+    switch(mode)
+    {
+        case N3DC_OBJ_BENCH_FILE_PARALLEL: options->num_threads = num_threads; // fall through
+        case N3DC_OBJ_BENCH_FILE_SERIAL:
+            return n3dc_obj_load_with_options(
+                path, counts->num_vertices, counts->num_normals, counts->num_indices, options
+            );
+        case N3DC_OBJ_BENCH_MEMORY_PARALLEL: options->num_threads = num_threads; break;
+        case N3DC_OBJ_BENCH_MEMORY_INDEXED: options->output_mode = N3DC_OBJ_OUTPUT_INDEXED; break;
+        case N3DC_OBJ_BENCH_MEMORY_COUNT_FIRST: options->count_first = 1; break;
+        case N3DC_OBJ_BENCH_MEMORY_POSITIONS:
+            options->skip_attributes = N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS | N3DC_OBJ_ATTRIBUTE_NORMALS;
+            break;
+        case N3DC_OBJ_BENCH_MEMORY_BVH:
+            options->output_mode = N3DC_OBJ_OUTPUT_INDEXED;
+            options->build_bvh = 1;
+            options->num_threads = num_threads;
+            break;
+        case N3DC_OBJ_BENCH_STREAM:
+        {
+            n3dc_obj_stream_t* stream = n3dc_obj_stream_begin(
+                counts->num_vertices, counts->num_normals, counts->num_indices, options
+            );
+            if(!stream) { return NULL; }
+            // Feed the file in pieces the size of a typical socket or decompressor buffer.
+            const size_t piece_length = 64 * 1024;
+            for(size_t offset = 0; offset < file->length; offset += piece_length)
+            {
+                const size_t remaining = file->length - offset;
+                n3dc_obj_stream_feed(stream, &file->chars[offset], remaining < piece_length ? remaining : piece_length);
+            }
+            return n3dc_obj_stream_end(stream);
+        }
+        default: break;
+    }
+    return n3dc_obj_load_from_memory_with_options(
+        file->chars, file->length, counts->num_vertices, counts->num_normals, counts->num_indices, options
+    );
+}
+
+static int n3dc_obj_bench_run(
+    const n3dc_obj_bench_file_t* file, const char* path, const char* variant,
+    const unsigned int num_threads, const unsigned int num_repeats
+){
+    int error = 0;
+    for(unsigned int mode = 0; mode < N3DC_OBJ_BENCH_NUM_MODES; mode++)
+    {
+        double best_seconds = 0.0;
+        unsigned long long peak_rss_kb = 0;
+        n3dc_obj_bench_allocator_stats_t stats = {0, 0};
+        n3dc_obj_stats_t load_stats;
+        memset(&load_stats, 0, sizeof(n3dc_obj_stats_t));
+        for(unsigned int i = 0; i < num_repeats; i++)
+        {
+            n3dc_obj_bench_allocator_stats_t run_stats = {0, 0};
+            n3dc_obj_allocator_t allocator = {
+                n3dc_obj_bench_allocate, n3dc_obj_bench_reallocate, n3dc_obj_bench_deallocate, &run_stats
+            };
+            n3dc_obj_load_options_t options;
+            memset(&options, 0, sizeof(n3dc_obj_load_options_t));
+            options.allocator = &allocator;
+            n3dc_obj_stats_t run_load_stats;
+            options.stats = &run_load_stats;
+            n3dc_obj_error_t load_error;
+            options.error = &load_error;
+
+            n3dc_obj_bench_reset_peak_rss();
+            const double start = n3dc_obj_bench_get_seconds();
+            n3dc_obj_t* obj = n3dc_obj_bench_load((n3dc_obj_bench_mode_t)mode, file, path, num_threads, &options);
+            const double seconds = n3dc_obj_bench_get_seconds() - start;
+            const unsigned long long run_peak_rss_kb = n3dc_obj_bench_get_peak_rss_kb();
+            if(!obj)
+            {
+                fprintf(
+                    stderr, "%s load of %s failed: %s (line %llu)\n", n3dc_obj_bench_mode_names[mode], path,
+                    n3dc_obj_get_error_message(load_error.code), (unsigned long long)load_error.line
+                );
+                error = -1;
+                break;
+            }
+            n3dc_obj_free(obj);
+            if(i == 0 || seconds < best_seconds)
+            {
+                best_seconds = seconds;
+                load_stats = run_load_stats;
+            }
+            if(run_peak_rss_kb > peak_rss_kb) { peak_rss_kb = run_peak_rss_kb; }
+            stats = run_stats;
+        }
+        if(error) { continue; }
+        const double mb_per_s = best_seconds > 0.0 ? (double)file->length / best_seconds / 1e6 : 0.0;
+        const double faces_per_s = best_seconds > 0.0 ? (double)file->num_faces / best_seconds : 0.0;
+        printf(
+            "{\"bench\":\"n3dc_obj_load\",\"version\":\"%d.%d.%d\",\"mode\":\"%s\",\"variant\":\"%s\","
+            "\"faces\":%llu,\"bytes\":%llu,\"threads\":%u,\"repeats\":%u,\"seconds\":%.6f,"
+            "\"mb_per_s\":%.2f,\"faces_per_s\":%.0f,\"peak_rss_kb\":%llu,"
+            "\"allocations\":%llu,\"allocated_bytes\":%llu,\"read_seconds\":%.6f,\"scan_seconds\":%.6f,"
+            "\"parse_seconds\":%.6f,\"reorder_seconds\":%.6f,\"peak_scratch_bytes\":%llu}\n",
+            N3DC_OBJ_VERSION_MAJOR, N3DC_OBJ_VERSION_MINOR, N3DC_OBJ_VERSION_PATCH,
+            n3dc_obj_bench_mode_names[mode], variant, file->num_faces, (unsigned long long)file->length,
+            num_threads, num_repeats, best_seconds, mb_per_s, faces_per_s, peak_rss_kb,
+            stats.allocations, stats.allocated_bytes, load_stats.read_seconds, load_stats.scan_seconds,
+            load_stats.parse_seconds, load_stats.reorder_seconds, (unsigned long long)load_stats.peak_scratch_bytes
+        );
+        fflush(stdout);
+    }
+    return error;
+}
+
+static void n3dc_obj_bench_print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--sizes N,N,...] [--threads N] [--repeats N] [--dir PATH]\n"
+        "  --sizes    Face counts to generate (default 10000,100000,1000000)\n"
+        "  --threads  Threads for the parallel modes (default 4)\n"
+        "  --repeats  Loads per mode, the fastest is reported (default 3)\n"
+        "  --dir      Directory for the generated OBJ files (default .)\n",
+        program
+    );
+}
+
+int main(int argc, char** argv)
+{
+    const char* sizes = "10000,100000,1000000";
+    const char* dir = ".";
+    unsigned int num_threads = 4;
+    unsigned int num_repeats = 3;
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 < argc && !strcmp(argv[i], "--sizes")) { sizes = argv[++i]; }
+        else if(i + 1 < argc && !strcmp(argv[i], "--threads")) { num_threads = (unsigned int)strtoul(argv[++i], NULL, 10); }
+        else if(i + 1 < argc && !strcmp(argv[i], "--repeats")) { num_repeats = (unsigned int)strtoul(argv[++i], NULL, 10); }
+        else if(i + 1 < argc && !strcmp(argv[i], "--dir")) { dir = argv[++i]; }
+        else
+        {
+            n3dc_obj_bench_print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(num_repeats == 0) { num_repeats = 1; }
+
+    int error = 0;
+    const char* size = sizes;
+    while(*size)
+    {
+        char* size_end = NULL;
+        const unsigned long long num_faces = strtoull(size, &size_end, 10);
+        if(size_end == size)
+        {
+            n3dc_obj_bench_print_usage(argv[0]);
+            return 1;
+        }
+        size = (*size_end == ',') ? size_end + 1 : size_end;
+        for(int is_annotated = 0; is_annotated < 2; is_annotated++)
+        {
+            const char* variant = is_annotated ? "annotated" : "plain";
+            fprintf(stderr, "Generating %llu face %s OBJ file\n", num_faces, variant);
+            n3dc_obj_bench_file_t file;
+            if(n3dc_obj_bench_generate(num_faces, is_annotated, &file))
+            {
+                error = -1;
+                continue;
+            }
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/n3dc_obj_bench_%llu_%s.obj", dir, num_faces, variant);
+            FILE* fp = fopen(path, "wb");
+            if(!fp || fwrite(file.chars, 1, file.length, fp) != file.length)
+            {
+                fprintf(stderr, "Could not write %s\n", path);
+                if(fp) { fclose(fp); }
+                free(file.chars);
+                error = -1;
+                continue;
+            }
+            fclose(fp);
+            if(n3dc_obj_bench_run(&file, path, variant, num_threads, num_repeats)) { error = -1; }
+            remove(path);
+            free(file.chars);
+        }
+    }
+    return error ? 1 : 0;
+}
@@ -0,0 +1,1311 @@
+/******************************************************************************
+ * Copyright 2024 Hayden Donnelly
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ******************************************************************************/
+
+/******************************************************************************
+ * Name: n3dc_obj_diff
+ *
+ * Description: Differential tester and fuzz target for n3dc_obj loads. Every input is loaded
+ * with each output configuration (deindexed, indexed, interleaved, submeshes, BVH, etc.) by a
+ * serial n3dc_obj_load_with_options, the reference, and then by every other way of loading the
+ * same data: from memory, with count_first, on 2 to 8 threads, streamed in pieces of 1 to 4096
+ * bytes, with a scratch arena, asynchronously, as the first frame of a sequence, in a batch, and
+ * through a cache file. Each load's arrays, submeshes, materials, LODs, and BVH must match the
+ * reference's bit for bit, and a load that fails must fail with the same error code, line, and
+ * offset. With load_materials, loads from memory resolve mtllib names against the current
+ * directory, so they're compared against a serial load from memory instead. The serial loads
+ * also go through an allocator that checks nothing leaks, and are repeated with single
+ * allocation failures, which must fail cleanly with N3DC_OBJ_ERROR_OUT_OF_MEMORY (or still
+ * match). Parse chunks and output tasks are shrunk to a few bytes and triangles so that
+ * small inputs take the threaded paths too. The maximums are the input's exact counts, and then
+ * each is halved in turn for a few configurations, where every load but those that count first
+ * must fail at the same place.
+ *
+ * How-To-Use: Build with `make diff` in this directory, which runs the tester on generated OBJ
+ * files with and without SIMD and memory mapping and compares the reference hashes of the two
+ * builds. Pass OBJ files to test them instead, or --cases and --seed to change the generated
+ * ones. Generated inputs cover n-gons, negative, partial, and out of range indices, comments, CRLF
+ * line endings, subnormal and out of range numbers, and a few corrupted bytes. Each one is written with an MTL
+ * file to a directory of its own under --dir, so that every way of loading from the file has to
+ * find the materials next to the OBJ file. A separate check compares the float scanner with
+ * strtof (bit for bit up to 15 significant digits, within 1 ulp past that or when the nearest
+ * double is halfway between two floats). Build with
+ * CFLAGS="-O1 -g -fsanitize=address,undefined" to catch out of bounds reads that still match.
+ * ```
+ * ./n3dc_obj_diff --cases 500 --seed 7 --dir /tmp
+ * ./n3dc_obj_diff scene.obj other.obj
+ * ```
+ * Mismatches are printed to stderr and make the tester exit with 1. --hashes prints one line per
+ * input and configuration with a hash of the reference load on stdout.
+ *
+ * `make fuzz` builds n3dc_obj_fuzz, a libFuzzer target (define N3DC_OBJ_DIFF_FUZZER) that uses
+ * the first byte of each input to pick a configuration and the rest as the OBJ data, and aborts
+ * on any mismatch. It runs the in-memory loads without materials only, so it doesn't touch the
+ * file system. Build
+ * it for AFL++ with `make fuzz FUZZ_CC=afl-clang-fast`. Inputs it finds can be replayed
+ * without libFuzzer with `./n3dc_obj_diff --fuzz-input crash-...`.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Small enough that a few kilobytes of OBJ data are split between every thread.
+#ifndef N3DC_OBJ_MIN_CHUNK_LENGTH
+#define N3DC_OBJ_MIN_CHUNK_LENGTH 64
+#endif
+#ifndef N3DC_OBJ_MIN_TASK_SIZE
+#define N3DC_OBJ_MIN_TASK_SIZE 4
+#endif
+#define N3DC_OBJ_IMPLEMENTATION
+#include "n3dc_obj.h"
+
+// Output settings that each input is loaded with. Every way of loading is compared against the
+// reference load with the same configuration.
+typedef struct
+{
+    const char* name;
+    n3dc_obj_output_mode_t output_mode;
+    int optimize_vertex_cache;
+    n3dc_obj_normal_mode_t normal_mode;
+    int record_submeshes;
+    const n3dc_obj_vertex_layout_t* vertex_layout;
+    unsigned int skip_attributes;
+    int build_bvh;
+    unsigned int num_lods;
+    int load_materials;
+} n3dc_obj_diff_config_t;
+
+static const n3dc_obj_vertex_layout_t n3dc_obj_diff_float_layout = {
+    32, 0, 12, 24, N3DC_OBJ_FORMAT_FLOAT32, N3DC_OBJ_FORMAT_FLOAT32, N3DC_OBJ_FORMAT_FLOAT32
+};
+static const n3dc_obj_vertex_layout_t n3dc_obj_diff_quantized_layout = {
+    12, 0, 6, 8, N3DC_OBJ_FORMAT_FLOAT16, N3DC_OBJ_FORMAT_OCT_SNORM8, N3DC_OBJ_FORMAT_UNORM16
+};
+static const float n3dc_obj_diff_lod_ratios[2] = {0.5f, 0.25f};
+
+static const n3dc_obj_diff_config_t n3dc_obj_diff_configs[] = {
+    {"deindexed", N3DC_OBJ_OUTPUT_DEINDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 0, NULL, 0, 0, 0, 0},
+    {"indexed", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 0, NULL, 0, 0, 0, 0},
+    {"vertex_cache", N3DC_OBJ_OUTPUT_INDEXED, 1, N3DC_OBJ_NORMALS_FROM_FILE, 0, NULL, 0, 0, 0, 0},
+    {"smooth_normals", N3DC_OBJ_OUTPUT_DEINDEXED, 0, N3DC_OBJ_NORMALS_SMOOTH, 0, NULL, 0, 0, 0, 0},
+    {"flat_normals", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_FLAT, 0, NULL, 0, 0, 0, 0},
+    {"submeshes", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 1, NULL, 0, 0, 0, 0},
+    {"interleaved", N3DC_OBJ_OUTPUT_DEINDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 0, &n3dc_obj_diff_float_layout, 0, 0, 0, 0},
+    {"quantized", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_SMOOTH, 0, &n3dc_obj_diff_quantized_layout, 0, 0, 0, 0},
+    {
+        "positions_only", N3DC_OBJ_OUTPUT_DEINDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 1, NULL,
+        N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS | N3DC_OBJ_ATTRIBUTE_NORMALS, 0, 0, 0
+    },
+    {"bvh", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 0, NULL, 0, 1, 0, 0},
+    {"lods", N3DC_OBJ_OUTPUT_INDEXED, 1, N3DC_OBJ_NORMALS_FROM_FILE, 0, NULL, 0, 0, 2, 0},
+    // Reads MTL files, so it has to stay last: the fuzz target leaves it out.
+    {"materials", N3DC_OBJ_OUTPUT_INDEXED, 0, N3DC_OBJ_NORMALS_FROM_FILE, 1, NULL, 0, 0, 0, 1}
+};
+
+#define N3DC_OBJ_DIFF_NUM_CONFIGS (sizeof(n3dc_obj_diff_configs) / sizeof(n3dc_obj_diff_configs[0]))
+// The configurations that don't touch the file system, which fuzz inputs are loaded with.
+#define N3DC_OBJ_DIFF_NUM_FUZZ_CONFIGS (N3DC_OBJ_DIFF_NUM_CONFIGS - 1)
+
+typedef enum
+{
+    N3DC_OBJ_DIFF_MEMORY = 0,
+    N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST,
+    N3DC_OBJ_DIFF_STREAM,
+    N3DC_OBJ_DIFF_ARENA,
+    N3DC_OBJ_DIFF_ASYNC_MEMORY,
+    N3DC_OBJ_DIFF_SEQUENCE_MEMORY,
+    // The kinds from here on load from the input's file, so they're skipped for inputs that only
+    // exist in memory.
+    N3DC_OBJ_DIFF_FILE,
+    N3DC_OBJ_DIFF_ASYNC_FILE,
+    N3DC_OBJ_DIFF_BATCH,
+    N3DC_OBJ_DIFF_CACHED,
+    N3DC_OBJ_DIFF_SEQUENCE_FILE
+} n3dc_obj_diff_kind_t;
+
+// A way of loading an input. param is the number of threads, except for streams, where it's
+// the length of the pieces fed to the stream, and arenas, where it's the arena's size.
+typedef struct
+{
+    const char* name;
+    n3dc_obj_diff_kind_t kind;
+    unsigned int param;
+    // Set for loads that only allocate on the calling thread, which go through the checking
+    // allocator.
+    int is_serial;
+} n3dc_obj_diff_variant_t;
+
+static const n3dc_obj_diff_variant_t n3dc_obj_diff_variants[] = {
+    {"memory", N3DC_OBJ_DIFF_MEMORY, 0, 1},
+    {"count_first", N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST, 0, 1},
+    {"threads_2", N3DC_OBJ_DIFF_MEMORY, 2, 0},
+    {"threads_3", N3DC_OBJ_DIFF_MEMORY, 3, 0},
+    {"threads_8", N3DC_OBJ_DIFF_MEMORY, 8, 0},
+    {"threads_4_count_first", N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST, 4, 0},
+    {"stream_1", N3DC_OBJ_DIFF_STREAM, 1, 1},
+    {"stream_7", N3DC_OBJ_DIFF_STREAM, 7, 1},
+    {"stream_4096", N3DC_OBJ_DIFF_STREAM, 4096, 1},
+    {"arena_256", N3DC_OBJ_DIFF_ARENA, 256, 1},
+    {"arena_1m", N3DC_OBJ_DIFF_ARENA, 1 << 20, 1},
+    {"async", N3DC_OBJ_DIFF_ASYNC_MEMORY, 3, 0},
+    {"sequence", N3DC_OBJ_DIFF_SEQUENCE_MEMORY, 0, 1},
+    {"sequence_threads_3", N3DC_OBJ_DIFF_SEQUENCE_MEMORY, 3, 0},
+    {"file", N3DC_OBJ_DIFF_FILE, 0, 1},
+    {"file_threads_4", N3DC_OBJ_DIFF_FILE, 4, 0},
+    {"async_file", N3DC_OBJ_DIFF_ASYNC_FILE, 0, 0},
+    {"batch", N3DC_OBJ_DIFF_BATCH, 2, 0},
+    {"cached", N3DC_OBJ_DIFF_CACHED, 0, 1},
+    {"sequence_file", N3DC_OBJ_DIFF_SEQUENCE_FILE, 0, 1}
+};
+
+#define N3DC_OBJ_DIFF_NUM_VARIANTS (sizeof(n3dc_obj_diff_variants) / sizeof(n3dc_obj_diff_variants[0]))
+// Most loads that one variant makes: a batch loads its file this many times.
+#define N3DC_OBJ_DIFF_MAX_LOADS 3
+
+// OBJ data to load, and the file it was read from or NULL.
+typedef struct
+{
+    const char* name;
+    const char* chars;
+    size_t length;
+    const char* path;
+    unsigned int max_vertices;
+    unsigned int max_normals;
+    unsigned int max_indices;
+    // Set when a maximum is smaller than the input's count, so that only loads that count first
+    // can succeed.
+    int is_too_small;
+} n3dc_obj_diff_input_t;
+
+// A finished load. sequence is set when obj belongs to a sequence, and frame_differs when the
+// sequence gave different positions for a frame with the same data as the first.
+typedef struct
+{
+    n3dc_obj_t* obj;
+    n3dc_obj_error_t error;
+    n3dc_obj_sequence_t* sequence;
+    int frame_differs;
+} n3dc_obj_diff_load_t;
+
+// Counts the allocations still alive, and fails the fail_at-th allocation if it's non-zero.
+typedef struct
+{
+    unsigned long long allocations;
+    unsigned long long fail_at;
+    long long live_allocations;
+} n3dc_obj_diff_allocator_stats_t;
+
+static void* n3dc_obj_diff_allocate(size_t size, void* user_data)
+{
+    n3dc_obj_diff_allocator_stats_t* stats = (n3dc_obj_diff_allocator_stats_t*)user_data;
+    if(++stats->allocations == stats->fail_at) { return NULL; }
+    void* ptr = malloc(size > 0 ? size : 1);
+    if(ptr) { stats->live_allocations++; }
+    return ptr;
+}
+
+static void* n3dc_obj_diff_reallocate(void* ptr, size_t old_size, size_t new_size, void* user_data)
+{
+    (void)old_size;
+    n3dc_obj_diff_allocator_stats_t* stats = (n3dc_obj_diff_allocator_stats_t*)user_data;
+    if(++stats->allocations == stats->fail_at) { return NULL; }
+    void* new_ptr = realloc(ptr, new_size > 0 ? new_size : 1);
+    if(new_ptr && !ptr) { stats->live_allocations++; }
+    return new_ptr;
+}
+
+static void n3dc_obj_diff_deallocate(void* ptr, void* user_data)
+{
+    n3dc_obj_diff_allocator_stats_t* stats = (n3dc_obj_diff_allocator_stats_t*)user_data;
+    if(ptr) { stats->live_allocations--; }
+    free(ptr);
+}
+
+static void n3dc_obj_diff_set_options(
+    const n3dc_obj_diff_config_t* config, n3dc_obj_error_t* error, n3dc_obj_load_options_t* options
+){
+    memset(options, 0, sizeof(n3dc_obj_load_options_t));
+    options->output_mode = config->output_mode;
+    options->optimize_vertex_cache = config->optimize_vertex_cache;
+    options->normal_mode = config->normal_mode;
+    options->record_submeshes = config->record_submeshes;
+    options->vertex_layout = config->vertex_layout;
+    options->skip_attributes = config->skip_attributes;
+    options->build_bvh = config->build_bvh;
+    options->num_lods = config->num_lods;
+    options->lod_ratios = config->num_lods > 0 ? n3dc_obj_diff_lod_ratios : NULL;
+    options->load_materials = config->load_materials;
+    options->error = error;
+}
+
+// Loads the input's first frame into a sequence, then loads the same data as a frame and checks
+// that it gives the first frame's positions.
+static void n3dc_obj_diff_load_sequence(
+    const n3dc_obj_diff_input_t* input, const int from_file, const n3dc_obj_load_options_t* options,
+    n3dc_obj_diff_load_t* load
+){
+    load->sequence = from_file
+        ? n3dc_obj_sequence_begin(input->path, input->max_vertices, input->max_normals, input->max_indices, options)
+        : n3dc_obj_sequence_begin_from_memory(
+            input->chars, input->length, input->max_vertices, input->max_normals, input->max_indices, options
+        );
+    if(!load->sequence) { return; }
+    load->obj = n3dc_obj_sequence_get_obj(load->sequence);
+    const size_t positions_size = sizeof(float) * 3 * load->obj->num_vertices;
+    float* positions = (float*)malloc(positions_size > 0 ? positions_size : 1);
+    if(!positions)
+    {
+        load->frame_differs = 1;
+        return;
+    }
+    const int error = from_file
+        ? n3dc_obj_sequence_load_frame(load->sequence, input->path, positions)
+        : n3dc_obj_sequence_load_frame_from_memory(load->sequence, input->chars, input->length, positions);
+    load->frame_differs = error || (load->obj->vertices && memcmp(positions, load->obj->vertices, positions_size));
+    free(positions);
+}
+
+// Loads the input the variant's way, into up to N3DC_OBJ_DIFF_MAX_LOADS loads. Returns the number
+// of loads.
+static unsigned int n3dc_obj_diff_load(
+    const n3dc_obj_diff_input_t* input, const n3dc_obj_diff_variant_t* variant,
+    n3dc_obj_load_options_t* options, n3dc_obj_diff_load_t* loads
+){
+    memset(loads, 0, sizeof(n3dc_obj_diff_load_t) * N3DC_OBJ_DIFF_MAX_LOADS);
+    options->error = &loads[0].error;
+    const unsigned int max_vertices = input->max_vertices;
+    const unsigned int max_normals = input->max_normals;
+    const unsigned int max_indices = input->max_indices;
+    switch(variant->kind)
+    {
+        case N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST: options->count_first = 1; // fall through
+        case N3DC_OBJ_DIFF_MEMORY:
+            options->num_threads = variant->param;
+            loads[0].obj = n3dc_obj_load_from_memory_with_options(
+                input->chars, input->length, max_vertices, max_normals, max_indices, options
+            );
+            return 1;
+        case N3DC_OBJ_DIFF_STREAM:
+        {
+            n3dc_obj_stream_t* stream = n3dc_obj_stream_begin(max_vertices, max_normals, max_indices, options);
+            if(!stream) { return 1; }
+            for(size_t offset = 0; offset < input->length; offset += variant->param)
+            {
+                const size_t remaining = input->length - offset;
+                n3dc_obj_stream_feed(stream, &input->chars[offset], remaining < variant->param ? remaining : variant->param);
+            }
+            loads[0].obj = n3dc_obj_stream_end(stream);
+            return 1;
+        }
+        case N3DC_OBJ_DIFF_ARENA:
+        {
+            void* arena = malloc(variant->param);
+            options->scratch_arena = arena;
+            options->scratch_arena_size = arena ? variant->param : 0;
+            loads[0].obj = n3dc_obj_load_from_memory_with_options(
+                input->chars, input->length, max_vertices, max_normals, max_indices, options
+            );
+            free(arena);
+            return 1;
+        }
+        case N3DC_OBJ_DIFF_ASYNC_MEMORY:
+        case N3DC_OBJ_DIFF_ASYNC_FILE:
+        {
+            options->num_threads = variant->param;
+            n3dc_obj_async_t* async = variant->kind == N3DC_OBJ_DIFF_ASYNC_FILE
+                ? n3dc_obj_load_async(input->path, max_vertices, max_normals, max_indices, options, NULL, NULL)
+                : n3dc_obj_load_from_memory_async(
+                    input->chars, input->length, max_vertices, max_normals, max_indices, options, NULL, NULL
+                );
+            if(async) { loads[0].obj = n3dc_obj_async_wait(async); }
+            return 1;
+        }
+        case N3DC_OBJ_DIFF_SEQUENCE_MEMORY:
+        case N3DC_OBJ_DIFF_SEQUENCE_FILE:
+            options->num_threads = variant->param;
+            n3dc_obj_diff_load_sequence(input, variant->kind == N3DC_OBJ_DIFF_SEQUENCE_FILE, options, &loads[0]);
+            return 1;
+        case N3DC_OBJ_DIFF_FILE:
+            options->num_threads = variant->param;
+            loads[0].obj = n3dc_obj_load_with_options(input->path, max_vertices, max_normals, max_indices, options);
+            return 1;
+        case N3DC_OBJ_DIFF_BATCH:
+        {
+            // Every path is the same file, so every obj must match the reference.
+            const char* paths[N3DC_OBJ_DIFF_MAX_LOADS];
+            n3dc_obj_t* objs[N3DC_OBJ_DIFF_MAX_LOADS];
+            for(unsigned int i = 0; i < N3DC_OBJ_DIFF_MAX_LOADS; i++) { paths[i] = input->path; }
+            options->num_threads = variant->param;
+            n3dc_obj_load_batch(paths, N3DC_OBJ_DIFF_MAX_LOADS, max_vertices, max_normals, max_indices, options, objs);
+            for(unsigned int i = 0; i < N3DC_OBJ_DIFF_MAX_LOADS; i++)
+            {
+                loads[i].obj = objs[i];
+                loads[i].error = loads[0].error;
+            }
+            return N3DC_OBJ_DIFF_MAX_LOADS;
+        }
+        case N3DC_OBJ_DIFF_CACHED:
+        {
+            // The first load misses and writes the cache file, the second one loads it.
+            char cache_path[4096];
+            snprintf(cache_path, sizeof(cache_path), "%s.n3dc_obj_diff_cache", input->path);
+            remove(cache_path);
+            for(unsigned int i = 0; i < 2; i++)
+            {
+                options->error = &loads[i].error;
+                loads[i].obj = n3dc_obj_load_cached(input->path, cache_path, max_vertices, max_normals, max_indices, options);
+            }
+            remove(cache_path);
+            return 2;
+        }
+        default: return 0;
+    }
+}
+
+static void n3dc_obj_diff_release(n3dc_obj_diff_load_t* load)
+{
+    if(load->sequence) { n3dc_obj_sequence_end(load->sequence); }
+    else { n3dc_obj_free(load->obj); }
+    load->obj = NULL;
+    load->sequence = NULL;
+}
+
+// The compare functions write what differs to what and return -1 if a and b differ.
+static int n3dc_obj_diff_compare_uint(
+    const unsigned long long a, const unsigned long long b, const char* name, char* what, const size_t what_size
+){
+    if(a == b) { return 0; }
+    snprintf(what, what_size, "%s is %llu instead of %llu", name, b, a);
+    return -1;
+}
+
+static int n3dc_obj_diff_compare_bytes(
+    const void* a, const void* b, const size_t size, const char* name, char* what, const size_t what_size
+){
+    if((a == NULL) != (b == NULL))
+    {
+        snprintf(what, what_size, "%s is %s", name, b ? "set instead of NULL" : "NULL");
+        return -1;
+    }
+    if(!a || !memcmp(a, b, size)) { return 0; }
+    size_t i = 0;
+    while(((const unsigned char*)a)[i] == ((const unsigned char*)b)[i]) { i++; }
+    snprintf(what, what_size, "%s differs at byte %llu of %llu", name, (unsigned long long)i, (unsigned long long)size);
+    return -1;
+}
+
+static int n3dc_obj_diff_compare_string(
+    const char* a, const char* b, const char* name, char* what, const size_t what_size
+){
+    if(a == b || (a && b && !strcmp(a, b))) { return 0; }
+    snprintf(what, what_size, "%s is \"%s\" instead of \"%s\"", name, b ? b : "(null)", a ? a : "(null)");
+    return -1;
+}
+
+// The bytes of a material's colors, scalars, and illumination model, which come before its textures.
+#define N3DC_OBJ_DIFF_MATERIAL_VALUES_SIZE \
+    (offsetof(n3dc_obj_material_t, ambient_texture) - offsetof(n3dc_obj_material_t, ambient))
+
+static int n3dc_obj_diff_compare_objs(const n3dc_obj_t* a, const n3dc_obj_t* b, char* what, const size_t what_size)
+{
+    if(n3dc_obj_diff_compare_uint(a->num_vertices, b->num_vertices, "num_vertices", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->num_indices, b->num_indices, "num_indices", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->vertex_stride, b->vertex_stride, "vertex_stride", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->num_submeshes, b->num_submeshes, "num_submeshes", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->num_lods, b->num_lods, "num_lods", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->num_bvh_nodes, b->num_bvh_nodes, "num_bvh_nodes", what, what_size)
+        || n3dc_obj_diff_compare_uint(a->num_materials, b->num_materials, "num_materials", what, what_size))
+    {
+        return -1;
+    }
+    const size_t num_vertices = a->num_vertices;
+    const size_t num_triangles = (a->indices ? a->num_indices : a->num_vertices) / 3;
+    if(n3dc_obj_diff_compare_bytes(a->vertices, b->vertices, sizeof(float) * 3 * num_vertices, "vertices", what, what_size)
+        || n3dc_obj_diff_compare_bytes(a->normals, b->normals, sizeof(float) * 3 * num_vertices, "normals", what, what_size)
+        || n3dc_obj_diff_compare_bytes(
+            a->texture_coords, b->texture_coords, sizeof(float) * 2 * num_vertices, "texture_coords", what, what_size
+        )
+        || n3dc_obj_diff_compare_bytes(a->indices, b->indices, sizeof(unsigned int) * a->num_indices, "indices", what, what_size)
+        || n3dc_obj_diff_compare_bytes(
+            a->interleaved_vertices, b->interleaved_vertices, num_vertices * a->vertex_stride,
+            "interleaved_vertices", what, what_size
+        )
+        || n3dc_obj_diff_compare_bytes(
+            a->bvh_nodes, b->bvh_nodes, sizeof(n3dc_obj_bvh_node_t) * a->num_bvh_nodes, "bvh_nodes", what, what_size
+        )
+        || n3dc_obj_diff_compare_bytes(
+            a->bvh_triangles, b->bvh_triangles, sizeof(unsigned int) * num_triangles, "bvh_triangles", what, what_size
+        ))
+    {
+        return -1;
+    }
+    char name[64];
+    for(unsigned int i = 0; i < a->num_submeshes; i++)
+    {
+        const n3dc_obj_submesh_t* a_submesh = &a->submeshes[i];
+        const n3dc_obj_submesh_t* b_submesh = &b->submeshes[i];
+        snprintf(name, sizeof(name), "submeshes[%u]", i);
+        if(n3dc_obj_diff_compare_uint(a_submesh->first_index, b_submesh->first_index, name, what, what_size)
+            || n3dc_obj_diff_compare_uint(a_submesh->num_indices, b_submesh->num_indices, name, what, what_size)
+            || n3dc_obj_diff_compare_string(a_submesh->object_name, b_submesh->object_name, name, what, what_size)
+            || n3dc_obj_diff_compare_string(a_submesh->group_name, b_submesh->group_name, name, what, what_size)
+            || n3dc_obj_diff_compare_string(a_submesh->material_name, b_submesh->material_name, name, what, what_size)
+            || n3dc_obj_diff_compare_uint(a_submesh->material_index, b_submesh->material_index, name, what, what_size)
+            || n3dc_obj_diff_compare_bytes(a_submesh->bounds_min, b_submesh->bounds_min, sizeof(float) * 3, name, what, what_size)
+            || n3dc_obj_diff_compare_bytes(a_submesh->bounds_max, b_submesh->bounds_max, sizeof(float) * 3, name, what, what_size))
+        {
+            return -1;
+        }
+    }
+    for(unsigned int i = 0; i < a->num_materials; i++)
+    {
+        const n3dc_obj_material_t* a_material = &a->materials[i];
+        const n3dc_obj_material_t* b_material = &b->materials[i];
+        snprintf(name, sizeof(name), "materials[%u]", i);
+        if(n3dc_obj_diff_compare_string(a_material->name, b_material->name, name, what, what_size)
+            || n3dc_obj_diff_compare_bytes(
+                a_material->ambient, b_material->ambient, N3DC_OBJ_DIFF_MATERIAL_VALUES_SIZE, name, what, what_size
+            )
+            || n3dc_obj_diff_compare_string(a_material->diffuse_texture, b_material->diffuse_texture, name, what, what_size)
+            || n3dc_obj_diff_compare_string(a_material->bump_texture, b_material->bump_texture, name, what, what_size))
+        {
+            return -1;
+        }
+    }
+    for(unsigned int i = 0; i < a->num_lods; i++)
+    {
+        const n3dc_obj_lod_t* a_lod = &a->lods[i];
+        const n3dc_obj_lod_t* b_lod = &b->lods[i];
+        snprintf(name, sizeof(name), "lods[%u]", i);
+        if(n3dc_obj_diff_compare_bytes(&a_lod->target_ratio, &b_lod->target_ratio, sizeof(float), name, what, what_size)
+            || n3dc_obj_diff_compare_uint(a_lod->num_indices, b_lod->num_indices, name, what, what_size)
+            || n3dc_obj_diff_compare_uint(a_lod->num_vertices, b_lod->num_vertices, name, what, what_size)
+            || n3dc_obj_diff_compare_bytes(
+                a_lod->indices, b_lod->indices, sizeof(unsigned int) * a_lod->num_indices, name, what, what_size
+            ))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int n3dc_obj_diff_compare_loads(
+    const n3dc_obj_diff_load_t* a, const n3dc_obj_diff_load_t* b, char* what, const size_t what_size
+){
+    if(b->frame_differs)
+    {
+        snprintf(what, what_size, "a frame with the first frame's data has different positions");
+        return -1;
+    }
+    if(!a->obj != !b->obj)
+    {
+        snprintf(
+            what, what_size, "the load %s (%s)", b->obj ? "succeeded but the reference failed" : "failed",
+            n3dc_obj_get_error_message(b->obj ? a->error.code : b->error.code)
+        );
+        return -1;
+    }
+    if(a->obj) { return n3dc_obj_diff_compare_objs(a->obj, b->obj, what, what_size); }
+    if(a->error.code != b->error.code || a->error.line != b->error.line || a->error.offset != b->error.offset)
+    {
+        snprintf(
+            what, what_size, "error is \"%s\" at line %llu, offset %llu instead of \"%s\" at line %llu, offset %llu",
+            n3dc_obj_get_error_message(b->error.code), (unsigned long long)b->error.line,
+            (unsigned long long)b->error.offset, n3dc_obj_get_error_message(a->error.code),
+            (unsigned long long)a->error.line, (unsigned long long)a->error.offset
+        );
+        return -1;
+    }
+    return 0;
+}
+
+// 64-bit FNV-1a.
+static unsigned long long n3dc_obj_diff_hash(unsigned long long hash, const void* data, const size_t size)
+{
+    for(size_t i = 0; data && i < size; i++)
+    {
+        hash ^= ((const unsigned char*)data)[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static unsigned long long n3dc_obj_diff_hash_string(const unsigned long long hash, const char* string)
+{
+    return string ? n3dc_obj_diff_hash(hash, string, strlen(string) + 1) : n3dc_obj_diff_hash(hash, "\xFF", 1);
+}
+
+// Hashes everything that n3dc_obj_diff_compare_loads compares.
+static unsigned long long n3dc_obj_diff_hash_load(const n3dc_obj_diff_load_t* load)
+{
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    const n3dc_obj_t* obj = load->obj;
+    if(!obj)
+    {
+        const unsigned long long error[3] = {
+            (unsigned long long)load->error.code, (unsigned long long)load->error.line, (unsigned long long)load->error.offset
+        };
+        return n3dc_obj_diff_hash(hash, error, sizeof(error));
+    }
+    const unsigned int counts[7] = {
+        obj->num_vertices, obj->num_indices, obj->vertex_stride, obj->num_submeshes, obj->num_lods,
+        obj->num_bvh_nodes, obj->num_materials
+    };
+    const size_t num_vertices = obj->num_vertices;
+    const size_t num_triangles = (obj->indices ? obj->num_indices : obj->num_vertices) / 3;
+    hash = n3dc_obj_diff_hash(hash, counts, sizeof(counts));
+    hash = n3dc_obj_diff_hash(hash, obj->vertices, sizeof(float) * 3 * num_vertices);
+    hash = n3dc_obj_diff_hash(hash, obj->normals, sizeof(float) * 3 * num_vertices);
+    hash = n3dc_obj_diff_hash(hash, obj->texture_coords, sizeof(float) * 2 * num_vertices);
+    hash = n3dc_obj_diff_hash(hash, obj->indices, sizeof(unsigned int) * obj->num_indices);
+    hash = n3dc_obj_diff_hash(hash, obj->interleaved_vertices, num_vertices * obj->vertex_stride);
+    hash = n3dc_obj_diff_hash(hash, obj->bvh_nodes, sizeof(n3dc_obj_bvh_node_t) * obj->num_bvh_nodes);
+    hash = n3dc_obj_diff_hash(hash, obj->bvh_triangles, sizeof(unsigned int) * num_triangles);
+    for(unsigned int i = 0; i < obj->num_submeshes; i++)
+    {
+        const n3dc_obj_submesh_t* submesh = &obj->submeshes[i];
+        const unsigned int submesh_counts[3] = {submesh->first_index, submesh->num_indices, submesh->material_index};
+        hash = n3dc_obj_diff_hash(hash, submesh_counts, sizeof(submesh_counts));
+        hash = n3dc_obj_diff_hash_string(hash, submesh->object_name);
+        hash = n3dc_obj_diff_hash_string(hash, submesh->group_name);
+        hash = n3dc_obj_diff_hash_string(hash, submesh->material_name);
+        hash = n3dc_obj_diff_hash(hash, submesh->bounds_min, sizeof(submesh->bounds_min));
+        hash = n3dc_obj_diff_hash(hash, submesh->bounds_max, sizeof(submesh->bounds_max));
+    }
+    for(unsigned int i = 0; i < obj->num_materials; i++)
+    {
+        const n3dc_obj_material_t* material = &obj->materials[i];
+        hash = n3dc_obj_diff_hash_string(hash, material->name);
+        hash = n3dc_obj_diff_hash(hash, material->ambient, N3DC_OBJ_DIFF_MATERIAL_VALUES_SIZE);
+        hash = n3dc_obj_diff_hash_string(hash, material->diffuse_texture);
+        hash = n3dc_obj_diff_hash_string(hash, material->bump_texture);
+    }
+    for(unsigned int i = 0; i < obj->num_lods; i++)
+    {
+        const n3dc_obj_lod_t* lod = &obj->lods[i];
+        const unsigned int lod_counts[2] = {lod->num_indices, lod->num_vertices};
+        hash = n3dc_obj_diff_hash(hash, &lod->target_ratio, sizeof(float));
+        hash = n3dc_obj_diff_hash(hash, lod_counts, sizeof(lod_counts));
+        hash = n3dc_obj_diff_hash(hash, lod->indices, sizeof(unsigned int) * lod->num_indices);
+    }
+    return hash;
+}
+
+static void n3dc_obj_diff_report(
+    const n3dc_obj_diff_input_t* input, const n3dc_obj_diff_config_t* config, const char* variant, const char* what
+){
+    fprintf(stderr, "MISMATCH %s %s %s: %s\n", input->name, config->name, variant, what);
+}
+
+// Repeats a serial load with each of up to max_failures allocations failing in turn. Each load
+// must either fail with N3DC_OBJ_ERROR_OUT_OF_MEMORY or match the reference, and must free
+// everything it allocated. Returns the number of mismatches.
+static unsigned int n3dc_obj_diff_check_allocation_failures(
+    const n3dc_obj_diff_input_t* input, const n3dc_obj_diff_config_t* config,
+    const n3dc_obj_diff_load_t* reference, const unsigned long long num_allocations, const unsigned int max_failures
+){
+    unsigned int num_mismatches = 0;
+    const unsigned long long num_failures = num_allocations < max_failures ? num_allocations : max_failures;
+    for(unsigned long long i = 0; i < num_failures; i++)
+    {
+        n3dc_obj_diff_allocator_stats_t stats = {0, 0, 0};
+        // Spread the failures over every allocation when there are more than max_failures.
+        stats.fail_at = 1 + i * num_allocations / num_failures;
+        n3dc_obj_allocator_t allocator = {
+            n3dc_obj_diff_allocate, n3dc_obj_diff_reallocate, n3dc_obj_diff_deallocate, &stats
+        };
+        n3dc_obj_diff_load_t load;
+        memset(&load, 0, sizeof(n3dc_obj_diff_load_t));
+        n3dc_obj_load_options_t options;
+        n3dc_obj_diff_set_options(config, &load.error, &options);
+        options.allocator = &allocator;
+        load.obj = n3dc_obj_load_from_memory_with_options(
+            input->chars, input->length, input->max_vertices, input->max_normals, input->max_indices, &options
+        );
+        char what[512];
+        char variant[64];
+        snprintf(variant, sizeof(variant), "failed_allocation_%llu", stats.fail_at);
+        if(load.obj || load.error.code != N3DC_OBJ_ERROR_OUT_OF_MEMORY)
+        {
+            if(n3dc_obj_diff_compare_loads(reference, &load, what, sizeof(what)))
+            {
+                n3dc_obj_diff_report(input, config, variant, what);
+                num_mismatches++;
+            }
+        }
+        n3dc_obj_diff_release(&load);
+        if(stats.live_allocations != 0)
+        {
+            snprintf(what, sizeof(what), "%lld allocations leaked", stats.live_allocations);
+            n3dc_obj_diff_report(input, config, variant, what);
+            num_mismatches++;
+        }
+    }
+    return num_mismatches;
+}
+
+// Loads the input every way with the configuration and compares every load against the
+// reference. If hashes is set, the reference's hash is printed to it. Returns the number of
+// mismatches.
+static unsigned int n3dc_obj_diff_run_config(
+    const n3dc_obj_diff_input_t* input, const n3dc_obj_diff_config_t* config,
+    const unsigned int max_allocation_failures, FILE* hashes
+){
+    n3dc_obj_diff_load_t reference;
+    memset(&reference, 0, sizeof(n3dc_obj_diff_load_t));
+    n3dc_obj_load_options_t options;
+    n3dc_obj_diff_set_options(config, &reference.error, &options);
+    reference.obj = input->path
+        ? n3dc_obj_load_with_options(input->path, input->max_vertices, input->max_normals, input->max_indices, &options)
+        : n3dc_obj_load_from_memory_with_options(
+            input->chars, input->length, input->max_vertices, input->max_normals, input->max_indices, &options
+        );
+    if(hashes) { fprintf(hashes, "%s %s %016llx\n", input->name, config->name, n3dc_obj_diff_hash_load(&reference)); }
+    // Loads from memory resolve mtllib names against the current directory instead of the
+    // input's, so with materials they're compared against a serial load from memory.
+    n3dc_obj_diff_load_t memory_reference;
+    memset(&memory_reference, 0, sizeof(n3dc_obj_diff_load_t));
+    const int has_memory_reference = input->path && config->load_materials;
+    if(has_memory_reference)
+    {
+        n3dc_obj_diff_set_options(config, &memory_reference.error, &options);
+        memory_reference.obj = n3dc_obj_load_from_memory_with_options(
+            input->chars, input->length, input->max_vertices, input->max_normals, input->max_indices, &options
+        );
+    }
+
+    // Loads that count first ignore the maximums, so when they're too small those loads are
+    // compared against a serial one that counts first.
+    n3dc_obj_diff_load_t count_first_reference;
+    memset(&count_first_reference, 0, sizeof(n3dc_obj_diff_load_t));
+    if(input->is_too_small)
+    {
+        n3dc_obj_diff_set_options(config, &count_first_reference.error, &options);
+        options.count_first = 1;
+        count_first_reference.obj = n3dc_obj_load_from_memory_with_options(
+            input->chars, input->length, input->max_vertices, input->max_normals, input->max_indices, &options
+        );
+    }
+    unsigned int num_mismatches = 0;
+    unsigned long long num_allocations = 0;
+    for(unsigned int i = 0; i < N3DC_OBJ_DIFF_NUM_VARIANTS; i++)
+    {
+        const n3dc_obj_diff_variant_t* variant = &n3dc_obj_diff_variants[i];
+        // Without a file the reference is already a serial load from memory.
+        if(!input->path && (variant->kind >= N3DC_OBJ_DIFF_FILE || i == 0)) { continue; }
+        n3dc_obj_diff_allocator_stats_t stats = {0, 0, 0};
+        n3dc_obj_allocator_t allocator = {
+            n3dc_obj_diff_allocate, n3dc_obj_diff_reallocate, n3dc_obj_diff_deallocate, &stats
+        };
+        n3dc_obj_diff_load_t loads[N3DC_OBJ_DIFF_MAX_LOADS];
+        n3dc_obj_diff_set_options(config, NULL, &options);
+        if(variant->is_serial) { options.allocator = &allocator; }
+        const unsigned int num_loads = n3dc_obj_diff_load(input, variant, &options, loads);
+        for(unsigned int j = 0; j < num_loads; j++)
+        {
+            char what[512];
+            const n3dc_obj_diff_load_t* expected = has_memory_reference && variant->kind < N3DC_OBJ_DIFF_FILE
+                ? &memory_reference : &reference;
+            if(input->is_too_small && variant->kind == N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST) { expected = &count_first_reference; }
+            if(n3dc_obj_diff_compare_loads(expected, &loads[j], what, sizeof(what)))
+            {
+                n3dc_obj_diff_report(input, config, variant->name, what);
+                num_mismatches++;
+            }
+            n3dc_obj_diff_release(&loads[j]);
+        }
+        if(stats.live_allocations != 0)
+        {
+            char what[64];
+            snprintf(what, sizeof(what), "%lld allocations leaked", stats.live_allocations);
+            n3dc_obj_diff_report(input, config, variant->name, what);
+            num_mismatches++;
+        }
+        if(variant->kind == N3DC_OBJ_DIFF_MEMORY_COUNT_FIRST && variant->param == 0) { num_allocations = stats.allocations; }
+    }
+    num_mismatches += n3dc_obj_diff_check_allocation_failures(
+        input, config, has_memory_reference ? &memory_reference : &reference, num_allocations, max_allocation_failures
+    );
+    n3dc_obj_diff_release(&reference);
+    n3dc_obj_diff_release(&memory_reference);
+    n3dc_obj_diff_release(&count_first_reference);
+    return num_mismatches;
+}
+
+// Sets the input's maximums to its counts, so that the loads that don't count first can't run
+// out of room. max_indices also bounds the texture coords.
+static void n3dc_obj_diff_set_maximums(n3dc_obj_diff_input_t* input)
+{
+    n3dc_obj_counts_t counts;
+    if(n3dc_obj_count_from_memory(input->chars, input->length, &counts))
+    {
+        memset(&counts, 0, sizeof(n3dc_obj_counts_t));
+    }
+    input->max_vertices = counts.num_vertices;
+    input->max_normals = counts.num_normals;
+    input->max_indices = counts.num_indices > counts.num_texture_coords ? counts.num_indices : counts.num_texture_coords;
+    input->is_too_small = 0;
+}
+
+// Halves the input's max_vertices (0), max_normals (1), or max_indices (2), so that loads fail
+// partway through the data unless they count first.
+static void n3dc_obj_diff_shrink_maximum(n3dc_obj_diff_input_t* input, const unsigned int which)
+{
+    unsigned int* maximums[3] = {&input->max_vertices, &input->max_normals, &input->max_indices};
+    if(*maximums[which] == 0) { return; }
+    *maximums[which] /= 2;
+    input->is_too_small = 1;
+}
+
+#if defined(N3DC_OBJ_DIFF_FUZZER)
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size);
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size)
+{
+    if(size == 0) { return 0; }
+    n3dc_obj_diff_input_t input;
+    memset(&input, 0, sizeof(n3dc_obj_diff_input_t));
+    input.name = "fuzz_input";
+    input.chars = (const char*)&data[1];
+    input.length = size - 1;
+    n3dc_obj_diff_set_maximums(&input);
+    // The first byte picks the configuration, and whether one of the maximums is too small.
+    const unsigned int shrink = data[0] / N3DC_OBJ_DIFF_NUM_FUZZ_CONFIGS % 4;
+    if(shrink > 0) { n3dc_obj_diff_shrink_maximum(&input, shrink - 1); }
+    const n3dc_obj_diff_config_t* config = &n3dc_obj_diff_configs[data[0] % N3DC_OBJ_DIFF_NUM_FUZZ_CONFIGS];
+    if(n3dc_obj_diff_run_config(&input, config, 8, NULL) > 0) { abort(); }
+    return 0;
+}
+
+#else
+
+// A growable buffer of generated OBJ data.
+typedef struct
+{
+    char* chars;
+    size_t length;
+    size_t capacity;
+} n3dc_obj_diff_buffer_t;
+
+static void n3dc_obj_diff_append(n3dc_obj_diff_buffer_t* buffer, const char* chars, const size_t length)
+{
+    if(buffer->length + length > buffer->capacity)
+    {
+        size_t new_capacity = buffer->capacity > 0 ? buffer->capacity * 2 : 1 << 16;
+        while(new_capacity < buffer->length + length) { new_capacity *= 2; }
+        char* new_chars = (char*)realloc(buffer->chars, new_capacity);
+        if(!new_chars)
+        {
+            fprintf(stderr, "Could not allocate memory for a generated OBJ file\n");
+            exit(1);
+        }
+        buffer->chars = new_chars;
+        buffer->capacity = new_capacity;
+    }
+    memcpy(&buffer->chars[buffer->length], chars, length);
+    buffer->length += length;
+}
+
+static void n3dc_obj_diff_append_string(n3dc_obj_diff_buffer_t* buffer, const char* string)
+{
+    n3dc_obj_diff_append(buffer, string, strlen(string));
+}
+
+// xorshift64*, so that generated inputs are the same on every platform.
+static unsigned long long n3dc_obj_diff_random(unsigned long long* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+static unsigned int n3dc_obj_diff_random_below(unsigned long long* state, const unsigned int bound)
+{
+    return (unsigned int)((n3dc_obj_diff_random(state) >> 32) % bound);
+}
+
+// Writes a number in one of the ways exporters write them, from "3" and "-0.5" to
+// "1.2345678901234567e-08", "+2.5", and ".75". One in 32 is a float's extremes instead: subnormal,
+// underflowing to 0, near FLT_MAX, overflowing to infinity, or far outside a double's range.
+static void n3dc_obj_diff_format_float(unsigned long long* random, char* number, const size_t number_size)
+{
+    if(n3dc_obj_diff_random_below(random, 32) == 0)
+    {
+        static const int exponent_ranges[5][2] = {{-45, -37}, {-60, -46}, {36, 39}, {39, 60}, {300, 9999}};
+        const int* range = exponent_ranges[n3dc_obj_diff_random_below(random, 5)];
+        int exponent = range[0] + (int)n3dc_obj_diff_random_below(random, (unsigned int)(range[1] - range[0] + 1));
+        if(range[0] == 300 && n3dc_obj_diff_random_below(random, 2)) { exponent = -exponent; }
+        const double mantissa = 1.0 + (double)n3dc_obj_diff_random_below(random, 900000000) / 100000000.0;
+        snprintf(
+            number, number_size, "%s%.*fe%d", n3dc_obj_diff_random_below(random, 2) ? "-" : "",
+            (int)n3dc_obj_diff_random_below(random, 9), mantissa, exponent
+        );
+        return;
+    }
+    double value = (double)n3dc_obj_diff_random_below(random, 2000000001) / (double)(1ull << n3dc_obj_diff_random_below(random, 40));
+    if(n3dc_obj_diff_random_below(random, 2)) { value = -value; }
+    switch(n3dc_obj_diff_random_below(random, 6))
+    {
+        case 0: snprintf(number, number_size, "%.*f", (int)n3dc_obj_diff_random_below(random, 9), value); break;
+        case 1: snprintf(number, number_size, "%.*g", 1 + (int)n3dc_obj_diff_random_below(random, 17), value); break;
+        case 2:
+        {
+            const double scale = n3dc_obj_diff_random_below(random, 2) ? 1e-20 : 1e20;
+            snprintf(number, number_size, "%.*e", (int)n3dc_obj_diff_random_below(random, 10), value * scale);
+            break;
+        }
+        case 3: snprintf(number, number_size, "%lld", (long long)value); break;
+        case 4: snprintf(number, number_size, "+%.6f", value < 0.0 ? -value : value); break;
+        default:
+        {
+            // Fractions without their leading zero.
+            const double fraction = value - (double)(long long)value;
+            char digits[64];
+            snprintf(digits, sizeof(digits), "%.*f", 1 + (int)n3dc_obj_diff_random_below(random, 7), fraction);
+            const size_t sign_length = digits[0] == '-' ? 1 : 0;
+            if(digits[sign_length] == '0' && digits[sign_length + 1] == '.')
+            {
+                memmove(&digits[sign_length], &digits[sign_length + 1], strlen(&digits[sign_length + 1]) + 1);
+            }
+            snprintf(number, number_size, "%s", digits);
+            break;
+        }
+    }
+}
+
+// Appends a record of num_values numbers, e.g. "v 1 2 3".
+static void n3dc_obj_diff_append_record(
+    unsigned long long* random, n3dc_obj_diff_buffer_t* buffer, const char* keyword,
+    const unsigned int num_values, const char* newline
+){
+    static const char* separators[] = {" ", " ", " ", "\t", "  "};
+    n3dc_obj_diff_append_string(buffer, keyword);
+    for(unsigned int i = 0; i < num_values; i++)
+    {
+        char number[64];
+        n3dc_obj_diff_format_float(random, number, sizeof(number));
+        n3dc_obj_diff_append_string(buffer, separators[n3dc_obj_diff_random_below(random, 5)]);
+        n3dc_obj_diff_append_string(buffer, number);
+    }
+    n3dc_obj_diff_append_string(buffer, newline);
+}
+
+// Name of the MTL file written next to each generated OBJ file.
+#define N3DC_OBJ_DIFF_MTL_NAME "n3dc_obj_diff_input.mtl"
+
+// Appends an o, g, usemtl, s, mtllib, comment, or blank line.
+static void n3dc_obj_diff_append_other(unsigned long long* random, n3dc_obj_diff_buffer_t* buffer, const char* newline)
+{
+    static const char* lines[] = {
+        "o object_a", "o object_b", "g group_a", "g group_a group_b", "g", "usemtl material_a",
+        "usemtl  material_b ", "s 1", "s off", "mtllib missing.mtl", "mtllib " N3DC_OBJ_DIFF_MTL_NAME,
+        "mtllib missing.mtl " N3DC_OBJ_DIFF_MTL_NAME, "# comment", "#", "", "   ", "l 1 2"
+    };
+    n3dc_obj_diff_append_string(buffer, lines[n3dc_obj_diff_random_below(random, sizeof(lines) / sizeof(lines[0]))]);
+    n3dc_obj_diff_append_string(buffer, newline);
+}
+
+// Generates an OBJ file with random records. A quarter of the files have a few bytes corrupted
+// to cover the error paths.
+static void n3dc_obj_diff_generate(unsigned long long* random, n3dc_obj_diff_buffer_t* buffer)
+{
+    buffer->length = 0;
+    const char* newline = n3dc_obj_diff_random_below(random, 4) == 0 ? "\r\n" : "\n";
+    if(n3dc_obj_diff_random_below(random, 4) != 0)
+    {
+        n3dc_obj_diff_append_string(buffer, "mtllib " N3DC_OBJ_DIFF_MTL_NAME);
+        n3dc_obj_diff_append_string(buffer, newline);
+    }
+    const unsigned int num_vertices = 1 + n3dc_obj_diff_random_below(random, 300);
+    const unsigned int num_texture_coords = n3dc_obj_diff_random_below(random, 3) ? n3dc_obj_diff_random_below(random, 300) : 0;
+    const unsigned int num_normals = n3dc_obj_diff_random_below(random, 3) ? n3dc_obj_diff_random_below(random, 300) : 0;
+    unsigned int vertices = 0, texture_coords = 0, normals = 0;
+    while(vertices < num_vertices || texture_coords < num_texture_coords || normals < num_normals)
+    {
+        const unsigned int choice = n3dc_obj_diff_random_below(random, 16);
+        if(choice == 0) { n3dc_obj_diff_append_other(random, buffer, newline); }
+        else if(choice < 6 && vertices < num_vertices)
+        {
+            // Some exporters write a fourth, weight component.
+            n3dc_obj_diff_append_record(random, buffer, "v", n3dc_obj_diff_random_below(random, 8) ? 3 : 4, newline);
+            vertices++;
+        }
+        else if(choice < 11 && texture_coords < num_texture_coords)
+        {
+            n3dc_obj_diff_append_record(random, buffer, "vt", n3dc_obj_diff_random_below(random, 8) ? 2 : 3, newline);
+            texture_coords++;
+        }
+        else if(choice >= 11 && normals < num_normals)
+        {
+            n3dc_obj_diff_append_record(random, buffer, "vn", 3, newline);
+            normals++;
+        }
+    }
+    const unsigned int num_faces = n3dc_obj_diff_random_below(random, 400);
+    // An eighth of the files have a face with indices past the last record.
+    const unsigned int past_end_face = n3dc_obj_diff_random_below(random, 8) == 0
+        ? n3dc_obj_diff_random_below(random, num_faces + 1) : num_faces;
+    for(unsigned int i = 0; i < num_faces; i++)
+    {
+        if(n3dc_obj_diff_random_below(random, 16) == 0) { n3dc_obj_diff_append_other(random, buffer, newline); }
+        // Mostly triangles and quads, with the odd n-gon.
+        const unsigned int num_corners = n3dc_obj_diff_random_below(random, 8) == 0
+            ? 3 + n3dc_obj_diff_random_below(random, 6) : 3 + n3dc_obj_diff_random_below(random, 2);
+        const int has_texture_coords = num_texture_coords > 0 && n3dc_obj_diff_random_below(random, 4) != 0;
+        const int has_normals = num_normals > 0 && n3dc_obj_diff_random_below(random, 4) != 0;
+        n3dc_obj_diff_append_string(buffer, "f");
+        for(unsigned int j = 0; j < num_corners; j++)
+        {
+            const unsigned int counts[3] = {num_vertices, num_texture_coords, num_normals};
+            const int has_index[3] = {1, has_texture_coords, has_normals};
+            char corner[96];
+            size_t corner_length = 0;
+            corner[corner_length++] = ' ';
+            for(unsigned int k = 0; k < 3; k++)
+            {
+                if(k > 0 && (has_index[k] || (k == 1 && has_normals))) { corner[corner_length++] = '/'; }
+                if(!has_index[k]) { continue; }
+                // Negative indices count back from the latest record.
+                const int is_past_end = i == past_end_face && n3dc_obj_diff_random_below(random, 4) == 0;
+                const unsigned int index = is_past_end
+                    ? counts[k] + n3dc_obj_diff_random_below(random, 3)
+                    : n3dc_obj_diff_random_below(random, counts[k]);
+                corner_length += (size_t)(!is_past_end && n3dc_obj_diff_random_below(random, 8) == 0
+                    ? sprintf(&corner[corner_length], "-%u", counts[k] - index)
+                    : sprintf(&corner[corner_length], "%u", index + 1));
+            }
+            n3dc_obj_diff_append(buffer, corner, corner_length);
+        }
+        n3dc_obj_diff_append_string(buffer, newline);
+    }
+    // Some files don't end with a newline.
+    if(n3dc_obj_diff_random_below(random, 4) == 0)
+    {
+        while(buffer->length > 0 && (buffer->chars[buffer->length - 1] == '\n' || buffer->chars[buffer->length - 1] == '\r'))
+        {
+            buffer->length--;
+        }
+    }
+    if(buffer->length > 0 && n3dc_obj_diff_random_below(random, 4) == 0)
+    {
+        static const char corruptions[] = " \t\n/-+.e0x#\r";
+        const unsigned int num_corruptions = 1 + n3dc_obj_diff_random_below(random, 3);
+        for(unsigned int i = 0; i < num_corruptions; i++)
+        {
+            buffer->chars[n3dc_obj_diff_random_below(random, (unsigned int)buffer->length)]
+                = corruptions[n3dc_obj_diff_random_below(random, sizeof(corruptions) - 1)];
+        }
+    }
+}
+
+// Generates the MTL file that generated OBJ files name. It always defines material_a, and
+// sometimes material_b, which the OBJ files' usemtl lines use, and an unused material_c.
+static void n3dc_obj_diff_generate_materials(unsigned long long* random, n3dc_obj_diff_buffer_t* buffer)
+{
+    static const char* names[3] = {"material_a", "material_b", "material_c"};
+    buffer->length = 0;
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        if(i == 1 && n3dc_obj_diff_random_below(random, 2)) { continue; }
+        n3dc_obj_diff_append_string(buffer, "newmtl ");
+        n3dc_obj_diff_append_string(buffer, names[i]);
+        n3dc_obj_diff_append_string(buffer, "\n");
+        n3dc_obj_diff_append_record(random, buffer, "Kd", 3, "\n");
+        n3dc_obj_diff_append_record(random, buffer, "Ns", 1, "\n");
+        if(n3dc_obj_diff_random_below(random, 2)) { n3dc_obj_diff_append_string(buffer, "map_Kd textures/diffuse.png\n"); }
+        if(n3dc_obj_diff_random_below(random, 2)) { n3dc_obj_diff_append_string(buffer, "bump -bm 0.5 bump.png\n"); }
+    }
+}
+
+// Counts the significant digits of a number, ignoring leading zeros.
+static unsigned int n3dc_obj_diff_count_significant_digits(const char* number, const char* number_end)
+{
+    unsigned int digits = 0;
+    for(const char* c = number; c < number_end && *c != 'e' && *c != 'E'; c++)
+    {
+        if(*c >= '1' && *c <= '9') { digits++; }
+        else if(*c == '0' && digits > 0) { digits++; }
+    }
+    return digits;
+}
+
+// Loads a file of generated v lines, each used by one face corner in order, and checks every
+// scanned float against strtof. Returns the number of mismatches.
+static unsigned int n3dc_obj_diff_check_floats(unsigned long long* random, n3dc_obj_diff_buffer_t* buffer)
+{
+    // Numbers that overflow, underflow, or are subnormal as floats, which generated numbers rarely are.
+    static const char* extreme_numbers[] = {
+        "1e-400", "-1e-999", "1e-45", "1.4e-45", "-7e-46", "1e-38", "1.17549e-38", "5e-324",
+        "1e39", "-3.5e38", "3.4028235e38", "1e400", "-1e9999", "0e-9999", "123456789e-9999", "0.000001e-40"
+    };
+    const unsigned int num_extreme_numbers = sizeof(extreme_numbers) / sizeof(extreme_numbers[0]);
+    const unsigned int num_vertices = 3000;
+    buffer->length = 0;
+    for(unsigned int i = 0; i < num_extreme_numbers; i += 2)
+    {
+        char record[96];
+        n3dc_obj_diff_append(
+            buffer, record,
+            (size_t)sprintf(record, "v %s %s 0\n", extreme_numbers[i], extreme_numbers[i + 1])
+        );
+    }
+    for(unsigned int i = num_extreme_numbers / 2; i < num_vertices; i++)
+    {
+        n3dc_obj_diff_append_record(random, buffer, "v", 3, "\n");
+    }
+    for(unsigned int i = 0; i < num_vertices; i += 3)
+    {
+        char face[64];
+        n3dc_obj_diff_append(buffer, face, (size_t)sprintf(face, "f %u %u %u\n", i + 1, i + 2, i + 3));
+    }
+    n3dc_obj_diff_append(buffer, "", 1);
+    n3dc_obj_t* obj = n3dc_obj_load_from_memory(buffer->chars, buffer->length - 1, num_vertices, 0, num_vertices);
+    if(!obj)
+    {
+        fprintf(stderr, "MISMATCH floats: the load failed\n");
+        return 1;
+    }
+    unsigned int num_mismatches = 0;
+    const char* c = buffer->chars;
+    for(unsigned int i = 0; i < num_vertices * 3; i++)
+    {
+        // Every number follows a v and the separator characters.
+        while(*c == 'v' || *c == ' ' || *c == '\t' || *c == '\n') { c++; }
+        char* number_end = NULL;
+        const float expected = strtof(c, &number_end);
+        const float scanned = obj->vertices[i];
+        unsigned int expected_bits, scanned_bits;
+        memcpy(&expected_bits, &expected, sizeof(float));
+        memcpy(&scanned_bits, &scanned, sizeof(float));
+        const unsigned int ulps = expected_bits > scanned_bits ? expected_bits - scanned_bits : scanned_bits - expected_bits;
+        // The scanner rounds to a double and then to a float. Past 15 digits the decimal mantissa
+        // isn't exact in a double, and even a correctly rounded double can fall halfway between
+        // two floats, so either can leave the result 1 ulp off.
+        const float double_rounded = (float)strtod(c, NULL);
+        const unsigned int max_ulps = n3dc_obj_diff_count_significant_digits(c, number_end) > 15
+            || memcmp(&double_rounded, &expected, sizeof(float)) ? 1 : 0;
+        if(ulps > max_ulps)
+        {
+            fprintf(
+                stderr, "MISMATCH floats: \"%.*s\" scanned as %.9g instead of %.9g\n",
+                (int)(number_end - c), c, (double)scanned, (double)expected
+            );
+            num_mismatches++;
+        }
+        c = number_end;
+    }
+    n3dc_obj_free(obj);
+    return num_mismatches;
+}
+
+static int n3dc_obj_diff_read_file(const char* path, n3dc_obj_diff_buffer_t* buffer)
+{
+    buffer->length = 0;
+    FILE* fp = fopen(path, "rb");
+    if(!fp) { return -1; }
+    char chunk[1 << 16];
+    size_t chunk_length = 0;
+    while((chunk_length = fread(chunk, 1, sizeof(chunk), fp)) > 0) { n3dc_obj_diff_append(buffer, chunk, chunk_length); }
+    const int error = ferror(fp);
+    fclose(fp);
+    return error ? -1 : 0;
+}
+
+static int n3dc_obj_diff_write_file(const char* path, const n3dc_obj_diff_buffer_t* buffer)
+{
+    FILE* fp = fopen(path, "wb");
+    if(!fp) { return -1; }
+    const int error = fwrite(buffer->chars, 1, buffer->length, fp) != buffer->length;
+    return (fclose(fp) || error) ? -1 : 0;
+}
+
+static void n3dc_obj_diff_make_directory(const char* path)
+{
+#if defined(_WIN32)
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+static void n3dc_obj_diff_remove_directory(const char* path)
+{
+#if defined(_WIN32)
+    _rmdir(path);
+#else
+    rmdir(path);
+#endif
+}
+
+static unsigned int n3dc_obj_diff_run_input(n3dc_obj_diff_input_t* input, FILE* hashes)
+{
+    n3dc_obj_diff_set_maximums(input);
+    unsigned int num_mismatches = 0;
+    for(unsigned int i = 0; i < N3DC_OBJ_DIFF_NUM_CONFIGS; i++)
+    {
+        num_mismatches += n3dc_obj_diff_run_config(input, &n3dc_obj_diff_configs[i], 32, hashes);
+    }
+    // Then with each maximum too small in turn. Skipped attributes aren't limited, so
+    // positions_only runs too.
+    static const char* maximum_names[3] = {"max_vertices", "max_normals", "max_indices"};
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        char name[4200];
+        snprintf(name, sizeof(name), "%s/small_%s", input->name, maximum_names[i]);
+        n3dc_obj_diff_input_t small_input = *input;
+        small_input.name = name;
+        n3dc_obj_diff_shrink_maximum(&small_input, i);
+        if(!small_input.is_too_small) { continue; }
+        for(unsigned int j = 0; j < N3DC_OBJ_DIFF_NUM_CONFIGS; j++)
+        {
+            const n3dc_obj_diff_config_t* config = &n3dc_obj_diff_configs[j];
+            if(strcmp(config->name, "indexed") && strcmp(config->name, "positions_only")) { continue; }
+            num_mismatches += n3dc_obj_diff_run_config(&small_input, config, 4, hashes);
+        }
+    }
+    // The next input can have different MTL files at the same paths.
+    n3dc_obj_clear_material_cache();
+    return num_mismatches;
+}
+
+static void n3dc_obj_diff_print_usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--cases N] [--seed N] [--dir PATH] [--hashes] [--fuzz-input] [FILE...]\n"
+        "  --cases       Number of OBJ files to generate when no files are given (default 200)\n"
+        "  --seed        Seed for the generated files (default 1)\n"
+        "  --dir         Directory to make a directory of generated OBJ, MTL, and cache files in (default .)\n"
+        "  --hashes      Print a hash of every reference load on stdout\n"
+        "  --fuzz-input  Run every FILE the way the fuzz target would\n",
+        program
+    );
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int num_cases = 200;
+    unsigned long long seed = 1;
+    const char* dir = ".";
+    int print_hashes = 0;
+    int is_fuzz_input = 0;
+    int num_paths = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 < argc && !strcmp(argv[i], "--cases")) { num_cases = (unsigned int)strtoul(argv[++i], NULL, 10); }
+        else if(i + 1 < argc && !strcmp(argv[i], "--seed")) { seed = strtoull(argv[++i], NULL, 10); }
+        else if(i + 1 < argc && !strcmp(argv[i], "--dir")) { dir = argv[++i]; }
+        else if(!strcmp(argv[i], "--hashes")) { print_hashes = 1; }
+        else if(!strcmp(argv[i], "--fuzz-input")) { is_fuzz_input = 1; }
+        else if(argv[i][0] == '-')
+        {
+            n3dc_obj_diff_print_usage(argv[0]);
+            return 1;
+        }
+        else { argv[1 + num_paths++] = argv[i]; }
+    }
+    FILE* hashes = print_hashes ? stdout : NULL;
+    n3dc_obj_diff_buffer_t buffer = {NULL, 0, 0};
+    unsigned int num_mismatches = 0;
+    unsigned int num_inputs = 0;
+    for(int i = 0; i < num_paths; i++)
+    {
+        const char* path = argv[1 + i];
+        if(n3dc_obj_diff_read_file(path, &buffer))
+        {
+            fprintf(stderr, "Could not read %s\n", path);
+            num_mismatches++;
+            continue;
+        }
+        n3dc_obj_diff_input_t input;
+        memset(&input, 0, sizeof(n3dc_obj_diff_input_t));
+        input.name = path;
+        input.chars = buffer.chars;
+        input.length = buffer.length;
+        if(is_fuzz_input && buffer.length > 0)
+        {
+            input.chars++;
+            input.length--;
+            n3dc_obj_diff_set_maximums(&input);
+            const unsigned int shrink = (unsigned char)buffer.chars[0] / N3DC_OBJ_DIFF_NUM_FUZZ_CONFIGS % 4;
+            if(shrink > 0) { n3dc_obj_diff_shrink_maximum(&input, shrink - 1); }
+            const n3dc_obj_diff_config_t* config = &n3dc_obj_diff_configs[(unsigned char)buffer.chars[0] % N3DC_OBJ_DIFF_NUM_FUZZ_CONFIGS];
+            num_mismatches += n3dc_obj_diff_run_config(&input, config, 8, hashes);
+        }
+        else if(!is_fuzz_input)
+        {
+            input.path = path;
+            num_mismatches += n3dc_obj_diff_run_input(&input, hashes);
+        }
+        num_inputs++;
+    }
+    if(num_paths == 0)
+    {
+        // Seed 0 would keep xorshift at 0.
+        unsigned long long random = seed * 0x9E3779B97F4A7C15ull + 1;
+        // The files go in a directory of their own so that mtllib names only resolve when
+        // they're resolved against the OBJ file's directory.
+        char input_dir[4000];
+        char path[4096];
+        char mtl_path[4096];
+        snprintf(input_dir, sizeof(input_dir), "%s/n3dc_obj_diff_input", dir);
+        snprintf(path, sizeof(path), "%s/n3dc_obj_diff_input.obj", input_dir);
+        snprintf(mtl_path, sizeof(mtl_path), "%s/" N3DC_OBJ_DIFF_MTL_NAME, input_dir);
+        n3dc_obj_diff_make_directory(input_dir);
+        n3dc_obj_diff_buffer_t mtl_buffer = {NULL, 0, 0};
+        for(unsigned int i = 0; i < num_cases; i++)
+        {
+            n3dc_obj_diff_generate(&random, &buffer);
+            n3dc_obj_diff_generate_materials(&random, &mtl_buffer);
+            if(n3dc_obj_diff_write_file(path, &buffer) || n3dc_obj_diff_write_file(mtl_path, &mtl_buffer))
+            {
+                fprintf(stderr, "Could not write %s\n", path);
+                num_mismatches++;
+                break;
+            }
+            char name[64];
+            snprintf(name, sizeof(name), "case_%u", i);
+            n3dc_obj_diff_input_t input;
+            memset(&input, 0, sizeof(n3dc_obj_diff_input_t));
+            input.name = name;
+            input.chars = buffer.chars;
+            input.length = buffer.length;
+            input.path = path;
+            num_mismatches += n3dc_obj_diff_run_input(&input, hashes);
+            num_inputs++;
+        }
+        remove(path);
+        remove(mtl_path);
+        n3dc_obj_diff_remove_directory(input_dir);
+        free(mtl_buffer.chars);
+        num_mismatches += n3dc_obj_diff_check_floats(&random, &buffer);
+    }
+    free(buffer.chars);
+    fprintf(stderr, "%u inputs, %u mismatches\n", num_inputs, num_mismatches);
+    return num_mismatches > 0 ? 1 : 0;
+}
+
+#endif
@@ -35,15 +35,181 @@
  * maximums are exceeded. If the load succeeds, n3dc_obj_load will return a pointer to an n3dc_obj_t.
  * If the load fails, n3dc_obj_load will return NULL
  *
+ * If the OBJ file is already in memory, call n3dc_obj_load_from_memory with a pointer to its
+ * characters and the number of characters instead of a path. The buffer doesn't need to be
+ * NUL-terminated and is not modified or retained after the call returns. In files, buffers, and
+ * streams alike, the last line doesn't need to end with a newline.
+ *
+ * n3dc_obj_load_with_options and n3dc_obj_load_from_memory_with_options take an additional
+ * n3dc_obj_load_options_t. Setting num_threads splits large files at line boundaries and parses
+ * the pieces on separate threads, producing the same result as a serial load. On POSIX systems
+ * this requires linking with pthreads (-pthread). Define N3DC_OBJ_NO_THREADS to always parse on
+ * the calling thread. Files are only split into pieces of at least N3DC_OBJ_MIN_CHUNK_LENGTH
+ * bytes (1 MiB), and the later steps into tasks of at least N3DC_OBJ_MIN_TASK_SIZE face corners
+ * or triangles (65536). Both can be defined lower, e.g. to test the threaded paths on small files.
+ *
+ * If you don't know the maximums ahead of time, set count_first in n3dc_obj_load_options_t to run a
+ * quick counting pass and allocate exactly what the file needs. n3dc_obj_count and
+ * n3dc_obj_count_from_memory run only the counting pass, which is useful for budgeting memory
+ * before committing to a load. They return 0 on success and -1 on failure.
+ *
+ * By default the loaded vertices form a triangle list with one vertex per face corner. Setting
+ * output_mode to N3DC_OBJ_OUTPUT_INDEXED welds face corners that share the same vertex, texture,
+ * and normal indices into a single vertex and returns the triangles through indices instead.
+ * Also setting optimize_vertex_cache reorders the triangles for the GPU's post-transform vertex
+ * cache (with Tipsify) and stores the vertices in the order the triangles first use them, which
+ * makes a separate optimization pass over the n3dc_obj_t unnecessary.
+ *
+ * Indexed loads can also generate levels of detail. Set num_lods and point lod_ratios at the
+ * fraction of the triangles each LOD should keep (e.g. {0.5f, 0.25f, 0.1f}), and lods gets one
+ * simplified index buffer per ratio, made by quadric edge collapse over the welded mesh. Borders
+ * stay in place and texture or normal seams only move along themselves, so a LOD may keep more
+ * triangles than asked for (meshes with per-face normals barely simplify at all). LODs share the
+ * full mesh's vertices, which are ordered so that each LOD only uses a prefix of them with the
+ * coarsest LOD's vertices first, so the coarsest LOD can be streamed and drawn before the rest of
+ * the vertex buffer arrives.
+ *
+ * To upload vertices to the GPU without a separate interleaving pass, point vertex_layout at an
+ * n3dc_obj_vertex_layout_t. The attributes are then written straight into interleaved_vertices,
+ * which can optionally be memory you provide through interleaved_buffer. A buffer you provide is
+ * never freed by n3dc_obj. The layout can also quantize each attribute as it's written (e.g. half
+ * float positions, octahedral normals, and unorm16 texture coords fit in 12 bytes), in which case
+ * no full precision copy of the vertices is ever made. Half floats are converted with F16C or
+ * NEON when the compiler targets them.
+ *
+ * When you're done with an n3dc_obj_t, release it and all of its arrays with n3dc_obj_free.
+ * To route the load's allocations through your own allocator, set allocator in
+ * n3dc_obj_load_options_t. The temporary arrays used while parsing can also be carved out of a
+ * single caller-owned scratch_arena so that a load makes no temporary allocations of its own.
+ *
+ * To load many files at once, call n3dc_obj_load_batch with an array of paths and an array to
+ * receive one n3dc_obj_t per path. The files are shared out between num_threads threads, each of
+ * which parses one file at a time and reuses its parse arrays from file to file while the next
+ * file is read ahead. The maximums apply to every file and the allocator must be thread-safe.
+ * interleaved_buffer and scratch_arena are ignored. It returns 0 if every file was loaded and -1
+ * otherwise, in which case the entries for the files that failed are NULL.
+ *
+ * To load without blocking the calling thread, n3dc_obj_load_async and
+ * n3dc_obj_load_from_memory_async start the load on a new thread and return a handle right away,
+ * or NULL if the load couldn't be started. Either pass a callback, which is called on the loading
+ * thread when the load finishes, or poll the handle with n3dc_obj_async_is_done. Every handle must
+ * be released with n3dc_obj_async_wait, which waits for the load to finish and returns its
+ * n3dc_obj_t (or NULL if it failed). The path is copied, but a memory buffer and the options
+ * (including anything they point to) must stay valid until the load is done. Files are read
+ * ahead in full as soon as they're opened, so several loads in flight keep the disk busy while
+ * earlier ones are being parsed. If N3DC_OBJ_NO_THREADS is defined the load runs before the
+ * handle is returned.
+ *
+ * To skip parsing on later runs, n3dc_obj_cache_write saves an n3dc_obj_t to a binary cache file
+ * stamped with the size and modification time of its source OBJ file. n3dc_obj_cache_load maps a
+ * cache file and returns an n3dc_obj_t whose arrays point straight into the mapping, or NULL if the
+ * cache is missing, invalid, or older than the source file. The mapping is copy-on-write, so the
+ * arrays can be modified without changing the cache file. n3dc_obj_load_cached combines the two:
+ * it returns the cached mesh if it is fresh and was built with the same output_mode,
+ * optimize_vertex_cache, normal_mode, record_submeshes, lod_ratios, vertex_layout,
+ * skip_attributes, build_bvh, and load_materials, and otherwise loads the OBJ file and rewrites
+ * the cache. Cache files use the native byte order and are rejected on machines with a
+ * different one.
+ *
+ * OBJ data that arrives in pieces (e.g. from a socket or a decompressor) can be parsed without
+ * holding the whole file in memory. Call n3dc_obj_stream_begin with the same maximums and options
+ * as a load, pass each piece to n3dc_obj_stream_feed as it arrives, then call n3dc_obj_stream_end
+ * to get the n3dc_obj_t. Pieces can split lines anywhere. Only the unfinished last line of each
+ * piece is copied, so the stream's memory is bounded by the maximums and the longest line.
+ * n3dc_obj_stream_feed returns 0 on success and -1 once the stream has failed, in which case
+ * n3dc_obj_stream_end returns NULL. n3dc_obj_stream_end always releases the stream. Streams
+ * ignore num_threads and count_first, and the options (including anything they point to) must
+ * stay valid until n3dc_obj_stream_end returns.
+ *
+ * To play back a sequence of OBJ files that share their faces and differ only in their positions
+ * (e.g. the frames of a simulation), call n3dc_obj_sequence_begin with the first frame and the
+ * same maximums and options as a load, and get the first frame's mesh from
+ * n3dc_obj_sequence_get_obj. Each later frame is loaded with n3dc_obj_sequence_load_frame (or
+ * n3dc_obj_sequence_load_frame_from_memory), which parses only its v lines, on up to num_threads
+ * threads, and writes 3 floats per vertex of the first frame's mesh to positions in the same
+ * vertex order, whatever the output mode or vertex_layout. Every other line is skipped like a
+ * comment, so the indices, texture coords, normals, submeshes, LODs, and BVH all stay the first
+ * frame's. positions is caller-owned memory for num_vertices * 3 floats, so a small ring of
+ * buffers lets earlier frames be uploaded or drawn while the next is loaded. A frame with a
+ * different number of v lines fails to load. The parse arrays are reused from frame to frame,
+ * scratch_arena is ignored, and the options (including anything they point to) must stay valid
+ * until n3dc_obj_sequence_end, which frees the sequence and its mesh. Frames report their
+ * failures and stats through the options like loads do.
+ *
+ * On POSIX and Windows systems the OBJ file is memory-mapped and parsed in place. If you would
+ * rather have it read into a heap buffer, define N3DC_OBJ_NO_MMAP alongside N3DC_OBJ_IMPLEMENTATION.
+ * Lines that aren't parsed (comments, groups, etc.) are skipped with SSE2, AVX2, or NEON when the
+ * compiler targets them. Define N3DC_OBJ_NO_SIMD to use plain C instead.
+ *
+ * Faces with more than 3 index groups are fan-triangulated as they're parsed, so a quad becomes
+ * 2 triangles. Index groups can leave out the texture index, the normal index, or both (e.g.
+ * "f 1 2 3", "f 1/1 2/2 3/3", or "f 1//1 2//2 3//3"), in which case the missing texture coords
+ * or normals are zero. Set normal_mode to N3DC_OBJ_NORMALS_SMOOTH or N3DC_OBJ_NORMALS_FLAT to
+ * generate the missing normals from the faces instead. Negative indices refer to the records
+ * that came before the face, so "f -3 -2 -1" uses the last 3 vertices, and are resolved while
+ * parsing in every load mode.
+ *
+ * Setting record_submeshes splits the faces into n3dc_obj_submesh_t ranges wherever an o, g, or
+ * usemtl line changes the object, group, or material, so that each range can be drawn (or
+ * culled by its bounding box) on its own. The ranges are in file order, cover every face, and
+ * stay contiguous when optimize_vertex_cache reorders the triangles, which happens within each
+ * range.
+ *
+ * The library never prints. When a load fails, the reason is written to the n3dc_obj_error_t that
+ * the options' error points to: an n3dc_obj_error_code_t, plus the byte offset and 1-based line
+ * number for parsing failures, including face indices past the end of the file's records.
+ * n3dc_obj_get_error_message turns a code into text for logging.
+ * Batch loads report the first path (in path order) that failed, and streams report failures
+ * from n3dc_obj_stream_end (or from n3dc_obj_stream_begin if it returns NULL).
+ *
+ * Define N3DC_OBJ_ENABLE_STATS alongside N3DC_OBJ_IMPLEMENTATION to have loads and streams fill in
+ * the n3dc_obj_stats_t that the options' stats points to with per-phase timings, record counts, and
+ * peak scratch memory. Without it the collection compiles out entirely and the stats are zeroed.
+ * Timings are wall time, except on pre-C11 compilers without POSIX clocks where they're the
+ * process's CPU time (summed over threads) from clock().
+ * Batch loads ignore stats, and cache hits in n3dc_obj_load_cached leave them zeroed.
+ *
+ * Set skip_attributes to leave texture coords or normals out of a load that doesn't need them,
+ * e.g. for collision or shadow geometry. Their vt or vn lines are skipped like comments, nothing
+ * is allocated for them, and the returned texture_coords or normals are NULL (or zero in an
+ * interleaved buffer). Indexed output welds corners by the attributes that were kept, so it
+ * usually has fewer vertices. Normals can't be skipped when normal_mode generates them.
+ *
+ * Set build_bvh to also get a bounding volume hierarchy over the output triangles for ray queries
+ * and picking. It's built with binned SAH splits on up to num_threads threads as soon as the
+ * output is written, while the positions are still in cache, and it's saved in cache files along
+ * with the rest of the obj. The nodes are n3dc_obj_bvh_node_t's stored depth first, two to a
+ * cache line, and each leaf holds up to 8 triangles listed by number in bvh_triangles. The
+ * triangles themselves stay in their output order.
+ *
+ * Set load_materials along with record_submeshes to read the MTL files that the OBJ file's
+ * mtllib lines name, resolved against the OBJ file's directory (or the current directory for
+ * loads from memory). The obj's materials array gets every material of those files and each
+ * submesh's material_index points at the one its usemtl line names. MTL files are parsed into a
+ * material cache keyed by their resolved path, so objs that share a library (including batch and
+ * async loads on other threads) share its names and texture paths instead of parsing it again.
+ * The cache is locked while libraries are looked up and added, but files are parsed outside the
+ * lock, so threads that need the same library at the same time can both parse it, but only one
+ * copy is kept. If N3DC_OBJ_NO_THREADS is defined the cache has no lock, so loads with
+ * load_materials must not run on more than one thread at a time. An MTL file that can't be read
+ * just has no materials. The cache is allocated with malloc and lives until
+ * n3dc_obj_clear_material_cache. Cache files record the resolved library paths, and
+ * n3dc_obj_load_cached attaches the materials again when it uses one.
+ *
+ * The last step of a load copies each face corner's attributes from the parsed records into the
+ * output arrays. n3dc_obj_gather exposes that step for index arrays that come from elsewhere:
+ * output value i gets values[indices[i]], where each value is num_components (1 to 4) floats.
+ * Indices equal to N3DC_OBJ_MISSING_INDEX give zeros. An index that is num_values or more also
+ * gives zeros and makes the call return -1, but the other values are still written. The copy is
+ * split across up to num_threads threads, and loads split it across num_threads too. When the
+ * compiler targets AVX2, 2 and 3 component values are copied with AVX2 gathers.
+ *
  * Limitations:
- * - There is no support for MTL loading, even if the OBJ file specifies an MTL file.
- * - All geometry must be triangulated. This means that only face elements with 3 groups
- *   (e.g. "f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3") are supported. If your geometry isn't
- *   triangulated, you can check the "Triangulated Mesh" option in Blender when exporting
- *   to OBJ and Blender will automatically triangulate it for you.
- * - Each face element must specify a vertex index, texture index, and normal index. If your
- *   OBJ file is missing texture indices or normal indices, try exporting to OBJ from Blender
- *   with the "UV Coordinates" and "Normals" options checked.
+ * - MTL files are only read for their colors, scalars, and texture names. Texture options
+ *   (e.g. -bm or -o) are skipped by taking the last word of a map statement as its file name,
+ *   so texture names can't contain spaces.
+ * - Fan triangulation assumes faces are convex. Concave faces should be triangulated before
+ *   exporting, e.g. with the "Triangulated Mesh" option in Blender.
  * - Free-form geometry (e.g. NURBS) are not supported.
  *
  * Note: The full Apache 2.0 license can be found at the bottom of this file.
@@ -53,6 +219,8 @@
 #ifndef N3DC_OBJ_H
 #define N3DC_OBJ_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -61,14 +229,310 @@ extern "C" {
 #define N3DC_OBJ_VERSION_MINOR 1
 #define N3DC_OBJ_VERSION_PATCH 0
 
+// A range of indices (or of vertices for N3DC_OBJ_OUTPUT_DEINDEXED) whose faces share the same
+// object, group, and material. Names are NULL if no o, g, or usemtl line came before the faces.
+typedef struct
+{
+    unsigned int first_index;
+    unsigned int num_indices;
+    const char* object_name;
+    const char* group_name;
+    const char* material_name;
+    // Index into the obj's materials of the material named material_name, or
+    // N3DC_OBJ_MISSING_INDEX if materials weren't loaded or none of them has that name.
+    unsigned int material_index;
+    // Bounding box of the vertices used by the range's faces.
+    float bounds_min[3];
+    float bounds_max[3];
+} n3dc_obj_submesh_t;
+
+// A simplified version of an indexed mesh that draws from the same vertices. The LOD only uses
+// the first num_vertices vertices, so it can be drawn (or streamed) before the rest arrive.
+typedef struct
+{
+    float target_ratio;
+    unsigned int num_indices;
+    unsigned int* indices;
+    unsigned int num_vertices;
+} n3dc_obj_lod_t;
+
+// A node of a bounding volume hierarchy over a mesh's triangles. Nodes are stored depth first,
+// so a node's first child directly follows it, and each node takes half a cache line.
+typedef struct
+{
+    float bounds_min[3];
+    // For leaves, the position in bvh_triangles of the leaf's first triangle. For interior
+    // nodes, the index of the second child.
+    unsigned int offset;
+    float bounds_max[3];
+    // The number of triangles in a leaf, or 0 for interior nodes.
+    unsigned short num_triangles;
+    // For interior nodes, the axis (0, 1, or 2 for x, y, or z) that the children were split
+    // along. The first child holds the triangles on the lower side, so rays heading in the
+    // negative direction of the axis should visit the second child first.
+    unsigned short split_axis;
+} n3dc_obj_bvh_node_t;
+
+// A material from an MTL file. Colors that the file leaves out are black, dissolve and
+// index_of_refraction default to 1, and textures that it leaves out are NULL. Texture paths are
+// resolved against the MTL file's directory.
+typedef struct
+{
+    const char* name;
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float emissive[3];
+    float shininess;
+    // Opacity, from a d line or 1 minus a Tr line.
+    float dissolve;
+    float index_of_refraction;
+    unsigned int illumination_model;
+    const char* ambient_texture;
+    const char* diffuse_texture;
+    const char* specular_texture;
+    const char* emissive_texture;
+    const char* shininess_texture;
+    const char* dissolve_texture;
+    const char* bump_texture;
+} n3dc_obj_material_t;
+
 typedef struct 
 { 
     unsigned int num_vertices;
     float* vertices; 
     float* normals;
     float* texture_coords;
+    // Only set for N3DC_OBJ_OUTPUT_INDEXED, otherwise num_indices is 0 and indices is NULL.
+    unsigned int num_indices;
+    unsigned int* indices;
+    // Only set when a vertex_layout is requested, in which case vertices, normals, and
+    // texture_coords are NULL and each vertex is vertex_stride bytes of interleaved_vertices.
+    void* interleaved_vertices;
+    unsigned int vertex_stride;
+    // Only set when record_submeshes is requested, otherwise num_submeshes is 0 and submeshes
+    // is NULL.
+    unsigned int num_submeshes;
+    n3dc_obj_submesh_t* submeshes;
+    // Only set when LODs are requested, in which case there is one per ratio in lod_ratios.
+    unsigned int num_lods;
+    n3dc_obj_lod_t* lods;
+    // Only set when build_bvh is requested, in which case bvh_triangles holds the number of
+    // every triangle (its first index or vertex divided by 3) in the order the leaves use them.
+    // The root is bvh_nodes[0], and an obj without triangles has no nodes.
+    unsigned int num_bvh_nodes;
+    n3dc_obj_bvh_node_t* bvh_nodes;
+    unsigned int* bvh_triangles;
+    // Only set when load_materials is requested, in which case materials holds the materials of
+    // every MTL file named by the OBJ file's mtllib lines, in the order they're named. Their
+    // names and texture paths belong to the material cache.
+    unsigned int num_materials;
+    n3dc_obj_material_t* materials;
 } n3dc_obj_t;
 
+// How an attribute is stored in an interleaved vertex buffer.
+typedef enum
+{
+    // 32-bit floats.
+    N3DC_OBJ_FORMAT_FLOAT32 = 0,
+    // 16-bit half floats.
+    N3DC_OBJ_FORMAT_FLOAT16,
+    // 16-bit unsigned normalized integers, with values clamped to [0, 1]. Meant for texture coords.
+    N3DC_OBJ_FORMAT_UNORM16,
+    // Normals only. Two 8-bit or 16-bit signed normalized integers holding the normal's
+    // octahedral encoding.
+    N3DC_OBJ_FORMAT_OCT_SNORM8,
+    N3DC_OBJ_FORMAT_OCT_SNORM16
+} n3dc_obj_attribute_format_t;
+
+// Describes where each attribute of a vertex is written in an interleaved vertex buffer.
+// Offsets are in bytes from the start of the vertex, and attributes with a negative offset are
+// left out. Positions and normals have 3 components and texture coords have 2, stored as 32-bit
+// floats unless another format is given. For example, a float pos|normal|uv layout is
+// {32, 0, 12, 24}, and a half pos|oct normal|unorm16 uv layout is
+// {12, 0, 6, 8, N3DC_OBJ_FORMAT_FLOAT16, N3DC_OBJ_FORMAT_OCT_SNORM8, N3DC_OBJ_FORMAT_UNORM16}.
+typedef struct
+{
+    unsigned int stride;
+    int position_offset;
+    int normal_offset;
+    int texture_coord_offset;
+    n3dc_obj_attribute_format_t position_format;
+    n3dc_obj_attribute_format_t normal_format;
+    n3dc_obj_attribute_format_t texture_coord_format;
+} n3dc_obj_vertex_layout_t;
+
+typedef enum
+{
+    // Every face corner gets its own vertex, so the vertices form a triangle list.
+    N3DC_OBJ_OUTPUT_DEINDEXED = 0,
+    // Face corners with the same vertex, texture, and normal indices share a vertex, and the
+    // triangles are described by indices.
+    N3DC_OBJ_OUTPUT_INDEXED
+} n3dc_obj_output_mode_t;
+
+typedef enum
+{
+    // Normals come from the file. Face corners without a normal index get a zero normal.
+    N3DC_OBJ_NORMALS_FROM_FILE = 0,
+    // Face corners without a normal index get the area-weighted average of the normals of every
+    // face that uses the same vertex.
+    N3DC_OBJ_NORMALS_SMOOTH,
+    // Face corners without a normal index get the normal of their face.
+    N3DC_OBJ_NORMALS_FLAT
+} n3dc_obj_normal_mode_t;
+
+// Attributes that can be left out of a load with the options' skip_attributes. Positions are
+// always loaded.
+typedef enum
+{
+    N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS = 1 << 0,
+    N3DC_OBJ_ATTRIBUTE_NORMALS = 1 << 1
+} n3dc_obj_attribute_t;
+
+// Custom memory allocation callbacks. user_data is passed through to every callback.
+typedef struct
+{
+    void* (*allocate)(size_t size, void* user_data);
+    void* (*reallocate)(void* ptr, size_t old_size, size_t new_size, void* user_data);
+    void (*deallocate)(void* ptr, void* user_data);
+    void* user_data;
+} n3dc_obj_allocator_t;
+
+// Texture and normal indices that an index group leaves out are set to this. n3dc_obj_gather
+// gives zeros for it.
+#define N3DC_OBJ_MISSING_INDEX ((unsigned int)-1)
+
+// Number of records of each type in an OBJ file. num_indices is the number of face indices, which is
+// the value to pass as max_indices.
+typedef struct
+{
+    unsigned int num_vertices;
+    unsigned int num_texture_coords;
+    unsigned int num_normals;
+    unsigned int num_indices;
+} n3dc_obj_counts_t;
+
+// What a load spent its time and memory on, filled in when the options' stats is set. Everything
+// is zero unless the implementation was compiled with N3DC_OBJ_ENABLE_STATS.
+typedef struct
+{
+    // Seconds spent mapping or reading the file, counting records before parsing (count_first or
+    // num_threads above 1), parsing records, and building the output (deindexing, reordering,
+    // generating normals and LODs, and building BVHs).
+    double read_seconds;
+    double scan_seconds;
+    double parse_seconds;
+    double reorder_seconds;
+    unsigned long long bytes_processed;
+    // Number of v, vt, and vn records and of face indices after triangulation.
+    n3dc_obj_counts_t counts;
+    unsigned long long num_faces;
+    // Number of o, g, and usemtl lines.
+    unsigned long long num_submesh_lines;
+    // Number of lines that aren't parsed, such as comments, blank lines, and unsupported records.
+    unsigned long long num_skipped_lines;
+    // Most scratch memory (from the arena and the allocator) in use at once.
+    size_t peak_scratch_bytes;
+} n3dc_obj_stats_t;
+
+typedef enum
+{
+    N3DC_OBJ_ERROR_NONE = 0,
+    // A file couldn't be opened or read.
+    N3DC_OBJ_ERROR_FILE,
+    N3DC_OBJ_ERROR_OUT_OF_MEMORY,
+    // The options are inconsistent, e.g. a vertex layout whose attributes don't fit its stride.
+    N3DC_OBJ_ERROR_INVALID_OPTIONS,
+    // No longer reported, since the last line doesn't need a newline. Kept so that the codes after
+    // it keep their values.
+    N3DC_OBJ_ERROR_UNEXPECTED_END,
+    // A character that isn't part of a number, space, or newline was found in a record.
+    N3DC_OBJ_ERROR_INVALID_CHARACTER,
+    // A v, vt, or vn line has too few numbers, or a face has fewer than 3 index groups.
+    N3DC_OBJ_ERROR_MISSING_ELEMENT,
+    // An index in an index group is missing, 0, or doesn't fit in 32 bits.
+    N3DC_OBJ_ERROR_INVALID_INDEX,
+    // A face refers to a vertex, texture coord, or normal that the file doesn't have.
+    N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE,
+    // The file has more records than the max_* arguments allow for.
+    N3DC_OBJ_ERROR_TOO_MANY_VERTICES,
+    N3DC_OBJ_ERROR_TOO_MANY_TEXTURE_COORDS,
+    N3DC_OBJ_ERROR_TOO_MANY_NORMALS,
+    N3DC_OBJ_ERROR_TOO_MANY_INDICES,
+    // The interleaved vertices don't fit in the options' interleaved_buffer.
+    N3DC_OBJ_ERROR_BUFFER_TOO_SMALL,
+    // A thread or mutex couldn't be created.
+    N3DC_OBJ_ERROR_THREAD
+} n3dc_obj_error_code_t;
+
+// Why a load failed, filled in when the options' error is set.
+typedef struct
+{
+    n3dc_obj_error_code_t code;
+    // Byte offset into the OBJ data and 1-based line number where parsing failed. Both are 0 for
+    // failures that aren't tied to a place in the data, such as running out of memory.
+    size_t offset;
+    size_t line;
+} n3dc_obj_error_t;
+
+// Optional settings for n3dc_obj_load_with_options and n3dc_obj_load_from_memory_with_options.
+// A zero-initialized struct gives the same behavior as n3dc_obj_load.
+typedef struct
+{
+    // Number of threads to parse with. 0 or 1 parses on the calling thread.
+    unsigned int num_threads;
+    // If non-zero, the records are counted before parsing so that every buffer is allocated once
+    // at its exact size. The max_vertices, max_normals, and max_indices arguments are ignored.
+    int count_first;
+    n3dc_obj_output_mode_t output_mode;
+    // If non-zero and output_mode is N3DC_OBJ_OUTPUT_INDEXED, the triangles are reordered for
+    // the GPU's post-transform vertex cache and the vertices are stored in the order the
+    // triangles first use them.
+    int optimize_vertex_cache;
+    // Number of vertices the triangle reordering assumes the vertex cache holds. 0 uses 16.
+    unsigned int vertex_cache_size;
+    // If non-zero and output_mode is N3DC_OBJ_OUTPUT_INDEXED, num_lods simplified index buffers
+    // are generated with about lod_ratios[i] times the triangles of the full mesh. The ratios
+    // must be between 0 and 1 and decreasing.
+    unsigned int num_lods;
+    const float* lod_ratios;
+    // How to fill in the normals of face corners that don't have a normal index. Generated
+    // normals are computed on up to num_threads threads.
+    n3dc_obj_normal_mode_t normal_mode;
+    // If non-zero, o, g, and usemtl lines split the faces into submeshes, each with the range of
+    // indices it covers and the bounding box of its vertices.
+    int record_submeshes;
+    // If set, the vertices are written to a single interleaved buffer with this layout instead of
+    // separate vertices, normals, and texture_coords arrays.
+    const n3dc_obj_vertex_layout_t* vertex_layout;
+    // Optional caller-owned memory for the interleaved vertices, such as a mapped staging buffer.
+    // The load fails if the vertices need more than interleaved_buffer_size bytes. If NULL, the
+    // interleaved buffer is allocated and its padding bytes are zeroed.
+    void* interleaved_buffer;
+    size_t interleaved_buffer_size;
+    // Optional allocator for everything the load allocates, including the returned n3dc_obj_t.
+    // If NULL, malloc, realloc, and free are used.
+    const n3dc_obj_allocator_t* allocator;
+    // Optional caller-owned memory that the load's temporary arrays are carved out of. Nothing
+    // in it is needed once the load returns, so the same arena can be reused for every load.
+    // Temporary arrays that don't fit are allocated with the allocator instead.
+    void* scratch_arena;
+    size_t scratch_arena_size;
+    // Optional caller-owned stats that the load overwrites, even if it fails.
+    n3dc_obj_stats_t* stats;
+    // Optional caller-owned error that the load overwrites, with N3DC_OBJ_ERROR_NONE on success.
+    n3dc_obj_error_t* error;
+    // Bitwise OR of the n3dc_obj_attribute_t values to leave out. Their lines are skipped
+    // without being parsed and their output arrays are NULL.
+    unsigned int skip_attributes;
+    // If non-zero, a BVH over the output triangles is built on up to num_threads threads.
+    int build_bvh;
+    // If non-zero, the MTL files named by mtllib lines are loaded through the material cache and
+    // each submesh gets the index of its material. Requires record_submeshes.
+    int load_materials;
+} n3dc_obj_load_options_t;
+
 n3dc_obj_t* n3dc_obj_load(
     const char* path, 
     const unsigned int max_vertices, 
@@ -76,6 +540,163 @@ n3dc_obj_t* n3dc_obj_load(
     const unsigned int max_indices
 );
 
+n3dc_obj_t* n3dc_obj_load_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices
+);
+
+n3dc_obj_t* n3dc_obj_load_with_options(
+    const char* path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+n3dc_obj_t* n3dc_obj_load_from_memory_with_options(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+int n3dc_obj_load_batch(
+    const char* const* paths,
+    const size_t num_paths,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_t** objs
+);
+
+// Handle for a load started by n3dc_obj_load_async or n3dc_obj_load_from_memory_async.
+typedef struct n3dc_obj_async n3dc_obj_async_t;
+
+// Called on the loading thread when an asynchronous load finishes. obj is NULL if the load
+// failed. The callback must not free obj, it is also returned by n3dc_obj_async_wait.
+typedef void (*n3dc_obj_async_callback_t)(n3dc_obj_t* obj, void* user_data);
+
+n3dc_obj_async_t* n3dc_obj_load_async(
+    const char* path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_async_callback_t callback,
+    void* user_data
+);
+
+n3dc_obj_async_t* n3dc_obj_load_from_memory_async(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_async_callback_t callback,
+    void* user_data
+);
+
+int n3dc_obj_async_is_done(n3dc_obj_async_t* async);
+
+n3dc_obj_t* n3dc_obj_async_wait(n3dc_obj_async_t* async);
+
+void n3dc_obj_free(n3dc_obj_t* obj);
+
+int n3dc_obj_cache_write(const n3dc_obj_t* obj, const char* cache_path, const char* source_path);
+
+n3dc_obj_t* n3dc_obj_cache_load(const char* cache_path, const char* source_path);
+
+n3dc_obj_t* n3dc_obj_load_cached(
+    const char* path,
+    const char* cache_path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+// Frees every MTL file in the material cache. The materials of objs loaded before this call
+// must not be used after it, and it must not be called while loads with load_materials run.
+void n3dc_obj_clear_material_cache(void);
+
+// Incremental parser state for n3dc_obj_stream_begin/feed/end.
+typedef struct n3dc_obj_stream n3dc_obj_stream_t;
+
+n3dc_obj_stream_t* n3dc_obj_stream_begin(
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+int n3dc_obj_stream_feed(n3dc_obj_stream_t* stream, const char* chunk, const size_t chunk_length);
+
+n3dc_obj_t* n3dc_obj_stream_end(n3dc_obj_stream_t* stream);
+
+// A sequence of OBJ files with the same faces, such as the frames of a simulation, started by
+// n3dc_obj_sequence_begin or n3dc_obj_sequence_begin_from_memory.
+typedef struct n3dc_obj_sequence n3dc_obj_sequence_t;
+
+n3dc_obj_sequence_t* n3dc_obj_sequence_begin(
+    const char* path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+n3dc_obj_sequence_t* n3dc_obj_sequence_begin_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+);
+
+// Returns the first frame's mesh, which belongs to the sequence and is freed by
+// n3dc_obj_sequence_end.
+n3dc_obj_t* n3dc_obj_sequence_get_obj(const n3dc_obj_sequence_t* sequence);
+
+int n3dc_obj_sequence_load_frame(n3dc_obj_sequence_t* sequence, const char* path, float* positions);
+
+int n3dc_obj_sequence_load_frame_from_memory(
+    n3dc_obj_sequence_t* sequence,
+    const char* file_chars,
+    const size_t file_chars_length,
+    float* positions
+);
+
+void n3dc_obj_sequence_end(n3dc_obj_sequence_t* sequence);
+
+int n3dc_obj_count(const char* path, n3dc_obj_counts_t* counts);
+
+int n3dc_obj_count_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    n3dc_obj_counts_t* counts
+);
+
+int n3dc_obj_gather(
+    const float* values,
+    const unsigned int num_values,
+    const unsigned int num_components,
+    const unsigned int* indices,
+    const unsigned int num_indices,
+    float* ordered_values,
+    const unsigned int num_threads
+);
+
+// Returns a short English description of code, e.g. for logging.
+const char* n3dc_obj_get_error_message(const n3dc_obj_error_code_t code);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -86,507 +707,5953 @@ n3dc_obj_t* n3dc_obj_load(
 /* Start of implementation section. */
 #ifdef N3DC_OBJ_IMPLEMENTATION
 
-static unsigned int n3dc_obj_min_uint(unsigned int a, unsigned int b) { return (a < b) ? a : b; }
+// Platform headers for memory-mapped file input.
+#if !defined(N3DC_OBJ_NO_MMAP)
+    #if defined(_WIN32)
+        #define N3DC_OBJ_MMAP_WIN32
+        #ifndef WIN32_LEAN_AND_MEAN
+            #define WIN32_LEAN_AND_MEAN
+        #endif
+        #include <windows.h>
+    #elif defined(__unix__) || defined(__APPLE__)
+        #define N3DC_OBJ_MMAP_POSIX
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <unistd.h>
+    #endif
+#endif
+
+// Platform headers for file modification times and replacing cache files.
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <sys/stat.h>
+#endif
+
+// SIMD kernels for finding line endings 64 characters at a time.
+#if !defined(N3DC_OBJ_NO_SIMD)
+    #if defined(__AVX2__)
+        #define N3DC_OBJ_SIMD_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define N3DC_OBJ_SIMD_SSE2
+        #include <emmintrin.h>
+    #elif defined(__aarch64__) || defined(_M_ARM64)
+        #define N3DC_OBJ_SIMD_NEON
+        #include <arm_neon.h>
+    #endif
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+// Half float conversion for quantized vertex formats. MSVC doesn't define __F16C__ but every
+// AVX2 CPU has F16C.
+#if !defined(N3DC_OBJ_NO_SIMD) && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+    #define N3DC_OBJ_SIMD_F16C
+    #include <immintrin.h>
+#endif
+
+// Timers for load statistics. Windows uses QueryPerformanceCounter from <windows.h>.
+#if defined(N3DC_OBJ_ENABLE_STATS) && !defined(_WIN32)
+    #include <time.h>
+#endif
+
+// Platform headers for multithreaded parsing.
+#if !defined(N3DC_OBJ_NO_THREADS)
+    #if defined(_WIN32)
+        #define N3DC_OBJ_THREADS_WIN32
+        #ifndef WIN32_LEAN_AND_MEAN
+            #define WIN32_LEAN_AND_MEAN
+        #endif
+        #include <windows.h>
+    #elif defined(__unix__) || defined(__APPLE__)
+        #define N3DC_OBJ_THREADS_POSIX
+        #include <pthread.h>
+    #endif
+#endif
+// Least work that's given its own thread: bytes of OBJ data per parse chunk, and face corners or
+// triangles per output task. Tests can lower them to run the threaded paths on small files.
+#ifndef N3DC_OBJ_MIN_CHUNK_LENGTH
+    #define N3DC_OBJ_MIN_CHUNK_LENGTH (1 << 20)
+#endif
+#ifndef N3DC_OBJ_MIN_TASK_SIZE
+    #define N3DC_OBJ_MIN_TASK_SIZE (1 << 16)
+#endif
+
+// Prefetches the cache line at address for reading, for the gathers whose loads are random.
+#if defined(__GNUC__) || defined(__clang__)
+    #define N3DC_OBJ_PREFETCH(address) __builtin_prefetch((address), 0, 3)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define N3DC_OBJ_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+    #define N3DC_OBJ_PREFETCH(address) ((void)(address))
+#endif
+
+// Forces small kernels to be inlined so that they are specialized for their constant arguments.
+#if defined(__GNUC__) || defined(__clang__)
+    #define N3DC_OBJ_FORCE_INLINE __attribute__((always_inline)) inline
+#elif defined(_MSC_VER)
+    #define N3DC_OBJ_FORCE_INLINE __forceinline
+#else
+    #define N3DC_OBJ_FORCE_INLINE inline
+#endif
+
+// Error paths are marked cold so that the compiler lays them out away from the parsing loops.
+#if defined(__GNUC__) || defined(__clang__)
+    #define N3DC_OBJ_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+    #define N3DC_OBJ_COLD __declspec(noinline)
+#else
+    #define N3DC_OBJ_COLD
+#endif
+
+// Records code as the reason for a failure that isn't tied to a place in the OBJ data. Only the
+// first failure is kept, since later ones are usually caused by it. error can be NULL. Returns -1
+// so that error paths can return the result.
+static N3DC_OBJ_COLD int n3dc_obj_set_error(n3dc_obj_error_t* error, const n3dc_obj_error_code_t code)
+{
+    if(error && error->code == N3DC_OBJ_ERROR_NONE)
+    {
+        error->code = code;
+        error->offset = 0;
+        error->line = 0;
+    }
+    return -1;
+}
+
+// Records a parsing failure at offset into the characters being parsed. The line is set to 1 to
+// mark the error as placed, n3dc_obj_locate_error turns both into positions in the whole file.
+static N3DC_OBJ_COLD int n3dc_obj_set_parse_error(
+    n3dc_obj_error_t* error, const n3dc_obj_error_code_t code, const size_t offset
+){
+    if(error && error->code == N3DC_OBJ_ERROR_NONE)
+    {
+        error->code = code;
+        error->offset = offset;
+        error->line = 1;
+    }
+    return -1;
+}
+
+static size_t n3dc_obj_count_newlines(const char* chars, const size_t length)
+{
+    size_t num_newlines = 0;
+    for(size_t i = 0; i < length; i++) { num_newlines += chars[i] == '\n'; }
+    return num_newlines;
+}
+
+// Turns a parsing error's offset into chars into an offset and line in the whole file, given the
+// offset of chars in the file and the number of newlines before it.
+static N3DC_OBJ_COLD void n3dc_obj_locate_error(
+    n3dc_obj_error_t* error, const char* chars, const size_t chars_offset, const size_t newlines_before
+){
+    if(error->line == 0) { return; }
+    error->line = newlines_before + n3dc_obj_count_newlines(chars, error->offset) + 1;
+    error->offset += chars_offset;
+}
+
+// Copies error to the options' error, if there is one.
+static void n3dc_obj_report_error(const n3dc_obj_load_options_t* options, const n3dc_obj_error_t* error)
+{
+    if(options && options->error) { *options->error = *error; }
+}
+
+static void* n3dc_obj_allocate(const n3dc_obj_allocator_t* allocator, const size_t size)
+{
+    return allocator ? allocator->allocate(size, allocator->user_data) : malloc(size);
+}
+
+static void* n3dc_obj_reallocate(
+    const n3dc_obj_allocator_t* allocator, void* ptr, const size_t old_size, const size_t new_size
+){
+    return allocator 
+        ? allocator->reallocate(ptr, old_size, new_size, allocator->user_data) 
+        : realloc(ptr, new_size);
+}
+
+static void n3dc_obj_deallocate(const n3dc_obj_allocator_t* allocator, void* ptr)
+{
+    if(!ptr) { return; }
+    if(allocator) { allocator->deallocate(ptr, allocator->user_data); }
+    else { free(ptr); }
+}
+
+// Temporary allocations for a single load. Allocations are bumped out of the caller's arena while
+// it has room and come from the allocator after that.
+typedef struct
+{
+    const n3dc_obj_allocator_t* allocator;
+    unsigned char* arena;
+    size_t arena_size;
+    size_t arena_used;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    // Bytes currently handed out from the arena and the allocator, and the most there have been.
+    size_t bytes_in_use;
+    size_t peak_bytes;
+#endif
+} n3dc_obj_scratch_t;
+
+static void n3dc_obj_init_scratch(n3dc_obj_scratch_t* scratch, const n3dc_obj_load_options_t* options)
+{
+    memset(scratch, 0, sizeof(n3dc_obj_scratch_t));
+    if(!options) { return; }
+    scratch->allocator = options->allocator;
+    scratch->arena = (unsigned char*)options->scratch_arena;
+    scratch->arena_size = options->scratch_arena ? options->scratch_arena_size : 0;
+}
 
-static float n3dc_obj_string_section_to_float(long start, long end, const char* full_string)
+#if defined(N3DC_OBJ_ENABLE_STATS)
+static void n3dc_obj_add_scratch_bytes(n3dc_obj_scratch_t* scratch, const size_t size)
 {
-    unsigned int char_count = n3dc_obj_min_uint((unsigned int)(end - start), 10);
-    char string_section[char_count+1];
-    string_section[char_count] = '\0';
-    memcpy(string_section, &full_string[start], sizeof(char) * char_count);
-    return (float)atof(string_section);
+    scratch->bytes_in_use += size;
+    if(scratch->bytes_in_use > scratch->peak_bytes) { scratch->peak_bytes = scratch->bytes_in_use; }
 }
 
-static unsigned int n3dc_obj_string_section_to_uint(long start, long end, const char* full_string)
+// Seconds since an arbitrary point, for timing the phases of a load. Without CLOCK_MONOTONIC
+// (e.g. when <time.h> hides POSIX) this uses C11's timespec_get, which is wall time but not
+// monotonic, and only before C11 does it fall back to clock()'s processor time.
+static double n3dc_obj_get_seconds(void)
 {
-    unsigned int char_count = n3dc_obj_min_uint((unsigned int)(end - start), 10);
-    char string_section[char_count+1];
-    string_section[char_count] = '\0';
-    memcpy(string_section, &full_string[start], sizeof(char) * char_count);
-    return (unsigned)atoi(string_section);
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#elif defined(TIME_UTC)
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
 }
+#endif
 
-static int n3dc_obj_is_valid_vec_char(const char c)
+static void* n3dc_obj_scratch_allocate(n3dc_obj_scratch_t* scratch, const size_t size)
 {
-    switch(c)
+    // Keep arena allocations cache line aligned.
+    const size_t alignment = 64;
+    const size_t padding = (alignment - ((size_t)(scratch->arena + scratch->arena_used) & (alignment - 1))) & (alignment - 1);
+    if(scratch->arena && size <= scratch->arena_size - scratch->arena_used 
+        && padding <= scratch->arena_size - scratch->arena_used - size)
     {
-        case '-': return 1;
-        case '.': return 1;
-        case '0': return 1;
-        case '1': return 1;
-        case '2': return 1;
-        case '3': return 1;
-        case '4': return 1;
-        case '5': return 1;
-        case '6': return 1;
-        case '7': return 1;
-        case '8': return 1;
-        case '9': return 1;
-        default: return 0;
+        void* ptr = scratch->arena + scratch->arena_used + padding;
+        scratch->arena_used += padding + size;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+        n3dc_obj_add_scratch_bytes(scratch, padding + size);
+#endif
+        return ptr;
     }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    // Allocations outside the arena start with a header holding their size, so that freeing them
+    // can be counted. The header keeps the allocator's alignment.
+    if(size > (size_t)-1 - alignment) { return NULL; }
+    unsigned char* header = (unsigned char*)n3dc_obj_allocate(scratch->allocator, alignment + size);
+    if(!header) { return NULL; }
+    memcpy(header, &size, sizeof(size_t));
+    n3dc_obj_add_scratch_bytes(scratch, size);
+    return header + alignment;
+#else
+    return n3dc_obj_allocate(scratch->allocator, size > 0 ? size : 1);
+#endif
 }
 
-// Vertices and normals are both vec3's so they can be parsed with the same function.
-static int n3dc_obj_parse_obj_vec3(
-    const char* file_chars, const size_t file_chars_length, 
-    const size_t vec3_start, size_t* line_end, 
-    float* x, float* y, float* z
+static void n3dc_obj_scratch_deallocate(n3dc_obj_scratch_t* scratch, void* ptr)
+{
+    unsigned char* p = (unsigned char*)ptr;
+    if(scratch->arena && p >= scratch->arena && p < scratch->arena + scratch->arena_size) { return; }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    // Arena bytes stay in use until the load ends, so only allocator bytes are given back.
+    if(!p) { return; }
+    // Step back over the size header.
+    p -= 64;
+    size_t size = 0;
+    memcpy(&size, p, sizeof(size_t));
+    scratch->bytes_in_use -= size;
+#endif
+    n3dc_obj_deallocate(scratch->allocator, p);
+}
+
+static const double n3dc_obj_powers_of_10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int n3dc_obj_is_space(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static size_t n3dc_obj_skip_spaces(const char* file_chars, const size_t file_chars_length, size_t offset)
+{
+    while(offset < file_chars_length && n3dc_obj_is_space(file_chars[offset])) { offset++; }
+    return offset;
+}
+
+// Scans a decimal number (e.g. "-0.123456789" or "1.5e-3") directly out of the file characters
+// without copying it or depending on the current locale. On success the offset of the first
+// character after the number is written to number_end.
+static int n3dc_obj_scan_float(
+    const char* file_chars, const size_t file_chars_length,
+    const size_t number_start, size_t* number_end, float* value
 ){
-    unsigned int x_parsed = 0, y_parsed = 0;
-    size_t x_end = 0, y_end = 0, z_end = 0;
-    for(size_t i = vec3_start; i < file_chars_length; i++)
+    size_t i = number_start;
+    int negative = 0;
+    if(i < file_chars_length && (file_chars[i] == '-' || file_chars[i] == '+'))
+    {
+        negative = (file_chars[i] == '-');
+        i++;
+    }
+    // Up to 19 significant digits fit in the mantissa, any digits after that are too small
+    // to affect a float and only contribute to the exponent.
+    unsigned long long mantissa = 0;
+    unsigned int significant_digits = 0, digits = 0;
+    int exponent = 0;
+    for(; i < file_chars_length; i++)
     {
-        const char current_char = file_chars[i];
-        if(current_char == ' ')
+        const unsigned int digit = (unsigned int)(file_chars[i] - '0');
+        if(digit > 9) { break; }
+        if(significant_digits < 19)
         {
-            if(!x_parsed)
-            {
-                x_parsed = 1;
-                x_end = i;
-            }
-            else if(!y_parsed)
-            {
-                y_parsed = 1;
-                y_end = i;
-            }
+            mantissa = mantissa * 10 + digit;
+            significant_digits += (mantissa != 0);
         }
-        else if(current_char == '\n')
+        else { exponent++; }
+        digits++;
+    }
+    if(i < file_chars_length && file_chars[i] == '.')
+    {
+        for(i++; i < file_chars_length; i++)
         {
-            if(!x_parsed)
-            {
-                printf("Reached end of OBJ vertex/normal line without parsing the x element\n");
-                return -1;
-            }
-            else if(!y_parsed)
+            const unsigned int digit = (unsigned int)(file_chars[i] - '0');
+            if(digit > 9) { break; }
+            if(significant_digits < 19)
             {
-                printf("Reached end of OBJ vertex/normal line without parsing the y element\n");
-                return -1;
+                mantissa = mantissa * 10 + digit;
+                significant_digits += (mantissa != 0);
+                exponent--;
             }
-            z_end = i;
-            *x = n3dc_obj_string_section_to_float(vec3_start, x_end, file_chars);
-            *y = n3dc_obj_string_section_to_float(x_end, y_end, file_chars);
-            *z = n3dc_obj_string_section_to_float(y_end, z_end, file_chars);
-            *line_end = z_end;
-            return 0;
+            digits++;
         }
-        else if(!n3dc_obj_is_valid_vec_char(current_char))
+    }
+    if(digits == 0) { return -1; }
+    if(i < file_chars_length && (file_chars[i] == 'e' || file_chars[i] == 'E'))
+    {
+        size_t exponent_offset = i + 1;
+        int exponent_negative = 0;
+        if(exponent_offset < file_chars_length 
+            && (file_chars[exponent_offset] == '-' || file_chars[exponent_offset] == '+'))
         {
-            printf("Invalid character encountered when parsing OBJ vertex/normal: \'%c\'\n", current_char);
-            return -1;
+            exponent_negative = (file_chars[exponent_offset] == '-');
+            exponent_offset++;
+        }
+        int explicit_exponent = 0;
+        size_t exponent_digits = 0;
+        for(; exponent_offset < file_chars_length; exponent_offset++)
+        {
+            const unsigned int digit = (unsigned int)(file_chars[exponent_offset] - '0');
+            if(digit > 9) { break; }
+            if(explicit_exponent < 10000) { explicit_exponent = explicit_exponent * 10 + (int)digit; }
+            exponent_digits++;
+        }
+        // If there are no exponent digits then the 'e' isn't part of the number and is left
+        // for the caller to reject.
+        if(exponent_digits > 0)
+        {
+            exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+            i = exponent_offset;
         }
     }
-    printf("Reached end of OBJ file while parsing a vertex/normal\n");
-    return -1;
+
+    double result = (double)mantissa;
+    if(mantissa != 0)
+    {
+        // The exponent is capped at about +-10000, so these run at most a few hundred times.
+        // They can't stop early once the result overflows or underflows, since the exponent
+        // has to end up inside the powers of 10.
+        for(; exponent > 22; exponent -= 22) { result *= 1e22; }
+        for(; exponent < -22; exponent += 22) { result /= 1e22; }
+        if(exponent < 0) { result /= n3dc_obj_powers_of_10[-exponent]; }
+        else { result *= n3dc_obj_powers_of_10[exponent]; }
+    }
+    *value = (float)(negative ? -result : result);
+    *number_end = i;
+    return 0;
 }
 
-static int n3dc_obj_parse_obj_vec2(
-    const char* file_chars, const size_t file_chars_length, 
-    const size_t vec2_start, size_t* line_end, 
-    float* x, float* y
+static int n3dc_obj_scan_uint(
+    const char* file_chars, const size_t file_chars_length,
+    const size_t number_start, size_t* number_end, unsigned int* value
 ){
-    unsigned int x_parsed = 0;
-    size_t x_end = 0, y_end = 0;
-    for(size_t i = vec2_start; i < file_chars_length; i++)
+    unsigned long long result = 0;
+    size_t i = number_start;
+    for(; i < file_chars_length; i++)
     {
-        const char current_char = file_chars[i];
-        if(current_char == ' ')
-        {
-            x_parsed = 1;
-            x_end = i;
-        }
-        else if(current_char == '\n')
+        const unsigned int digit = (unsigned int)(file_chars[i] - '0');
+        if(digit > 9) { break; }
+        result = result * 10 + digit;
+        if(result > (unsigned long long)(unsigned int)-1) { return -1; }
+    }
+    if(i == number_start) { return -1; }
+    *value = (unsigned int)result;
+    *number_end = i;
+    return 0;
+}
+
+// Parses the space separated floats of a v/vt/vn line into elements. Lines can have more than
+// num_elements floats (e.g. the optional w element), the extra floats are validated and ignored.
+static int n3dc_obj_parse_obj_floats(
+    const char* file_chars, const size_t file_chars_length,
+    const size_t floats_start, size_t* line_end,
+    float* elements[], const unsigned int num_elements, n3dc_obj_error_t* error
+){
+    size_t offset = floats_start;
+    for(unsigned int i = 0; ; i++)
+    {
+        offset = n3dc_obj_skip_spaces(file_chars, file_chars_length, offset);
+        // The end of the data ends the last line like a newline would.
+        if(offset >= file_chars_length || file_chars[offset] == '\n')
         {
-            if(!x_parsed)
+            if(i < num_elements)
             {
-                printf("Reached end of OBJ texture coord line without parsing the x element\n");
-                return -1;
+                return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_MISSING_ELEMENT, offset);
             }
-            y_end = i;
-            *x = n3dc_obj_string_section_to_float(vec2_start, x_end, file_chars);
-            *y = n3dc_obj_string_section_to_float(x_end, y_end, file_chars);
-            *line_end = y_end;
+            *line_end = offset;
             return 0;
         }
-        else if(!n3dc_obj_is_valid_vec_char(current_char))
+        float extra_element = 0.0f;
+        float* element = (i < num_elements) ? elements[i] : &extra_element;
+        const size_t element_start = offset;
+        if(n3dc_obj_scan_float(file_chars, file_chars_length, offset, &offset, element))
         {
-            printf("Invalid character encountered while parsing OBJ texture coord: \'%c\'\n", current_char);
-            return -1;
+            return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_INVALID_CHARACTER, element_start);
+        }
+        if(offset < file_chars_length && !n3dc_obj_is_space(file_chars[offset]) && file_chars[offset] != '\n')
+        {
+            return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_INVALID_CHARACTER, offset);
         }
     }
-    printf("Reached end of OBJ file while parsing a texture coord\n");
-    return -1;
 }
 
+// Vertices and normals are both vec3's so they can be parsed with the same function.
+static int n3dc_obj_parse_obj_vec3(
+    const char* file_chars, const size_t file_chars_length, 
+    const size_t vec3_start, size_t* line_end, 
+    float* x, float* y, float* z, n3dc_obj_error_t* error
+){
+    float* elements[3] = {x, y, z};
+    return n3dc_obj_parse_obj_floats(
+        file_chars, file_chars_length, vec3_start, line_end, elements, 3, error
+    );
+}
+
+static int n3dc_obj_parse_obj_vec2(
+    const char* file_chars, const size_t file_chars_length, 
+    const size_t vec2_start, size_t* line_end, 
+    float* x, float* y, n3dc_obj_error_t* error
+){
+    float* elements[2] = {x, y};
+    return n3dc_obj_parse_obj_floats(
+        file_chars, file_chars_length, vec2_start, line_end, elements, 2, error
+    );
+}
+
+// num_records holds the number of vertices, texture coords, and normals parsed before the face,
+// which negative indices are resolved against.
 static int n3dc_obj_parse_obj_index_group(
     const char* file_chars, const size_t file_chars_length, 
     const size_t index_group_start, size_t* index_group_end,
-    unsigned int* vertex_index, unsigned int* texture_index, unsigned int* normal_index
+    unsigned int* vertex_index, unsigned int* texture_index, unsigned int* normal_index,
+    const unsigned int* num_records, n3dc_obj_error_t* error
 ){
     // OBJ index group format: "vertex_index/texture_index/normal_index", where each *_index
     // is 1-based index. Example: 12/2/17.
-    // texture_index and normal_index are optional, but we require all of our models to have them
-    // and throw an error if they don't.
-    unsigned int vertex_index_parsed = 0, texture_index_parsed = 0;
-    size_t vertex_index_end = 0, texture_index_end = 0, normal_index_end = 0;
-    for(size_t i = index_group_start; i < file_chars_length; i++)
+    // texture_index and normal_index are optional, so "12", "12/2", and "12//17" are also valid.
+    // Negative indices count back from the last record parsed, so -1/-1/-1 is the most recent
+    // vertex, texture coord, and normal.
+    // Missing indices are set to N3DC_OBJ_MISSING_INDEX.
+    unsigned int* indices[3] = {vertex_index, texture_index, normal_index};
+    *texture_index = N3DC_OBJ_MISSING_INDEX;
+    *normal_index = N3DC_OBJ_MISSING_INDEX;
+    size_t offset = n3dc_obj_skip_spaces(file_chars, file_chars_length, index_group_start);
+    for(unsigned int i = 0; i < 3; i++)
     {
-        const char current_char = file_chars[i];
-        if(current_char == '/')
+        if(i > 0)
         {
-            if(!vertex_index_parsed)
-            {
-                vertex_index_parsed = 1;
-                vertex_index_end = i;
-            }
-            else if(!texture_index_parsed)
-            {
-                texture_index_parsed = 1;
-                texture_index_end = i;
-            }
+            if(offset >= file_chars_length || file_chars[offset] != '/') { break; }
+            offset++;
+            // The texture index can be left empty ("12//17") but the normal index can't.
+            if(i == 1 && offset < file_chars_length && file_chars[offset] == '/') { continue; }
         }
-        else if((current_char == ' ' || current_char == '\n') && vertex_index_parsed)
+        // OBJ indices are 1-based so if we get back a 0 index then we know something is wrong.
+        // If the index is valid then we subtract 1 to make it 0-based.
+        const size_t index_start = offset;
+        const int is_relative = offset < file_chars_length && file_chars[offset] == '-';
+        if(is_relative) { offset++; }
+        if(n3dc_obj_scan_uint(file_chars, file_chars_length, offset, &offset, indices[i]) || *indices[i] == 0)
         {
-            normal_index_end = i;
-            if(!texture_index_parsed)
-            {
-                printf("Reached end of OBJ index group without parsing the texture index\n");
-                return -1;
-            }
-            // OBJ indices are 1-based so if we get back a 0 index then we know something is wrong.
-            // If the index is valid then we subtract 1 to make it 0-based.
-            *vertex_index = n3dc_obj_string_section_to_uint(index_group_start, vertex_index_end, file_chars);
-            if(*vertex_index == 0)
-            {
-                printf("Vertex index of OBJ index group was either missing or invalid\n");
-                return -1;
-            }
-            (*vertex_index)--;
-            // Add 1 to the last index end to get the next index's start position.
-            // This is so that next index doesn't start with a '/' which would be converted into 0 by atoi().
-            *texture_index = n3dc_obj_string_section_to_uint(vertex_index_end+1, texture_index_end, file_chars);
-            if(*texture_index == 0)
-            {
-                printf("Texture index of OBJ index group was either missing or invalid\n");
-                return -1;
-            }
-            (*texture_index)--;
-            *normal_index = n3dc_obj_string_section_to_uint(texture_index_end+1, normal_index_end, file_chars);
-            if(*normal_index == 0)
-            {
-                printf("Normal index of OBJ index group was either missing or invalid\n");
-                return -1;
-            }
-            (*normal_index)--;
-            *index_group_end = normal_index_end;
-            return 0;
+            return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_INVALID_INDEX, index_start);
+        }
+        if(!is_relative) { (*indices[i])--; }
+        else if(*indices[i] > num_records[i])
+        {
+            return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE, index_start);
         }
+        else { *indices[i] = num_records[i] - *indices[i]; }
     }
-    printf("Reached end of OBJ file while parsing an index group\n");
-    return -1;
+    if(offset < file_chars_length && !n3dc_obj_is_space(file_chars[offset]) && file_chars[offset] != '\n')
+    {
+        return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_INVALID_CHARACTER, offset);
+    }
+    *index_group_end = offset;
+    return 0;
 }
 
+// Parses the index groups of a face and fan-triangulates them into the index arrays, so a face
+// with n groups adds (n - 2) * 3 indices starting at *num_indices. texture_indices and
+// normal_indices can be NULL to leave those indices out. num_records is passed through to
+// n3dc_obj_parse_obj_index_group.
 static int n3dc_obj_parse_obj_face(
     const char* file_chars, const size_t file_chars_length, 
     const size_t face_start, size_t* line_end,
-    unsigned int* vertex_index_1, unsigned int* texture_index_1, unsigned int* normal_index_1,
-    unsigned int* vertex_index_2, unsigned int* texture_index_2, unsigned int* normal_index_2,
-    unsigned int* vertex_index_3, unsigned int* texture_index_3, unsigned int* normal_index_3
+    unsigned int* vertex_indices, unsigned int* texture_indices, unsigned int* normal_indices,
+    unsigned int* num_indices, const unsigned int max_indices, 
+    const unsigned int* num_records, n3dc_obj_error_t* error
 ){
-    unsigned int index_group_1_parsed = 0, index_group_2_parsed = 0;
-    size_t current_char_offset = face_start;
-    int error = 0;
-    while(current_char_offset < file_chars_length)
+    unsigned int first_group[3] = {0, 0, 0};
+    unsigned int previous_group[3] = {0, 0, 0};
+    size_t offset = face_start;
+    for(unsigned int i = 0; ; i++)
     {
-        size_t index_group_end = current_char_offset;
-        if(!index_group_1_parsed)
-        {
-            error = n3dc_obj_parse_obj_index_group(
-                file_chars, file_chars_length, 
-                current_char_offset, &index_group_end,
-                vertex_index_1, texture_index_1, normal_index_1
-            );
-            index_group_1_parsed = 1;
-        }
-        else if(!index_group_2_parsed)
+        offset = n3dc_obj_skip_spaces(file_chars, file_chars_length, offset);
+        if(offset >= file_chars_length || file_chars[offset] == '\n')
         {
-            error = n3dc_obj_parse_obj_index_group(
-                file_chars, file_chars_length,
-                current_char_offset, &index_group_end,
-                vertex_index_2, texture_index_2, normal_index_2
-            );
-            index_group_2_parsed = 1;
+            if(i < 3)
+            {
+                return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_MISSING_ELEMENT, offset);
+            }
+            *line_end = offset;
+            return 0;
         }
-        else
+        unsigned int group[3];
+        const size_t group_start = offset;
+        if(n3dc_obj_parse_obj_index_group(
+            file_chars, file_chars_length, offset, &offset, &group[0], &group[1], &group[2], num_records, error
+        )){
+            return -1;
+        }
+        if(i == 0) { memcpy(first_group, group, sizeof(group)); }
+        else if(i >= 2)
         {
-            error = n3dc_obj_parse_obj_index_group(
-                file_chars, file_chars_length, 
-                current_char_offset, &index_group_end, 
-                vertex_index_3, texture_index_3, normal_index_3
-            );
-            if(file_chars[index_group_end] != '\n')
+            if(*num_indices + 3 > max_indices)
             {
-                printf(
-                    "%s %s %s\n",
-                    "Parsed 3 OBJ index groups in current face without reaching a newline,",
-                    "the OBJ file may have non-triangulated geometry which is not supported",
-                    "by this program, or the OBJ file may be corrupted"
-                );
-                return -1;
+                return n3dc_obj_set_parse_error(error, N3DC_OBJ_ERROR_TOO_MANY_INDICES, group_start);
+            }
+            const unsigned int* triangle[3] = {first_group, previous_group, group};
+            for(unsigned int j = 0; j < 3; j++)
+            {
+                vertex_indices[*num_indices] = triangle[j][0];
+                if(texture_indices) { texture_indices[*num_indices] = triangle[j][1]; }
+                if(normal_indices) { normal_indices[*num_indices] = triangle[j][2]; }
+                (*num_indices)++;
             }
-            *line_end = index_group_end;
-            return 0;
         }
-
-        if(error) { break; }
-        current_char_offset = index_group_end;
+        memcpy(previous_group, group, sizeof(group));
     }
-    // Only print the end of file error if there was no other error that cause the loop to break.
-    if(!error)
+}
+
+#if defined(N3DC_OBJ_SIMD_AVX2) || defined(N3DC_OBJ_SIMD_SSE2) || defined(N3DC_OBJ_SIMD_NEON)
+#define N3DC_OBJ_SIMD
+static unsigned int n3dc_obj_count_trailing_zeros(unsigned long long mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward64(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctzll(mask);
+#endif
+}
+
+// Returns a mask where bit i is set if block[i] is a newline. block must have at least 64
+// readable characters.
+static unsigned long long n3dc_obj_newline_mask_64(const char* block)
+{
+#if defined(N3DC_OBJ_SIMD_AVX2)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i chars_0 = _mm256_loadu_si256((const __m256i*)block);
+    const __m256i chars_1 = _mm256_loadu_si256((const __m256i*)(block + 32));
+    const unsigned int mask_0 = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars_0, newline));
+    const unsigned int mask_1 = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars_1, newline));
+    return (unsigned long long)mask_0 | ((unsigned long long)mask_1 << 32);
+#elif defined(N3DC_OBJ_SIMD_SSE2)
+    const __m128i newline = _mm_set1_epi8('\n');
+    unsigned long long mask = 0;
+    for(unsigned int i = 0; i < 4; i++)
     {
-        printf("Reached end of OBJ file while parsing a face\n");
+        const __m128i chars = _mm_loadu_si128((const __m128i*)(block + i * 16));
+        const unsigned int lane_mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline));
+        mask |= (unsigned long long)lane_mask << (i * 16);
     }
-    return -1;
+    return mask;
+#elif defined(N3DC_OBJ_SIMD_NEON)
+    // NEON has no movemask, so weight each matching lane by its bit position and add adjacent
+    // lanes together until each byte holds the mask for 8 characters.
+    static const uint8_t lane_bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bits = vld1q_u8(lane_bits);
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t mask_0 = vandq_u8(vceqq_u8(vld1q_u8((const uint8_t*)block), newline), bits);
+    const uint8x16_t mask_1 = vandq_u8(vceqq_u8(vld1q_u8((const uint8_t*)(block + 16)), newline), bits);
+    const uint8x16_t mask_2 = vandq_u8(vceqq_u8(vld1q_u8((const uint8_t*)(block + 32)), newline), bits);
+    const uint8x16_t mask_3 = vandq_u8(vceqq_u8(vld1q_u8((const uint8_t*)(block + 48)), newline), bits);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(mask_0, mask_1), vpaddq_u8(mask_2, mask_3));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#endif
 }
+#endif
 
-static int n3dc_obj_seek_end_of_line(
+// Finds the first newline at or after start_offset. Returns 1 if a newline was found, 0 otherwise.
+static int n3dc_obj_seek_newline(
     const char* file_chars, const size_t file_chars_length, 
-    const size_t start_offset, size_t* line_end 
+    const size_t start_offset, size_t* newline_offset
 ){
-    for(size_t i = start_offset; start_offset < file_chars_length; i++)
+    size_t i = start_offset;
+#if defined(N3DC_OBJ_SIMD)
+    for(; i + 64 <= file_chars_length; i += 64)
+    {
+        const unsigned long long newline_mask = n3dc_obj_newline_mask_64(&file_chars[i]);
+        if(newline_mask)
+        {
+            *newline_offset = i + n3dc_obj_count_trailing_zeros(newline_mask);
+            return 1;
+        }
+    }
+#endif
+    for(; i < file_chars_length; i++)
     {
         if(file_chars[i] == '\n')
         {
-            *line_end = i;
-            return 0;
+            *newline_offset = i;
+            return 1;
         }
     }
-    printf("Reached end of file while seeking end of line\n");
-    return -1;
+    return 0;
 }
 
-static int n3dc_obj_read_text_file(const char* file_path, char** file_chars, long* file_length)
-{
-    FILE* fp = fopen(file_path, "r");
-    if(!fp)
+// Finds the end of the line that start_offset is in, which is the end of the data if the last line
+// doesn't end with a newline.
+static void n3dc_obj_seek_end_of_line(
+    const char* file_chars, const size_t file_chars_length, 
+    const size_t start_offset, size_t* line_end
+){
+    if(!n3dc_obj_seek_newline(file_chars, file_chars_length, start_offset, line_end))
     {
-        fprintf(stderr, "Could not open %s\n", file_path);
-        return -1;
+        *line_end = file_chars_length;
     }
-    fseek(fp, 0, SEEK_END);
-    *file_length = ftell(fp);
-    rewind(fp);
-    *file_chars = (char*)malloc(sizeof(char) * (*file_length + 1));
-    if(!file_chars)
+}
+
+static int n3dc_obj_read_text_file(
+    const char* file_path, const n3dc_obj_allocator_t* allocator, char** file_chars, long* file_length,
+    n3dc_obj_error_t* error
+){
+    // Read in binary mode so that the length matches the characters actually read.
+    FILE* fp = fopen(file_path, "rb");
+    if(!fp) { return n3dc_obj_set_error(error, N3DC_OBJ_ERROR_FILE); }
+    // Only a regular file's length can be trusted. Pipes and FIFOs can't be seeked, and some
+    // systems open directories and give a nonsense length for them, so those are read in growing
+    // pieces instead (which fails for a directory).
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat file_stat;
+    const int is_regular = !stat(file_path, &file_stat) && S_ISREG(file_stat.st_mode);
+#else
+    const int is_regular = 1;
+#endif
+    long length = -1;
+    if(is_regular && !fseek(fp, 0, SEEK_END))
+    {
+        length = ftell(fp);
+        if(fseek(fp, 0, SEEK_SET)) { length = -1; }
+    }
+    size_t capacity = length >= 0 ? (size_t)length + 1 : 1 << 16;
+    char* chars = (char*)n3dc_obj_allocate(allocator, capacity);
+    size_t size = 0;
+    while(chars)
+    {
+        size += fread(&chars[size], sizeof(char), capacity - 1 - size, fp);
+        if(ferror(fp)) { break; }
+        if(size < capacity - 1) { break; }
+        // The buffer is full, so only grow it if there's more to read.
+        const int c = getc(fp);
+        if(c == EOF) { break; }
+        char* grown = (char*)n3dc_obj_reallocate(allocator, chars, capacity, capacity * 2);
+        if(!grown) { n3dc_obj_deallocate(allocator, chars); }
+        chars = grown;
+        capacity *= 2;
+        if(chars) { chars[size++] = (char)c; }
+    }
+    if(!chars)
     {
-        fprintf(stderr, "Could not allocate memory for reading %s\n", file_path);
         fclose(fp);
-        return -1;
+        return n3dc_obj_set_error(error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+    }
+    if(ferror(fp))
+    {
+        n3dc_obj_deallocate(allocator, chars);
+        fclose(fp);
+        return n3dc_obj_set_error(error, N3DC_OBJ_ERROR_FILE);
     }
-    size_t read_size = fread(*file_chars, sizeof(char), *file_length, fp);
-    (*file_chars)[read_size] = '\0';
     fclose(fp);
+    chars[size] = '\0';
+    *file_chars = chars;
+    *file_length = (long)size;
     return 0;
 }
 
-n3dc_obj_t* n3dc_obj_load(
-    const char* path, 
-    const unsigned int max_vertices, 
-    const unsigned int max_normals,
-    const unsigned int max_indices
+// A read-only view of an OBJ file's contents. The view is either backed by a memory mapping
+// of the file or, when mapping isn't available, by a heap buffer from n3dc_obj_read_text_file.
+typedef struct
+{
+    const char* chars;
+    size_t length;
+    char* heap_chars;
+    const n3dc_obj_allocator_t* allocator;
+#if defined(N3DC_OBJ_MMAP_WIN32)
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#endif
+} n3dc_obj_file_view_t;
+
+// Maps a file read-only, or copy-on-write if copy_on_write is set so that the view's characters
+// can be modified without changing the file.
+static int n3dc_obj_map_file(
+    const char* file_path, const n3dc_obj_allocator_t* allocator, 
+    const int copy_on_write, n3dc_obj_file_view_t* view, n3dc_obj_error_t* error
 ){
-    char* file_chars = NULL;
+    memset(view, 0, sizeof(n3dc_obj_file_view_t));
+    view->allocator = allocator;
+#if defined(N3DC_OBJ_MMAP_POSIX)
+    const int fd = open(file_path, O_RDONLY);
+    if(fd >= 0)
+    {
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0)
+        {
+            const size_t length = (size_t)file_stat.st_size;
+            const int protection = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+            void* mapping = mmap(NULL, length, protection, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED)
+            {
+#if defined(POSIX_MADV_SEQUENTIAL)
+                // The parser makes a single forward pass so let the kernel read ahead aggressively.
+                posix_madvise(mapping, length, POSIX_MADV_SEQUENTIAL);
+#endif
+                close(fd);
+                view->chars = (const char*)mapping;
+                view->length = length;
+                return 0;
+            }
+        }
+        close(fd);
+    }
+#elif defined(N3DC_OBJ_MMAP_WIN32)
+    HANDLE file_handle = CreateFileA(
+        file_path, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL
+    );
+    if(file_handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        if(GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0)
+        {
+            const DWORD protection = copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY;
+            HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, protection, 0, 0, NULL);
+            if(mapping_handle)
+            {
+                const DWORD access = copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ;
+                void* mapping = MapViewOfFile(mapping_handle, access, 0, 0, 0);
+                if(mapping)
+                {
+                    view->chars = (const char*)mapping;
+                    view->length = (size_t)file_size.QuadPart;
+                    view->file_handle = file_handle;
+                    view->mapping_handle = mapping_handle;
+                    return 0;
+                }
+                CloseHandle(mapping_handle);
+            }
+        }
+        CloseHandle(file_handle);
+    }
+#else
+    (void)copy_on_write;
+#endif
+    // Fall back to reading the whole file into a heap buffer.
     long file_length = 0;
-    const int file_read_error = n3dc_obj_read_text_file(path, &file_chars, &file_length);
-    if(file_read_error) 
-    { 
-        free(file_chars);
-        return NULL;
+    if(n3dc_obj_read_text_file(file_path, allocator, &view->heap_chars, &file_length, error))
+    {
+        n3dc_obj_deallocate(allocator, view->heap_chars);
+        view->heap_chars = NULL;
+        return -1;
     }
-    const size_t file_chars_length = (size_t)file_length;
-    size_t current_char_offset = 1;
-    
-    float* vertices = (float*)malloc(sizeof(float) * max_vertices * 3);
-    unsigned int vertex_offset = 0;
-    unsigned int parsed_vertices = 0;
-    
-    float* texture_coords = (float*)malloc(sizeof(float) * max_indices * 2);
-    unsigned int texture_coord_offset = 0;
-    unsigned int parsed_texture_coords = 0;
-
-    float* normals = (float*)malloc(sizeof(float) * max_normals * 3);
-    unsigned int normal_offset = 0;
-    unsigned int parsed_normals = 0;
-
-    const size_t indices_size = sizeof(unsigned int) * max_indices;
-    unsigned int* vertex_indices = (unsigned int*)malloc(indices_size);
-    unsigned int* texture_indices = (unsigned int*)malloc(indices_size); 
-    unsigned int* normal_indices = (unsigned int*)malloc(indices_size); 
-    unsigned int parsed_indices = 0;
-    unsigned int index_offset = 0;
-    
-    int error = 0;
-    while(current_char_offset < file_chars_length)
+    view->chars = view->heap_chars;
+    view->length = (size_t)file_length;
+    return 0;
+}
+
+static int n3dc_obj_map_text_file(
+    const char* file_path, const n3dc_obj_allocator_t* allocator, n3dc_obj_file_view_t* view,
+    n3dc_obj_error_t* error
+){
+    return n3dc_obj_map_file(file_path, allocator, 0, view, error);
+}
+
+static void n3dc_obj_unmap_text_file(n3dc_obj_file_view_t* view)
+{
+    if(view->heap_chars)
+    {
+        n3dc_obj_deallocate(view->allocator, view->heap_chars);
+    }
+#if defined(N3DC_OBJ_MMAP_POSIX)
+    else if(view->chars)
+    {
+        munmap((void*)view->chars, view->length);
+    }
+#elif defined(N3DC_OBJ_MMAP_WIN32)
+    else if(view->chars)
+    {
+        UnmapViewOfFile(view->chars);
+        CloseHandle(view->mapping_handle);
+        CloseHandle(view->file_handle);
+    }
+#endif
+    memset(view, 0, sizeof(n3dc_obj_file_view_t));
+}
+
+// Asks the kernel to start reading a mapped file in the background so that it is already in
+// memory by the time it is parsed.
+static void n3dc_obj_prefetch_file_view(const n3dc_obj_file_view_t* view)
+{
+#if defined(N3DC_OBJ_MMAP_POSIX) && defined(POSIX_MADV_WILLNEED)
+    if(!view->heap_chars && view->chars)
+    {
+        posix_madvise((void*)view->chars, view->length, POSIX_MADV_WILLNEED);
+    }
+#else
+    (void)view;
+#endif
+}
+
+#if defined(N3DC_OBJ_THREADS_POSIX) || defined(N3DC_OBJ_THREADS_WIN32)
+#define N3DC_OBJ_THREADS
+typedef struct
+{
+#if defined(N3DC_OBJ_THREADS_POSIX)
+    pthread_t handle;
+#else
+    HANDLE handle;
+#endif
+    void (*function)(void*);
+    void* argument;
+} n3dc_obj_thread_t;
+
+#if defined(N3DC_OBJ_THREADS_POSIX)
+static void* n3dc_obj_thread_entry(void* thread)
+{
+    ((n3dc_obj_thread_t*)thread)->function(((n3dc_obj_thread_t*)thread)->argument);
+    return NULL;
+}
+#else
+static DWORD WINAPI n3dc_obj_thread_entry(LPVOID thread)
+{
+    ((n3dc_obj_thread_t*)thread)->function(((n3dc_obj_thread_t*)thread)->argument);
+    return 0;
+}
+#endif
+
+static int n3dc_obj_thread_create(n3dc_obj_thread_t* thread, void (*function)(void*), void* argument)
+{
+    thread->function = function;
+    thread->argument = argument;
+#if defined(N3DC_OBJ_THREADS_POSIX)
+    return pthread_create(&thread->handle, NULL, n3dc_obj_thread_entry, thread) ? -1 : 0;
+#else
+    thread->handle = CreateThread(NULL, 0, n3dc_obj_thread_entry, thread, 0, NULL);
+    return thread->handle ? 0 : -1;
+#endif
+}
+
+static void n3dc_obj_thread_join(n3dc_obj_thread_t* thread)
+{
+#if defined(N3DC_OBJ_THREADS_POSIX)
+    pthread_join(thread->handle, NULL);
+#else
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#endif
+}
+
+#if defined(N3DC_OBJ_THREADS_POSIX)
+typedef pthread_mutex_t n3dc_obj_mutex_t;
+#define N3DC_OBJ_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+static int n3dc_obj_mutex_init(n3dc_obj_mutex_t* mutex) { return pthread_mutex_init(mutex, NULL) ? -1 : 0; }
+static void n3dc_obj_mutex_lock(n3dc_obj_mutex_t* mutex) { pthread_mutex_lock(mutex); }
+static void n3dc_obj_mutex_unlock(n3dc_obj_mutex_t* mutex) { pthread_mutex_unlock(mutex); }
+static void n3dc_obj_mutex_destroy(n3dc_obj_mutex_t* mutex) { pthread_mutex_destroy(mutex); }
+#else
+typedef SRWLOCK n3dc_obj_mutex_t;
+#define N3DC_OBJ_MUTEX_INITIALIZER SRWLOCK_INIT
+static int n3dc_obj_mutex_init(n3dc_obj_mutex_t* mutex) { InitializeSRWLock(mutex); return 0; }
+static void n3dc_obj_mutex_lock(n3dc_obj_mutex_t* mutex) { AcquireSRWLockExclusive(mutex); }
+static void n3dc_obj_mutex_unlock(n3dc_obj_mutex_t* mutex) { ReleaseSRWLockExclusive(mutex); }
+static void n3dc_obj_mutex_destroy(n3dc_obj_mutex_t* mutex) { (void)mutex; }
+#endif
+#endif
+
+typedef enum
+{
+    N3DC_OBJ_LINE_OTHER = 0,
+    N3DC_OBJ_LINE_VERTEX,
+    N3DC_OBJ_LINE_TEXTURE_COORD,
+    N3DC_OBJ_LINE_NORMAL,
+    N3DC_OBJ_LINE_FACE,
+    N3DC_OBJ_LINE_OBJECT,
+    N3DC_OBJ_LINE_GROUP,
+    N3DC_OBJ_LINE_MATERIAL,
+    N3DC_OBJ_LINE_MATERIAL_LIBRARY
+} n3dc_obj_line_type_t;
+
+// Classifies a line by its leading keyword. Apart from usemtl and mtllib lines, only the
+// characters at line_start, line_start+1, and line_start+2 are looked at so this is cheap enough
+// to run on every line.
+static n3dc_obj_line_type_t n3dc_obj_get_line_type(
+    const char* file_chars, const size_t file_chars_length, const size_t line_start
+){
+    const char c0 = file_chars[line_start];
+    const char c1 = (line_start + 1 < file_chars_length) ? file_chars[line_start + 1] : '\n';
+    if(c0 == 'v')
+    {
+        if(n3dc_obj_is_space(c1)) { return N3DC_OBJ_LINE_VERTEX; }
+        const char c2 = (line_start + 2 < file_chars_length) ? file_chars[line_start + 2] : '\n';
+        if(c1 == 't' && n3dc_obj_is_space(c2)) { return N3DC_OBJ_LINE_TEXTURE_COORD; }
+        if(c1 == 'n' && n3dc_obj_is_space(c2)) { return N3DC_OBJ_LINE_NORMAL; }
+    }
+    else if(c0 == 'f' && n3dc_obj_is_space(c1)) { return N3DC_OBJ_LINE_FACE; }
+    // A g line without a name switches back to the default group.
+    else if(c0 == 'o' && (n3dc_obj_is_space(c1) || c1 == '\n')) { return N3DC_OBJ_LINE_OBJECT; }
+    else if(c0 == 'g' && (n3dc_obj_is_space(c1) || c1 == '\n')) { return N3DC_OBJ_LINE_GROUP; }
+    else if(c0 == 'u' && line_start + 6 < file_chars_length 
+        && !memcmp(&file_chars[line_start], "usemtl", 6) && n3dc_obj_is_space(file_chars[line_start + 6]))
+    {
+        return N3DC_OBJ_LINE_MATERIAL;
+    }
+    else if(c0 == 'm' && line_start + 6 < file_chars_length 
+        && !memcmp(&file_chars[line_start], "mtllib", 6) && n3dc_obj_is_space(file_chars[line_start + 6]))
+    {
+        return N3DC_OBJ_LINE_MATERIAL_LIBRARY;
+    }
+    return N3DC_OBJ_LINE_OTHER;
+}
+
+// Returns the number of indices a face adds once it is fan-triangulated. Index groups are
+// counted as runs of non-space characters, which matches what n3dc_obj_parse_obj_face parses.
+static unsigned int n3dc_obj_count_face_indices(
+    const char* file_chars, const size_t file_chars_length, const size_t face_start
+){
+    unsigned int num_groups = 0;
+    int in_group = 0;
+    for(size_t i = face_start; i < file_chars_length && file_chars[i] != '\n'; i++)
+    {
+        const int is_space = n3dc_obj_is_space(file_chars[i]);
+        if(!is_space && !in_group) { num_groups++; }
+        in_group = !is_space;
+    }
+    return num_groups >= 3 ? (num_groups - 2) * 3 : 0;
+}
+
+// Returns the offset of the vertex (0), texture (1), or normal (2) index of a face's groupth index
+// group, given the face line's start and end. A face's kth triangle is made of its groups 0, k + 1,
+// and k + 2.
+static size_t n3dc_obj_find_face_index(
+    const char* file_chars, const size_t line_start, const size_t line_end,
+    const unsigned int group, const unsigned int attribute
+){
+    // Skip over the f character.
+    size_t offset = line_start + 1;
+    for(unsigned int i = 0; ; i++)
+    {
+        offset = n3dc_obj_skip_spaces(file_chars, line_end, offset);
+        if(i == group) { break; }
+        while(offset < line_end && !n3dc_obj_is_space(file_chars[offset])) { offset++; }
+    }
+    // Step over the slashes in front of the texture or normal index.
+    for(unsigned int i = 0; i < attribute; i++)
+    {
+        while(offset < line_end && file_chars[offset] != '/') { offset++; }
+        offset++;
+    }
+    return offset;
+}
+
+static void n3dc_obj_count_line(
+    const char* file_chars, const size_t file_chars_length, 
+    const size_t line_start, n3dc_obj_counts_t* counts
+){
+    switch(n3dc_obj_get_line_type(file_chars, file_chars_length, line_start))
+    {
+        case N3DC_OBJ_LINE_VERTEX: counts->num_vertices++; break;
+        case N3DC_OBJ_LINE_TEXTURE_COORD: counts->num_texture_coords++; break;
+        case N3DC_OBJ_LINE_NORMAL: counts->num_normals++; break;
+        case N3DC_OBJ_LINE_FACE:
+            counts->num_indices += n3dc_obj_count_face_indices(file_chars, file_chars_length, line_start + 1);
+            break;
+        default: break;
+    }
+}
+
+// Counts records by classifying the start of every line. Line starts are found from the same
+// 64 character newline masks that n3dc_obj_seek_newline uses, visiting each set bit in turn.
+// Only face lines are read past their keyword, to count their index groups.
+static void n3dc_obj_count_records(
+    const char* file_chars, const size_t file_chars_length, n3dc_obj_counts_t* counts
+){
+    memset(counts, 0, sizeof(n3dc_obj_counts_t));
+    if(file_chars_length == 0) { return; }
+    n3dc_obj_count_line(file_chars, file_chars_length, 0, counts);
+    size_t i = 0;
+#if defined(N3DC_OBJ_SIMD)
+    for(; i + 64 <= file_chars_length; i += 64)
     {
-        const char last_char = file_chars[current_char_offset - 1];
-        const char current_char = file_chars[current_char_offset];
-        if(last_char == 'v' && current_char == ' ')
+        unsigned long long newline_mask = n3dc_obj_newline_mask_64(&file_chars[i]);
+        while(newline_mask)
         {
-            parsed_vertices++;
-            if(parsed_vertices > max_vertices)
+            const size_t line_start = i + n3dc_obj_count_trailing_zeros(newline_mask) + 1;
+            if(line_start < file_chars_length)
             {
-                printf("Exceeded maximum number of vertices while parsing OBJ file\n");
-                error = 1;
-                break;
+                n3dc_obj_count_line(file_chars, file_chars_length, line_start, counts);
             }
-            // Increment by 1 to skip over space space character.
-            current_char_offset++;
-            size_t line_end = current_char_offset;
-            const unsigned int x_offset = vertex_offset++;
-            const unsigned int y_offset = vertex_offset++;
-            const unsigned int z_offset = vertex_offset++;
-            error = n3dc_obj_parse_obj_vec3(
-                file_chars, file_chars_length, current_char_offset, &line_end,
-                &vertices[x_offset], &vertices[y_offset], &vertices[z_offset]
-            );
-            if(error) { break; }
-            current_char_offset = line_end + 2;
+            newline_mask &= newline_mask - 1;
         }
-        else if(last_char == 'v' && current_char == 't')
+    }
+#endif
+    for(; i + 1 < file_chars_length; i++)
+    {
+        if(file_chars[i] == '\n') { n3dc_obj_count_line(file_chars, file_chars_length, i + 1, counts); }
+    }
+}
+
+// An o, g, or usemtl line, which changes the object, group, or material of the faces after it.
+typedef struct
+{
+    // The number of face indices parsed before the line.
+    unsigned int first_index;
+    n3dc_obj_line_type_t type;
+    // Offset of the line's NUL-terminated name in the parse state's names.
+    size_t name_offset;
+} n3dc_obj_submesh_event_t;
+
+// A face index past the records parsed before it, which is the only kind of index that can turn
+// out to be out of range once every record has been parsed.
+typedef struct
+{
+    unsigned int index;
+    // 0, 1, or 2 for a vertex, texture, or normal index.
+    unsigned int attribute;
+    size_t offset;
+    size_t line;
+} n3dc_obj_forward_reference_t;
+
+// Destination arrays and running counts of the records parsed from an OBJ file. When parsing
+// in chunks, each chunk's state starts its counts at the chunk's offset into the shared arrays.
+typedef struct
+{
+    float* vertices;
+    float* texture_coords;
+    float* normals;
+    unsigned int* vertex_indices;
+    unsigned int* texture_indices;
+    unsigned int* normal_indices;
+    unsigned int parsed_vertices;
+    unsigned int parsed_texture_coords;
+    unsigned int parsed_normals;
+    unsigned int parsed_indices;
+    unsigned int max_vertices;
+    unsigned int max_texture_coords;
+    unsigned int max_normals;
+    unsigned int max_indices;
+    // All six arrays are carved out of this one scratch block. The arrays of skipped attributes
+    // aren't allocated and are NULL.
+    n3dc_obj_scratch_t* scratch;
+    void* block;
+    size_t block_size;
+    // Set once normals have been generated, in which case normals points here instead.
+    float* generated_normals;
+    // If set, o, g, and usemtl lines are recorded as events. Unlike the arrays above, the events
+    // and their names grow as needed and are allocated with the scratch allocator.
+    int record_submeshes;
+    // If set along with record_submeshes, mtllib lines are recorded as events too.
+    int load_materials;
+    // The OBJ file's path, which mtllib names are resolved against, or NULL for loads from memory.
+    const char* path;
+    // The n3dc_obj_attribute_t values whose lines are skipped instead of parsed.
+    unsigned int skip_attributes;
+    // If set, only v lines are parsed and every other line is skipped, for the later frames of
+    // a sequence.
+    int positions_only;
+    // Optional caller-owned array with room for parsed_indices entries, which building the output
+    // fills with the v record of each output vertex.
+    unsigned int* position_indices;
+    n3dc_obj_submesh_event_t* events;
+    size_t num_events;
+    size_t events_capacity;
+    char* names;
+    size_t names_length;
+    size_t names_capacity;
+    // Set by streams, which can't look through the data again to place an out of range index. Each
+    // forward reference past every earlier one of its attribute is recorded instead, which always
+    // includes the first out of range index, and forward_reference_ends holds one past the largest
+    // index recorded for each attribute. Like the events, they grow with the scratch allocator.
+    int record_forward_references;
+    unsigned int forward_reference_ends[3];
+    n3dc_obj_forward_reference_t* forward_references;
+    size_t num_forward_references;
+    size_t forward_references_capacity;
+    // The first failure while parsing or building the output.
+    n3dc_obj_error_t error;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    // Timings and line counts collected so far. counts and peak_scratch_bytes are filled in by
+    // n3dc_obj_report_stats.
+    n3dc_obj_stats_t stats;
+#endif
+} n3dc_obj_parse_state_t;
+
+static size_t n3dc_obj_align_size(const size_t size) { return (size + 63) & ~(size_t)63; }
+
+// Allocates the state's arrays to hold up to the state's max_* records as a single scratch block.
+// If the state already has a block that is big enough, it is reused instead.
+static int n3dc_obj_allocate_parse_state(n3dc_obj_parse_state_t* state)
+{
+    const int has_texture_coords = !(state->skip_attributes & N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS);
+    const int has_normals = !(state->skip_attributes & N3DC_OBJ_ATTRIBUTE_NORMALS);
+    if(!has_texture_coords) { state->max_texture_coords = 0; }
+    if(!has_normals) { state->max_normals = 0; }
+    const size_t vertices_size = n3dc_obj_align_size(sizeof(float) * state->max_vertices * 3);
+    const size_t texture_coords_size = n3dc_obj_align_size(sizeof(float) * state->max_texture_coords * 2);
+    const size_t normals_size = n3dc_obj_align_size(sizeof(float) * state->max_normals * 3);
+    const size_t indices_size = n3dc_obj_align_size(sizeof(unsigned int) * state->max_indices);
+    const size_t block_size = vertices_size + texture_coords_size + normals_size 
+        + indices_size * (1 + has_texture_coords + has_normals);
+    if(state->block && state->block_size < block_size)
+    {
+        n3dc_obj_scratch_deallocate(state->scratch, state->block);
+        state->block = NULL;
+    }
+    if(!state->block)
+    {
+        state->block = n3dc_obj_scratch_allocate(state->scratch, block_size);
+        state->block_size = block_size;
+    }
+    unsigned char* block = (unsigned char*)state->block;
+    if(!block) { return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    state->vertices = (float*)block;
+    block += vertices_size;
+    state->texture_coords = (float*)block;
+    block += texture_coords_size;
+    state->normals = (float*)block;
+    block += normals_size;
+    state->vertex_indices = (unsigned int*)block;
+    block += indices_size;
+    state->texture_indices = has_texture_coords ? (unsigned int*)block : NULL;
+    block += has_texture_coords ? indices_size : 0;
+    state->normal_indices = has_normals ? (unsigned int*)block : NULL;
+    if(!has_texture_coords) { state->texture_coords = NULL; }
+    if(!has_normals) { state->normals = NULL; }
+    return 0;
+}
+
+static void n3dc_obj_free_parse_state(n3dc_obj_parse_state_t* state)
+{
+    if(state->block) { n3dc_obj_scratch_deallocate(state->scratch, state->block); }
+    if(state->generated_normals) { n3dc_obj_scratch_deallocate(state->scratch, state->generated_normals); }
+    n3dc_obj_deallocate(state->scratch->allocator, state->events);
+    n3dc_obj_deallocate(state->scratch->allocator, state->names);
+    n3dc_obj_deallocate(state->scratch->allocator, state->forward_references);
+    state->block = NULL;
+    state->block_size = 0;
+    state->generated_normals = NULL;
+    state->events = NULL;
+    state->num_events = 0;
+    state->events_capacity = 0;
+    state->names = NULL;
+    state->names_length = 0;
+    state->names_capacity = 0;
+    state->forward_references = NULL;
+    state->num_forward_references = 0;
+    state->forward_references_capacity = 0;
+}
+
+// Grows an array allocated with allocator so that it can hold at least min_capacity elements.
+static int n3dc_obj_reserve_array(
+    const n3dc_obj_allocator_t* allocator, void** array, size_t* capacity,
+    const size_t min_capacity, const size_t element_size
+){
+    if(min_capacity <= *capacity) { return 0; }
+    size_t new_capacity = *capacity > 0 ? *capacity * 2 : 16;
+    if(new_capacity < min_capacity) { new_capacity = min_capacity; }
+    void* new_array = n3dc_obj_reallocate(
+        allocator, *array, *capacity * element_size, new_capacity * element_size
+    );
+    if(!new_array) { return -1; }
+    *array = new_array;
+    *capacity = new_capacity;
+    return 0;
+}
+
+// Adds an event for an o, g, or usemtl line whose name is the rest of the line, without the
+// surrounding spaces.
+static int n3dc_obj_add_submesh_event(
+    n3dc_obj_parse_state_t* state, const n3dc_obj_line_type_t type, 
+    const char* name, size_t name_length
+){
+    while(name_length > 0 && n3dc_obj_is_space(*name)) { name++; name_length--; }
+    while(name_length > 0 && n3dc_obj_is_space(name[name_length - 1])) { name_length--; }
+    const n3dc_obj_allocator_t* allocator = state->scratch->allocator;
+    if(n3dc_obj_reserve_array(
+            allocator, (void**)&state->events, &state->events_capacity, 
+            state->num_events + 1, sizeof(n3dc_obj_submesh_event_t))
+        || n3dc_obj_reserve_array(
+            allocator, (void**)&state->names, &state->names_capacity, 
+            state->names_length + name_length + 1, 1))
+    {
+        return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+    }
+    n3dc_obj_submesh_event_t* event = &state->events[state->num_events++];
+    event->first_index = state->parsed_indices;
+    event->type = type;
+    event->name_offset = state->names_length;
+    memcpy(&state->names[state->names_length], name, name_length);
+    state->names[state->names_length + name_length] = '\0';
+    state->names_length += name_length + 1;
+    return 0;
+}
+
+// Records the forward references among the indices of a face that was just parsed into the
+// corners from first_index on. num_records is what the face's indices were resolved against.
+static int n3dc_obj_record_forward_references(
+    n3dc_obj_parse_state_t* state, const char* file_chars, const size_t line_start, const size_t line_end,
+    const unsigned int first_index, const unsigned int* num_records
+){
+    const unsigned int* indices[3] = {state->vertex_indices, state->texture_indices, state->normal_indices};
+    for(unsigned int corner = first_index; corner < state->parsed_indices; corner++)
+    {
+        for(unsigned int i = 0; i < 3; i++)
         {
-            parsed_texture_coords++;
-            if(parsed_texture_coords > max_indices)
+            if(!indices[i]) { continue; }
+            const unsigned int index = indices[i][corner];
+            if(index == N3DC_OBJ_MISSING_INDEX || index < num_records[i] || index < state->forward_reference_ends[i])
             {
-                printf("Exceed maximum number of texture coords (max_indices) while parsing OBJ file\n");
-                error = -1;
-                break;
+                continue;
             }
-            // Increment by 2 to skip over t and space characters.
-            current_char_offset += 2;
-            size_t line_end = current_char_offset;
-            const unsigned int x_offset = texture_coord_offset++;
-            const unsigned int y_offset = texture_coord_offset++;
-            error = n3dc_obj_parse_obj_vec2(
-                file_chars, file_chars_length, current_char_offset, &line_end,
-                &texture_coords[x_offset], &texture_coords[y_offset]
-            );
-            if(error) { break; }
-            current_char_offset = line_end + 2;
+            if(n3dc_obj_reserve_array(
+                state->scratch->allocator, (void**)&state->forward_references, 
+                &state->forward_references_capacity, state->num_forward_references + 1, 
+                sizeof(n3dc_obj_forward_reference_t)
+            )){
+                return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+            }
+            const unsigned int face_corner = corner - first_index;
+            const unsigned int group = (face_corner % 3 == 0) ? 0 : face_corner / 3 + face_corner % 3;
+            n3dc_obj_forward_reference_t* reference = &state->forward_references[state->num_forward_references++];
+            reference->index = index;
+            reference->attribute = i;
+            reference->offset = n3dc_obj_find_face_index(file_chars, line_start, line_end, group, i);
+            reference->line = 0;
+            state->forward_reference_ends[i] = index + 1;
+        }
+    }
+    return 0;
+}
 
+static int n3dc_obj_parse_records(
+    const char* file_chars, const size_t file_chars_length, n3dc_obj_parse_state_t* state
+){
+    size_t line_start = 0;
+    while(line_start < file_chars_length)
+    {
+        size_t line_end = line_start;
+        int error = 0;
+        n3dc_obj_line_type_t line_type = n3dc_obj_get_line_type(file_chars, file_chars_length, line_start);
+        // Lines of skipped attributes are treated like any other line that isn't parsed.
+        if((line_type == N3DC_OBJ_LINE_TEXTURE_COORD && (state->skip_attributes & N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS))
+            || (line_type == N3DC_OBJ_LINE_NORMAL && (state->skip_attributes & N3DC_OBJ_ATTRIBUTE_NORMALS))
+            || (line_type == N3DC_OBJ_LINE_MATERIAL_LIBRARY && !state->load_materials)
+            || (line_type != N3DC_OBJ_LINE_VERTEX && state->positions_only))
+        {
+            line_type = N3DC_OBJ_LINE_OTHER;
         }
-        else if(last_char == 'v' && current_char == 'n')
+        switch(line_type)
         {
-            parsed_normals++;
-            if(parsed_normals > max_normals)
+            case N3DC_OBJ_LINE_VERTEX:
             {
-                printf("Exceeded maximum number of normals while parsing OBJ file\n");
-                error = 1;
+                if(state->parsed_vertices >= state->max_vertices)
+                {
+                    return n3dc_obj_set_parse_error(&state->error, N3DC_OBJ_ERROR_TOO_MANY_VERTICES, line_start);
+                }
+                float* vertex = &state->vertices[(size_t)state->parsed_vertices++ * 3];
+                // Skip over the v character.
+                error = n3dc_obj_parse_obj_vec3(
+                    file_chars, file_chars_length, line_start + 1, &line_end,
+                    &vertex[0], &vertex[1], &vertex[2], &state->error
+                );
                 break;
             }
-            // Incremement by 2 to skip over n and space characters.
-            current_char_offset += 2;
-            size_t line_end = current_char_offset;
-            const unsigned int x_offset = normal_offset++;
-            const unsigned int y_offset = normal_offset++;
-            const unsigned int z_offset = normal_offset++;
-            error = n3dc_obj_parse_obj_vec3(
-                file_chars, file_chars_length, current_char_offset, &line_end,
-                &normals[x_offset], &normals[y_offset],&normals[z_offset]
-            );
-            if(error) { break; }
-            current_char_offset = line_end + 2;
-        }
-        else if(last_char == 'f' && current_char == ' ')
-        {
-            parsed_indices += 3;
-            if(parsed_indices > max_indices)
+            case N3DC_OBJ_LINE_TEXTURE_COORD:
             {
-                printf("Exceeded maximum number of indices while parsing OBJ file\n");
-                error = 1;
+                if(state->parsed_texture_coords >= state->max_texture_coords)
+                {
+                    return n3dc_obj_set_parse_error(
+                        &state->error, N3DC_OBJ_ERROR_TOO_MANY_TEXTURE_COORDS, line_start
+                    );
+                }
+                float* texture_coord = &state->texture_coords[(size_t)state->parsed_texture_coords++ * 2];
+                // Skip over the v and t characters.
+                error = n3dc_obj_parse_obj_vec2(
+                    file_chars, file_chars_length, line_start + 2, &line_end,
+                    &texture_coord[0], &texture_coord[1], &state->error
+                );
+                break;
+            }
+            case N3DC_OBJ_LINE_NORMAL:
+            {
+                if(state->parsed_normals >= state->max_normals)
+                {
+                    return n3dc_obj_set_parse_error(&state->error, N3DC_OBJ_ERROR_TOO_MANY_NORMALS, line_start);
+                }
+                float* normal = &state->normals[(size_t)state->parsed_normals++ * 3];
+                // Skip over the v and n characters.
+                error = n3dc_obj_parse_obj_vec3(
+                    file_chars, file_chars_length, line_start + 2, &line_end,
+                    &normal[0], &normal[1], &normal[2], &state->error
+                );
+                break;
+            }
+            case N3DC_OBJ_LINE_FACE:
+            {
+                // Negative indices are resolved against the records parsed so far, which include
+                // the preceding chunks' records when parsing in chunks. Skipped attributes aren't
+                // stored, so none of their indices are out of range.
+                const unsigned int num_records[3] = {
+                    state->parsed_vertices,
+                    state->texture_indices ? state->parsed_texture_coords : (unsigned int)-1,
+                    state->normal_indices ? state->parsed_normals : (unsigned int)-1
+                };
+                const unsigned int first_index = state->parsed_indices;
+                // Skip over the f character.
+                error = n3dc_obj_parse_obj_face(
+                    file_chars, file_chars_length, line_start + 1, &line_end, 
+                    state->vertex_indices, state->texture_indices, state->normal_indices,
+                    &state->parsed_indices, state->max_indices, num_records, &state->error
+                );
+                if(!error && state->record_forward_references)
+                {
+                    error = n3dc_obj_record_forward_references(
+                        state, file_chars, line_start, line_end, first_index, num_records
+                    );
+                }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+                state->stats.num_faces++;
+#endif
+                break;
+            }
+            case N3DC_OBJ_LINE_OBJECT:
+            case N3DC_OBJ_LINE_GROUP:
+            case N3DC_OBJ_LINE_MATERIAL:
+            {
+                n3dc_obj_seek_end_of_line(file_chars, file_chars_length, line_start, &line_end);
+                if(state->record_submeshes)
+                {
+                    // Skip over the o, g, or usemtl keyword.
+                    const size_t name_start = line_start + (line_type == N3DC_OBJ_LINE_MATERIAL ? 6 : 1);
+                    error = n3dc_obj_add_submesh_event(
+                        state, line_type, &file_chars[name_start], line_end - name_start
+                    );
+                }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+                state->stats.num_submesh_lines++;
+#endif
+                break;
+            }
+            case N3DC_OBJ_LINE_MATERIAL_LIBRARY:
+            {
+                n3dc_obj_seek_end_of_line(file_chars, file_chars_length, line_start, &line_end);
+                // Skip over the mtllib keyword.
+                error = n3dc_obj_add_submesh_event(
+                    state, line_type, &file_chars[line_start + 6], line_end - line_start - 6
+                );
+                break;
+            }
+            default:
+            {
+                // Skip to start of next line.
+                n3dc_obj_seek_end_of_line(file_chars, file_chars_length, line_start, &line_end);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+                state->stats.num_skipped_lines++;
+#endif
                 break;
             }
-            size_t line_end = current_char_offset;
-            const unsigned int group_1_offset = index_offset++;
-            const unsigned int group_2_offset = index_offset++;
-            const unsigned int group_3_offset = index_offset++;
-            error = n3dc_obj_parse_obj_face(
-                file_chars, file_chars_length, current_char_offset, &line_end, 
-                // Index group 1.
-                &vertex_indices[group_1_offset],
-                &texture_indices[group_1_offset],
-                &normal_indices[group_1_offset],
-                // Index group 2.
-                &vertex_indices[group_2_offset],
-                &texture_indices[group_2_offset],
-                &normal_indices[group_2_offset],
-                // Index group 3.
-                &vertex_indices[group_3_offset],
-                &texture_indices[group_3_offset],
-                &normal_indices[group_3_offset]
-            );
-            if(error) { break; }
-            current_char_offset = line_end + 2;
         }
-        else 
+        if(error) { return -1; }
+        line_start = line_end + 1;
+    }
+    return 0;
+}
+
+// A section of an OBJ file that starts at the beginning of a line and ends after a newline
+// (or at the end of the file), so that it can be counted and parsed independently of the others.
+typedef struct
+{
+    const char* chars;
+    size_t length;
+    n3dc_obj_counts_t counts;
+    n3dc_obj_parse_state_t state;
+    int error;
+} n3dc_obj_chunk_t;
+
+static void n3dc_obj_count_chunk(void* chunk)
+{
+    n3dc_obj_chunk_t* c = (n3dc_obj_chunk_t*)chunk;
+    n3dc_obj_count_records(c->chars, c->length, &c->counts);
+}
+
+static void n3dc_obj_parse_chunk(void* chunk)
+{
+    n3dc_obj_chunk_t* c = (n3dc_obj_chunk_t*)chunk;
+    c->error = n3dc_obj_parse_records(c->chars, c->length, &c->state);
+}
+
+// Returns how many threads to split num_items items between so that each gets at least min_items,
+// since smaller pieces aren't worth the cost of a thread. Always at least 1.
+static unsigned int n3dc_obj_clamp_threads(
+    unsigned int num_threads, const size_t num_items, const size_t min_items
+){
+    if((size_t)num_threads > num_items / min_items) { num_threads = (unsigned int)(num_items / min_items); }
+    return num_threads > 0 ? num_threads : 1;
+}
+
+// Runs function on each of the num_tasks tasks of task_size bytes in tasks, using one thread per
+// task with the first task running on the calling thread. If a thread can't be created then its
+// task runs on the calling thread instead.
+static void n3dc_obj_run_tasks(
+    n3dc_obj_scratch_t* scratch, void* tasks, const size_t task_size, const unsigned int num_tasks, 
+    void (*function)(void*)
+){
+    unsigned char* task_bytes = (unsigned char*)tasks;
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_thread_t* threads = (n3dc_obj_thread_t*)n3dc_obj_scratch_allocate(
+        scratch, sizeof(n3dc_obj_thread_t) * num_tasks
+    );
+    int* thread_created = (int*)n3dc_obj_scratch_allocate(scratch, sizeof(int) * num_tasks);
+    if(threads && thread_created)
+    {
+        for(unsigned int i = 1; i < num_tasks; i++)
         {
-            // Skip to start of next line.
-            size_t line_end = current_char_offset;
-            error = n3dc_obj_seek_end_of_line(
-                file_chars, file_chars_length, current_char_offset, &line_end
-            );
-            if(error) { break; }
-            current_char_offset = line_end + 2;
+            thread_created[i] = !n3dc_obj_thread_create(&threads[i], function, &task_bytes[i * task_size]);
         }
     }
-    if(error)
+    function(task_bytes);
+    for(unsigned int i = 1; i < num_tasks; i++)
     {
-        free(vertices);
-        free(texture_coords);
-        free(normals);
-        free(vertex_indices);
-        free(texture_indices);
-        free(normal_indices);
-        free(file_chars);
-        return NULL;
+        if(threads && thread_created && thread_created[i]) { n3dc_obj_thread_join(&threads[i]); }
+        else { function(&task_bytes[i * task_size]); }
     }
+    if(threads) { n3dc_obj_scratch_deallocate(scratch, threads); }
+    if(thread_created) { n3dc_obj_scratch_deallocate(scratch, thread_created); }
+#else
+    (void)scratch;
+    for(unsigned int i = 0; i < num_tasks; i++) { function(&task_bytes[i * task_size]); }
+#endif
+}
 
-    const size_t ordered_scalars_size = sizeof(float) * parsed_indices;
-    float* ordered_vertices = (float*)malloc(ordered_scalars_size * 3);
-    float* ordered_texture_coords = (float*)malloc(ordered_scalars_size * 2);
-    float* ordered_normals = (float*)malloc(ordered_scalars_size * 3);
-    for(int i = 0; i < parsed_indices; i++)
-    {
-        vertex_offset = vertex_indices[i] * 3;
-        const unsigned int ordered_vertex_offset = i * 3;
-        ordered_vertices[ordered_vertex_offset] = vertices[vertex_offset];
-        ordered_vertices[ordered_vertex_offset+1] = vertices[vertex_offset+1];
-        ordered_vertices[ordered_vertex_offset+2] = vertices[vertex_offset+2];
-
-        texture_coord_offset = texture_indices[i] * 2;
-        const unsigned int ordered_texture_coord_offset = i * 2;
-        ordered_texture_coords[ordered_texture_coord_offset] = texture_coords[texture_coord_offset];
-        ordered_texture_coords[ordered_texture_coord_offset+1] = texture_coords[texture_coord_offset+1];
-        
-        normal_offset = normal_indices[i] * 3;
-        const unsigned int ordered_normal_offset = ordered_vertex_offset;
-        ordered_normals[ordered_normal_offset] = normals[normal_offset];
-        ordered_normals[ordered_normal_offset+1] = normals[normal_offset+1];
-        ordered_normals[ordered_normal_offset+2] = normals[normal_offset+2];
-    }
-
-    free(vertices);
-    free(texture_coords);
-    free(normals);
-    free(vertex_indices);
-    free(texture_indices);
-    free(normal_indices);
-    free(file_chars);
-
-    n3dc_obj_t* obj = (n3dc_obj_t*)malloc(sizeof(n3dc_obj_t));
-    obj->num_vertices = parsed_indices;
-    obj->vertices = ordered_vertices;
-    obj->normals = ordered_normals;
-    obj->texture_coords = ordered_texture_coords;
-    return obj;
+// Splits the file into one chunk per thread and parses it into state, allocating the state's
+// arrays along the way. The records in each chunk are counted on its own thread, then each
+// chunk's parse state is offset by the prefix sum of the preceding chunks' counts so that every
+// chunk can be parsed straight into the shared arrays. The resulting arrays are identical to the
+// ones produced by a serial parse. If count_first is set then the state's max_* values are
+// replaced by the exact counts before allocating.
+static int n3dc_obj_parse_file(
+    const char* file_chars, const size_t file_chars_length, 
+    n3dc_obj_parse_state_t* state, unsigned int num_threads, const int count_first
+){
+    num_threads = n3dc_obj_clamp_threads(num_threads, file_chars_length, N3DC_OBJ_MIN_CHUNK_LENGTH);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    state->stats.bytes_processed += file_chars_length;
+    double start_seconds = n3dc_obj_get_seconds();
+#endif
+    if(num_threads == 1 && !count_first)
+    {
+        if(n3dc_obj_allocate_parse_state(state)) { return -1; }
+        const int error = n3dc_obj_parse_records(file_chars, file_chars_length, state);
+        if(error) { n3dc_obj_locate_error(&state->error, file_chars, 0, 0); }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+        state->stats.parse_seconds += n3dc_obj_get_seconds() - start_seconds;
+#endif
+        return error;
+    }
+
+    n3dc_obj_chunk_t* chunks = (n3dc_obj_chunk_t*)n3dc_obj_scratch_allocate(
+        state->scratch, sizeof(n3dc_obj_chunk_t) * num_threads
+    );
+    if(!chunks) { return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    memset(chunks, 0, sizeof(n3dc_obj_chunk_t) * num_threads);
+    unsigned int num_chunks = 0;
+    size_t chunk_start = 0;
+    for(unsigned int i = 0; i < num_threads && (chunk_start < file_chars_length || i == 0); i++)
+    {
+        size_t chunk_end = file_chars_length;
+        if(i + 1 < num_threads)
+        {
+            size_t newline = 0;
+            const size_t split = file_chars_length / num_threads * (i + 1);
+            if(split > chunk_start 
+                && n3dc_obj_seek_newline(file_chars, file_chars_length, split, &newline))
+            {
+                chunk_end = newline + 1;
+            }
+        }
+        chunks[num_chunks].chars = &file_chars[chunk_start];
+        chunks[num_chunks].length = chunk_end - chunk_start;
+        num_chunks++;
+        chunk_start = chunk_end;
+    }
+
+    n3dc_obj_run_tasks(state->scratch, chunks, sizeof(n3dc_obj_chunk_t), num_chunks, n3dc_obj_count_chunk);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double scan_end_seconds = n3dc_obj_get_seconds();
+    state->stats.scan_seconds += scan_end_seconds - start_seconds;
+    start_seconds = scan_end_seconds;
+#endif
+    n3dc_obj_counts_t totals = {0, 0, 0, 0};
+    for(unsigned int i = 0; i < num_chunks; i++)
+    {
+        // Lines of skipped attributes aren't parsed, so they take up no room in the arrays.
+        if(state->skip_attributes & N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS) { chunks[i].counts.num_texture_coords = 0; }
+        if(state->skip_attributes & N3DC_OBJ_ATTRIBUTE_NORMALS) { chunks[i].counts.num_normals = 0; }
+        if(state->positions_only) { chunks[i].counts.num_indices = 0; }
+        totals.num_vertices += chunks[i].counts.num_vertices;
+        totals.num_texture_coords += chunks[i].counts.num_texture_coords;
+        totals.num_normals += chunks[i].counts.num_normals;
+        totals.num_indices += chunks[i].counts.num_indices;
+    }
+    if(count_first)
+    {
+        state->max_vertices = state->parsed_vertices + totals.num_vertices;
+        state->max_texture_coords = state->parsed_texture_coords + totals.num_texture_coords;
+        state->max_normals = state->parsed_normals + totals.num_normals;
+        state->max_indices = state->parsed_indices + totals.num_indices;
+    }
+    // Too many records isn't checked against the totals here. Every chunk keeps the state's max_*
+    // values and starts counting at its exact offset, so it stops at the line that goes over them
+    // just like a serial parse would, and an earlier failure in the file still comes first.
+    int error = n3dc_obj_allocate_parse_state(state);
+    if(!error)
+    {
+        n3dc_obj_counts_t offsets = {0, 0, 0, 0};
+        for(unsigned int i = 0; i < num_chunks; i++)
+        {
+            n3dc_obj_parse_state_t* chunk_state = &chunks[i].state;
+            *chunk_state = *state;
+            chunk_state->parsed_vertices += offsets.num_vertices;
+            chunk_state->parsed_texture_coords += offsets.num_texture_coords;
+            chunk_state->parsed_normals += offsets.num_normals;
+            chunk_state->parsed_indices += offsets.num_indices;
+            // Each chunk records its own submesh events, which are appended to the state's below.
+            chunk_state->events = NULL;
+            chunk_state->num_events = 0;
+            chunk_state->events_capacity = 0;
+            chunk_state->names = NULL;
+            chunk_state->names_length = 0;
+            chunk_state->names_capacity = 0;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+            memset(&chunk_state->stats, 0, sizeof(n3dc_obj_stats_t));
+#endif
+            offsets.num_vertices += chunks[i].counts.num_vertices;
+            offsets.num_texture_coords += chunks[i].counts.num_texture_coords;
+            offsets.num_normals += chunks[i].counts.num_normals;
+            offsets.num_indices += chunks[i].counts.num_indices;
+        }
+        n3dc_obj_run_tasks(state->scratch, chunks, sizeof(n3dc_obj_chunk_t), num_chunks, n3dc_obj_parse_chunk);
+        // Report the failure that comes first in the file.
+        for(unsigned int i = 0; i < num_chunks && !error; i++)
+        {
+            error = chunks[i].error;
+            if(error)
+            {
+                state->error = chunks[i].state.error;
+                state->error.offset += (size_t)(chunks[i].chars - file_chars);
+                n3dc_obj_locate_error(&state->error, file_chars, 0, 0);
+            }
+        }
+        for(unsigned int i = 0; i < num_chunks; i++)
+        {
+            n3dc_obj_parse_state_t* chunk_state = &chunks[i].state;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+            state->stats.num_faces += chunk_state->stats.num_faces;
+            state->stats.num_submesh_lines += chunk_state->stats.num_submesh_lines;
+            state->stats.num_skipped_lines += chunk_state->stats.num_skipped_lines;
+#endif
+            if(!error && chunk_state->num_events > 0)
+            {
+                if(n3dc_obj_reserve_array(
+                        state->scratch->allocator, (void**)&state->events, &state->events_capacity,
+                        state->num_events + chunk_state->num_events, sizeof(n3dc_obj_submesh_event_t))
+                    || n3dc_obj_reserve_array(
+                        state->scratch->allocator, (void**)&state->names, &state->names_capacity,
+                        state->names_length + chunk_state->names_length, 1))
+                {
+                    error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+                }
+                else
+                {
+                    for(size_t j = 0; j < chunk_state->num_events; j++)
+                    {
+                        n3dc_obj_submesh_event_t* event = &state->events[state->num_events++];
+                        *event = chunk_state->events[j];
+                        event->name_offset += state->names_length;
+                    }
+                    memcpy(&state->names[state->names_length], chunk_state->names, chunk_state->names_length);
+                    state->names_length += chunk_state->names_length;
+                }
+            }
+            n3dc_obj_deallocate(state->scratch->allocator, chunk_state->events);
+            n3dc_obj_deallocate(state->scratch->allocator, chunk_state->names);
+        }
+    }
+    if(!error)
+    {
+        state->parsed_vertices += totals.num_vertices;
+        state->parsed_texture_coords += totals.num_texture_coords;
+        state->parsed_normals += totals.num_normals;
+        state->parsed_indices += totals.num_indices;
+    }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    state->stats.parse_seconds += n3dc_obj_get_seconds() - start_seconds;
+#endif
+    n3dc_obj_scratch_deallocate(state->scratch, chunks);
+    return error;
+}
+
+int n3dc_obj_count(const char* path, n3dc_obj_counts_t* counts)
+{
+    n3dc_obj_file_view_t file_view;
+    const int file_read_error = n3dc_obj_map_text_file(path, NULL, &file_view, NULL);
+    if(file_read_error) { return -1; }
+    n3dc_obj_count_records(file_view.chars, file_view.length, counts);
+    n3dc_obj_unmap_text_file(&file_view);
+    return 0;
+}
+
+int n3dc_obj_count_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    n3dc_obj_counts_t* counts
+){
+    n3dc_obj_count_records(file_chars, file_chars_length, counts);
+    return 0;
+}
+
+// Stands in for the attributes of index groups that leave them out.
+static const float n3dc_obj_zeros[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+// Returns the attribute at index, or zeros if the index is missing or out of range. The range
+// check is a select rather than a branch so that it costs next to nothing in the gather loops,
+// and any out of range index other than N3DC_OBJ_MISSING_INDEX sets *out_of_range.
+static const float* n3dc_obj_get_attribute(
+    const float* attributes, const unsigned int num_attributes, const unsigned int num_components,
+    const unsigned int index, int* out_of_range
+){
+    const int in_range = index < num_attributes;
+    *out_of_range |= !in_range & (index != N3DC_OBJ_MISSING_INDEX);
+    return in_range ? &attributes[(size_t)index * num_components] : n3dc_obj_zeros;
+}
+
+// One attribute to gather: output value i gets values[indices[corner]] for the corner of output
+// vertex i, where each value is num_components floats.
+typedef struct
+{
+    const float* values;
+    unsigned int num_values;
+    unsigned int num_components;
+    const unsigned int* indices;
+    float* ordered_values;
+} n3dc_obj_gather_attribute_t;
+
+// How many corners ahead the scalar gather prefetches. Far enough ahead to hide a miss to memory,
+// near enough that the lines are still cached when they're used.
+#define N3DC_OBJ_GATHER_PREFETCH_DISTANCE 32
+
+#if defined(N3DC_OBJ_SIMD_AVX2)
+// Gathers 8 output values of 2 or 3 components at a time, starting at *first and stopping
+// before the last partial group of 8, then moves *first past them. Each output vector is
+// gathered straight into output order: lane j of vector k holds component (8k + j) % n of value
+// (8k + j) / n, so it's the indices that are permuted into place rather than the values. Out of
+// range lanes are masked off, so they read nothing and give zeros. There's no software prefetch:
+// the gathers already keep several misses in flight, and prefetching slowed down the mostly
+// sequential indices that OBJ files tend to have. Returns non-zero if an index other than
+// N3DC_OBJ_MISSING_INDEX is out of range.
+static int n3dc_obj_gather_values_avx2(
+    const n3dc_obj_gather_attribute_t* attribute, const unsigned int* corners,
+    unsigned int* first, const unsigned int end
+){
+    const unsigned int num_components = attribute->num_components;
+    __m256i lanes[3];
+    __m256i components[3];
+    for(unsigned int k = 0; k < num_components; k++)
+    {
+        int lane_values[8];
+        int component_values[8];
+        for(unsigned int j = 0; j < 8; j++)
+        {
+            lane_values[j] = (int)((8 * k + j) / num_components);
+            component_values[j] = (int)((8 * k + j) % num_components);
+        }
+        lanes[k] = _mm256_loadu_si256((const __m256i*)lane_values);
+        components[k] = _mm256_loadu_si256((const __m256i*)component_values);
+    }
+    // AVX2 has no unsigned compare, so both sides are biased by the sign bit.
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i biased_num_values = _mm256_set1_epi32((int)(attribute->num_values ^ 0x80000000u));
+    const __m256i missing = _mm256_set1_epi32((int)N3DC_OBJ_MISSING_INDEX);
+    const __m256i stride = _mm256_set1_epi32((int)num_components);
+    __m256i out_of_range = _mm256_setzero_si256();
+    const unsigned int* indices = attribute->indices;
+    unsigned int i = *first;
+    for(; i + 8 <= end; i += 8)
+    {
+        const __m256i group_indices = corners
+            ? _mm256_setr_epi32(
+                (int)indices[corners[i]], (int)indices[corners[i + 1]], (int)indices[corners[i + 2]], 
+                (int)indices[corners[i + 3]], (int)indices[corners[i + 4]], (int)indices[corners[i + 5]], 
+                (int)indices[corners[i + 6]], (int)indices[corners[i + 7]])
+            : _mm256_loadu_si256((const __m256i*)&indices[i]);
+        const __m256i in_range = _mm256_cmpgt_epi32(biased_num_values, _mm256_xor_si256(group_indices, sign));
+        const __m256i is_missing = _mm256_cmpeq_epi32(group_indices, missing);
+        out_of_range = _mm256_or_si256(out_of_range, _mm256_andnot_si256(_mm256_or_si256(in_range, is_missing), missing));
+        const __m256i offsets = _mm256_mullo_epi32(group_indices, stride);
+        float* ordered_values = &attribute->ordered_values[(size_t)i * num_components];
+        for(unsigned int k = 0; k < num_components; k++)
+        {
+            const __m256i value_offsets = _mm256_add_epi32(_mm256_permutevar8x32_epi32(offsets, lanes[k]), components[k]);
+            const __m256 mask = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(in_range, lanes[k]));
+            _mm256_storeu_ps(
+                &ordered_values[8 * k], 
+                _mm256_mask_i32gather_ps(_mm256_setzero_ps(), attribute->values, value_offsets, mask, 4)
+            );
+        }
+    }
+    *first = i;
+    return !_mm256_testz_si256(out_of_range, out_of_range);
+}
+#endif
+
+// Gathers output values first to end of the attribute one at a time, prefetching the values
+// N3DC_OBJ_GATHER_PREFETCH_DISTANCE corners ahead. It's always inlined so that each caller gets
+// a loop specialized for a constant num_components and for whether corners is NULL.
+static N3DC_OBJ_FORCE_INLINE int n3dc_obj_gather_values_scalar(
+    const n3dc_obj_gather_attribute_t* attribute, const unsigned int num_components, 
+    const unsigned int* corners, const unsigned int first, const unsigned int end
+){
+    const float* values = attribute->values;
+    const unsigned int num_values = attribute->num_values;
+    const unsigned int* indices = attribute->indices;
+    float* ordered_values = attribute->ordered_values;
+    const unsigned int prefetch_end = end - first > N3DC_OBJ_GATHER_PREFETCH_DISTANCE 
+        ? end - N3DC_OBJ_GATHER_PREFETCH_DISTANCE : first;
+    int out_of_range = 0;
+    for(unsigned int i = first; i < end; i++)
+    {
+        if(i < prefetch_end)
+        {
+            const unsigned int ahead = i + N3DC_OBJ_GATHER_PREFETCH_DISTANCE;
+            const unsigned int ahead_index = indices[corners ? corners[ahead] : ahead];
+            // Out of range indices prefetch the first value instead.
+            N3DC_OBJ_PREFETCH(&values[ahead_index < num_values ? (size_t)ahead_index * num_components : 0]);
+        }
+        const float* value = n3dc_obj_get_attribute(
+            values, num_values, num_components, indices[corners ? corners[i] : i], &out_of_range
+        );
+        float* ordered_value = &ordered_values[(size_t)i * num_components];
+        for(unsigned int j = 0; j < num_components; j++) { ordered_value[j] = value[j]; }
+    }
+    return out_of_range;
+}
+
+// Gathers output values first to end of the attribute, where output value i is for corner
+// corners[i], or corner i if corners is NULL. Returns non-zero if an index other than
+// N3DC_OBJ_MISSING_INDEX is out of range.
+static int n3dc_obj_gather_values(
+    const n3dc_obj_gather_attribute_t* attribute, const unsigned int* corners, 
+    unsigned int first, const unsigned int end
+){
+    const unsigned int num_components = attribute->num_components;
+    int out_of_range = 0;
+#if defined(N3DC_OBJ_SIMD_AVX2)
+    // The AVX2 gathers take signed 32-bit offsets.
+    if((num_components == 2 || num_components == 3) 
+        && (unsigned long long)attribute->num_values * num_components <= 0x7FFFFFFF)
+    {
+        out_of_range = n3dc_obj_gather_values_avx2(attribute, corners, &first, end);
+    }
+#endif
+    if(num_components == 2 && !corners)
+    {
+        out_of_range |= n3dc_obj_gather_values_scalar(attribute, 2, NULL, first, end);
+    }
+    else if(num_components == 3 && !corners)
+    {
+        out_of_range |= n3dc_obj_gather_values_scalar(attribute, 3, NULL, first, end);
+    }
+    else if(num_components == 2)
+    {
+        out_of_range |= n3dc_obj_gather_values_scalar(attribute, 2, corners, first, end);
+    }
+    else if(num_components == 3)
+    {
+        out_of_range |= n3dc_obj_gather_values_scalar(attribute, 3, corners, first, end);
+    }
+    else
+    {
+        out_of_range |= n3dc_obj_gather_values_scalar(attribute, num_components, corners, first, end);
+    }
+    return out_of_range;
+}
+
+// A range of output values for one of the threads of n3dc_obj_gather_attributes.
+typedef struct
+{
+    const n3dc_obj_gather_attribute_t* attributes;
+    unsigned int num_attributes;
+    const unsigned int* corners;
+    unsigned int first;
+    unsigned int end;
+    int out_of_range;
+} n3dc_obj_gather_task_t;
+
+static void n3dc_obj_gather_task(void* task)
+{
+    n3dc_obj_gather_task_t* t = (n3dc_obj_gather_task_t*)task;
+    for(unsigned int i = 0; i < t->num_attributes; i++)
+    {
+        t->out_of_range |= n3dc_obj_gather_values(&t->attributes[i], t->corners, t->first, t->end);
+    }
+}
+
+// Gathers num_corners output values of each attribute on up to num_threads threads, each of
+// which takes a contiguous range of the output. Returns -1 if an index other than
+// N3DC_OBJ_MISSING_INDEX is out of range, in which case the rest of the values are still
+// gathered.
+static int n3dc_obj_gather_attributes(
+    n3dc_obj_scratch_t* scratch, const n3dc_obj_gather_attribute_t* attributes, 
+    const unsigned int num_attributes, const unsigned int* corners, const unsigned int num_corners, 
+    unsigned int num_threads
+){
+    num_threads = n3dc_obj_clamp_threads(num_threads, num_corners, N3DC_OBJ_MIN_TASK_SIZE);
+    n3dc_obj_gather_task_t single_task;
+    n3dc_obj_gather_task_t* tasks = (num_threads > 1) 
+        ? (n3dc_obj_gather_task_t*)n3dc_obj_scratch_allocate(scratch, sizeof(n3dc_obj_gather_task_t) * num_threads)
+        : NULL;
+    // Without memory for the tasks, everything is gathered on the calling thread.
+    if(!tasks)
+    {
+        tasks = &single_task;
+        num_threads = 1;
+    }
+    for(unsigned int i = 0; i < num_threads; i++)
+    {
+        tasks[i].attributes = attributes;
+        tasks[i].num_attributes = num_attributes;
+        tasks[i].corners = corners;
+        tasks[i].first = (unsigned int)((unsigned long long)num_corners * i / num_threads);
+        tasks[i].end = (unsigned int)((unsigned long long)num_corners * (i + 1) / num_threads);
+        tasks[i].out_of_range = 0;
+    }
+    if(num_threads > 1)
+    {
+        n3dc_obj_run_tasks(scratch, tasks, sizeof(n3dc_obj_gather_task_t), num_threads, n3dc_obj_gather_task);
+    }
+    else { n3dc_obj_gather_task(tasks); }
+    int out_of_range = 0;
+    for(unsigned int i = 0; i < num_threads; i++) { out_of_range |= tasks[i].out_of_range; }
+    if(tasks != &single_task) { n3dc_obj_scratch_deallocate(scratch, tasks); }
+    return out_of_range ? -1 : 0;
+}
+
+// Copies the attributes of each listed face corner out of the parsed arrays on up to
+// num_threads threads, so that output vertex i gets the attributes of corner corners[i]. If
+// corners is NULL, output vertex i gets the attributes of corner i. The texture coords and
+// normals of skipped attributes aren't written, and their output arrays can be NULL. Returns
+// -1 if a corner refers to a record that wasn't parsed, in which case the rest of the corners
+// are still written.
+static int n3dc_obj_gather_corners(
+    const n3dc_obj_parse_state_t* state, const unsigned int* corners, const unsigned int num_corners,
+    const unsigned int num_threads,
+    float* ordered_vertices, float* ordered_texture_coords, float* ordered_normals
+){
+    n3dc_obj_gather_attribute_t attributes[3];
+    unsigned int num_attributes = 0;
+    const n3dc_obj_gather_attribute_t vertices = {
+        state->vertices, state->parsed_vertices, 3, state->vertex_indices, ordered_vertices
+    };
+    attributes[num_attributes++] = vertices;
+    // Missing texture coords and normals are filled with zeros.
+    if(state->texture_indices)
+    {
+        const n3dc_obj_gather_attribute_t texture_coords = {
+            state->texture_coords, state->parsed_texture_coords, 2, state->texture_indices, ordered_texture_coords
+        };
+        attributes[num_attributes++] = texture_coords;
+    }
+    if(state->normal_indices)
+    {
+        const n3dc_obj_gather_attribute_t normals = {
+            state->normals, state->parsed_normals, 3, state->normal_indices, ordered_normals
+        };
+        attributes[num_attributes++] = normals;
+    }
+    return n3dc_obj_gather_attributes(state->scratch, attributes, num_attributes, corners, num_corners, num_threads);
+}
+
+int n3dc_obj_gather(
+    const float* values,
+    const unsigned int num_values,
+    const unsigned int num_components,
+    const unsigned int* indices,
+    const unsigned int num_indices,
+    float* ordered_values,
+    const unsigned int num_threads
+){
+    if(num_components == 0 || num_components > 4) { return -1; }
+    n3dc_obj_scratch_t scratch;
+    n3dc_obj_init_scratch(&scratch, NULL);
+    const n3dc_obj_gather_attribute_t attribute = {values, num_values, num_components, indices, ordered_values};
+    return n3dc_obj_gather_attributes(&scratch, &attribute, 1, NULL, num_indices, num_threads);
+}
+
+// Converts a float to an IEEE 754 half float, rounding to nearest even like F16C does.
+static unsigned short n3dc_obj_float_to_half(const float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const unsigned int sign = (bits >> 16) & 0x8000;
+    const unsigned int magnitude = bits & 0x7FFFFFFF;
+    // Infinity and NaN, keeping NaNs quiet.
+    if(magnitude >= 0x7F800000) { return (unsigned short)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0)); }
+    // Too big for a half, even after rounding.
+    if(magnitude >= 0x477FF000) { return (unsigned short)(sign | 0x7C00); }
+    unsigned int half;
+    unsigned int remainder;
+    unsigned int halfway;
+    if(magnitude < 0x38800000)
+    {
+        // Subnormal halves count in units of 2^-24.
+        const unsigned int shift = 126 - (magnitude >> 23);
+        if(shift > 24) { return (unsigned short)sign; }
+        const unsigned int mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    }
+    else
+    {
+        // Rebias the exponent from 127 to 15 and drop the low 13 mantissa bits.
+        half = (magnitude - 0x38000000) >> 13;
+        remainder = magnitude & 0x1FFF;
+        halfway = 0x1000;
+    }
+    if(remainder > halfway || (remainder == halfway && (half & 1))) { half++; }
+    return (unsigned short)(sign | half);
+}
+
+static int n3dc_obj_snorm(float value, const float scale)
+{
+    if(value > 1.0f) { value = 1.0f; }
+    if(value < -1.0f) { value = -1.0f; }
+    return (int)(value * scale + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// Encodes a normal as a point on an octahedron folded out into the unit square.
+static void n3dc_obj_octahedral_encode(const float* normal, float* x, float* y)
+{
+    const float x_abs = normal[0] < 0.0f ? -normal[0] : normal[0];
+    const float y_abs = normal[1] < 0.0f ? -normal[1] : normal[1];
+    const float z_abs = normal[2] < 0.0f ? -normal[2] : normal[2];
+    const float sum = x_abs + y_abs + z_abs;
+    if(!(sum > 0.0f))
+    {
+        *x = 0.0f;
+        *y = 0.0f;
+        return;
+    }
+    const float px = normal[0] / sum;
+    const float py = normal[1] / sum;
+    if(normal[2] >= 0.0f)
+    {
+        *x = px;
+        *y = py;
+        return;
+    }
+    // Fold the lower hemisphere over the diagonals.
+    *x = (1.0f - (py < 0.0f ? -py : py)) * (px >= 0.0f ? 1.0f : -1.0f);
+    *y = (1.0f - (px < 0.0f ? -px : px)) * (py >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Returns the number of bytes an attribute with num_components components takes in a format, or
+// 0 if the format can't be used for the attribute.
+static unsigned int n3dc_obj_get_attribute_size(
+    const n3dc_obj_attribute_format_t format, const unsigned int num_components, const int is_normal
+){
+    switch(format)
+    {
+        case N3DC_OBJ_FORMAT_FLOAT32: return num_components * 4;
+        case N3DC_OBJ_FORMAT_FLOAT16: return num_components * 2;
+        case N3DC_OBJ_FORMAT_UNORM16: return num_components * 2;
+        case N3DC_OBJ_FORMAT_OCT_SNORM8: return is_normal ? 2 : 0;
+        case N3DC_OBJ_FORMAT_OCT_SNORM16: return is_normal ? 4 : 0;
+        default: return 0;
+    }
+}
+
+// Writes one attribute of num_components floats to vertex in the given format.
+static void n3dc_obj_write_attribute(
+    unsigned char* vertex, const float* values, const unsigned int num_components, 
+    const n3dc_obj_attribute_format_t format
+){
+    switch(format)
+    {
+        case N3DC_OBJ_FORMAT_FLOAT16:
+        {
+            unsigned short halves[4];
+#if defined(N3DC_OBJ_SIMD_F16C)
+            const __m128 floats = _mm_setr_ps(values[0], values[1], num_components > 2 ? values[2] : 0.0f, 0.0f);
+            _mm_storel_epi64((__m128i*)halves, _mm_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT));
+#elif defined(N3DC_OBJ_SIMD_NEON)
+            const float floats[4] = {values[0], values[1], num_components > 2 ? values[2] : 0.0f, 0.0f};
+            vst1_u16(halves, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(floats))));
+#else
+            for(unsigned int i = 0; i < num_components; i++) { halves[i] = n3dc_obj_float_to_half(values[i]); }
+#endif
+            memcpy(vertex, halves, sizeof(unsigned short) * num_components);
+            break;
+        }
+        case N3DC_OBJ_FORMAT_UNORM16:
+        {
+            unsigned short unorms[3];
+            for(unsigned int i = 0; i < num_components; i++)
+            {
+                float value = values[i];
+                if(value > 1.0f) { value = 1.0f; }
+                if(!(value > 0.0f)) { value = 0.0f; }
+                unorms[i] = (unsigned short)(value * 65535.0f + 0.5f);
+            }
+            memcpy(vertex, unorms, sizeof(unsigned short) * num_components);
+            break;
+        }
+        case N3DC_OBJ_FORMAT_OCT_SNORM8:
+        {
+            float x, y;
+            n3dc_obj_octahedral_encode(values, &x, &y);
+            const signed char snorms[2] = {(signed char)n3dc_obj_snorm(x, 127.0f), (signed char)n3dc_obj_snorm(y, 127.0f)};
+            memcpy(vertex, snorms, sizeof(snorms));
+            break;
+        }
+        case N3DC_OBJ_FORMAT_OCT_SNORM16:
+        {
+            float x, y;
+            n3dc_obj_octahedral_encode(values, &x, &y);
+            const short snorms[2] = {(short)n3dc_obj_snorm(x, 32767.0f), (short)n3dc_obj_snorm(y, 32767.0f)};
+            memcpy(vertex, snorms, sizeof(snorms));
+            break;
+        }
+        default: memcpy(vertex, values, sizeof(float) * num_components); break;
+    }
+}
+
+// Same as n3dc_obj_gather_corners, but writes each output vertex into an interleaved buffer,
+// converting each attribute to its format on the way. Skipped attributes are written as zeros.
+static int n3dc_obj_gather_corners_interleaved(
+    const n3dc_obj_parse_state_t* state, const unsigned int* corners, const unsigned int num_corners,
+    const n3dc_obj_vertex_layout_t* layout, unsigned char* interleaved_vertices
+){
+    int out_of_range = 0;
+    for(unsigned int i = 0; i < num_corners; i++)
+    {
+        const unsigned int corner = corners ? corners[i] : i;
+        unsigned char* vertex = &interleaved_vertices[(size_t)i * layout->stride];
+        if(layout->position_offset >= 0)
+        {
+            const float* position = n3dc_obj_get_attribute(
+                state->vertices, state->parsed_vertices, 3, state->vertex_indices[corner], &out_of_range
+            );
+            n3dc_obj_write_attribute(&vertex[layout->position_offset], position, 3, layout->position_format);
+        }
+        if(layout->normal_offset >= 0)
+        {
+            const float* normal = state->normal_indices 
+                ? n3dc_obj_get_attribute(
+                    state->normals, state->parsed_normals, 3, state->normal_indices[corner], &out_of_range
+                )
+                : n3dc_obj_zeros;
+            n3dc_obj_write_attribute(&vertex[layout->normal_offset], normal, 3, layout->normal_format);
+        }
+        if(layout->texture_coord_offset >= 0)
+        {
+            const float* texture_coord = state->texture_indices
+                ? n3dc_obj_get_attribute(
+                    state->texture_coords, state->parsed_texture_coords, 2, state->texture_indices[corner], &out_of_range
+                )
+                : n3dc_obj_zeros;
+            n3dc_obj_write_attribute(
+                &vertex[layout->texture_coord_offset], texture_coord, 2, layout->texture_coord_format
+            );
+        }
+    }
+    return out_of_range ? -1 : 0;
+}
+
+static int n3dc_obj_is_valid_attribute(
+    const int offset, const n3dc_obj_attribute_format_t format, 
+    const unsigned int num_components, const int is_normal, const unsigned int stride
+){
+    if(offset < 0) { return 1; }
+    const unsigned int size = n3dc_obj_get_attribute_size(format, num_components, is_normal);
+    return size > 0 && (unsigned int)offset + size <= stride;
+}
+
+static int n3dc_obj_is_valid_vertex_layout(const n3dc_obj_vertex_layout_t* layout)
+{
+    return layout->stride > 0 && layout->stride <= 0xFFFF
+        && n3dc_obj_is_valid_attribute(layout->position_offset, layout->position_format, 3, 0, layout->stride)
+        && n3dc_obj_is_valid_attribute(layout->normal_offset, layout->normal_format, 3, 1, layout->stride)
+        && n3dc_obj_is_valid_attribute(
+            layout->texture_coord_offset, layout->texture_coord_format, 2, 0, layout->stride
+        );
+}
+
+// Checks the options that can be rejected before any parsing is done, and clears the options'
+// error for the load that is starting.
+static int n3dc_obj_validate_options(const n3dc_obj_load_options_t* options)
+{
+    if(!options) { return 0; }
+    if(options->error) { memset(options->error, 0, sizeof(n3dc_obj_error_t)); }
+    if(options->vertex_layout && !n3dc_obj_is_valid_vertex_layout(options->vertex_layout))
+    {
+        return n3dc_obj_set_error(options->error, N3DC_OBJ_ERROR_INVALID_OPTIONS);
+    }
+    for(unsigned int i = 0; i < options->num_lods; i++)
+    {
+        const float ratio = options->lod_ratios ? options->lod_ratios[i] : 0.0f;
+        if(options->output_mode != N3DC_OBJ_OUTPUT_INDEXED || !(ratio > 0.0f && ratio < 1.0f)
+            || (i > 0 && !(ratio < options->lod_ratios[i - 1])))
+        {
+            return n3dc_obj_set_error(options->error, N3DC_OBJ_ERROR_INVALID_OPTIONS);
+        }
+    }
+    // Generated normals are written to the normal indices, which skipping normals leaves out.
+    if((options->skip_attributes & N3DC_OBJ_ATTRIBUTE_NORMALS) && options->normal_mode != N3DC_OBJ_NORMALS_FROM_FILE)
+    {
+        return n3dc_obj_set_error(options->error, N3DC_OBJ_ERROR_INVALID_OPTIONS);
+    }
+    // Materials are looked up for the submeshes, so they can't be loaded without them.
+    if(options->load_materials && !options->record_submeshes)
+    {
+        return n3dc_obj_set_error(options->error, N3DC_OBJ_ERROR_INVALID_OPTIONS);
+    }
+    return 0;
+}
+
+static unsigned int n3dc_obj_hash_index_group(
+    const unsigned int vertex_index, const unsigned int texture_index, const unsigned int normal_index
+){
+    unsigned int hash = vertex_index * 0x9E3779B1u;
+    hash ^= texture_index * 0x85EBCA77u;
+    hash ^= normal_index * 0xC2B2AE3Du;
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+// Welds face corners that have identical index groups. Each corner's unique vertex is written to
+// indices, and the first corner of each unique vertex is written to unique_corners, which must
+// have room for state->parsed_indices corners. Returns the number of unique vertices.
+static unsigned int n3dc_obj_weld_corners(
+    const n3dc_obj_parse_state_t* state, unsigned int* indices, unsigned int* unique_corners
+){
+    const unsigned int empty_slot = (unsigned int)-1;
+    size_t table_size = 16;
+    while(table_size < (size_t)state->parsed_indices * 2) { table_size *= 2; }
+    unsigned int* table = (unsigned int*)n3dc_obj_scratch_allocate(state->scratch, sizeof(unsigned int) * table_size);
+    if(!table) { return empty_slot; }
+    memset(table, 0xFF, sizeof(unsigned int) * table_size);
+
+    // Linear probing on a table that is at most half full.
+    const size_t table_mask = table_size - 1;
+    unsigned int num_unique = 0;
+    for(unsigned int i = 0; i < state->parsed_indices; i++)
+    {
+        // Skipped attributes don't tell corners apart.
+        const unsigned int vertex_index = state->vertex_indices[i];
+        const unsigned int texture_index = state->texture_indices ? state->texture_indices[i] : N3DC_OBJ_MISSING_INDEX;
+        const unsigned int normal_index = state->normal_indices ? state->normal_indices[i] : N3DC_OBJ_MISSING_INDEX;
+        size_t slot = n3dc_obj_hash_index_group(vertex_index, texture_index, normal_index) & table_mask;
+        for(;;)
+        {
+            const unsigned int unique = table[slot];
+            if(unique == empty_slot)
+            {
+                table[slot] = num_unique;
+                unique_corners[num_unique] = i;
+                indices[i] = num_unique++;
+                break;
+            }
+            const unsigned int corner = unique_corners[unique];
+            if(state->vertex_indices[corner] == vertex_index
+                && (!state->texture_indices || state->texture_indices[corner] == texture_index)
+                && (!state->normal_indices || state->normal_indices[corner] == normal_index))
+            {
+                indices[i] = unique;
+                break;
+            }
+            slot = (slot + 1) & table_mask;
+        }
+    }
+    n3dc_obj_scratch_deallocate(state->scratch, table);
+    return num_unique;
+}
+
+// Picks the next fanning vertex for n3dc_obj_optimize_vertex_cache: the candidate that will still
+// be in the cache after its remaining triangles are emitted and has been in the cache longest,
+// then the most recent vertex with live triangles, then the next vertex in index order.
+static unsigned int n3dc_obj_get_next_fanning_vertex(
+    const unsigned int* candidates, const unsigned int num_candidates,
+    const unsigned int* live_triangles, const unsigned int* cache_times, 
+    const unsigned int time, const unsigned int cache_size,
+    const unsigned int* dead_ends, unsigned int* num_dead_ends, 
+    unsigned int* cursor, const unsigned int num_vertices
+){
+    unsigned int best_vertex = N3DC_OBJ_MISSING_INDEX;
+    unsigned int best_priority = 0;
+    for(unsigned int i = 0; i < num_candidates; i++)
+    {
+        const unsigned int vertex = candidates[i];
+        if(live_triangles[vertex] == 0) { continue; }
+        const unsigned int age = time - cache_times[vertex];
+        const unsigned int priority = (age + 2 * live_triangles[vertex] <= cache_size) ? age : 0;
+        if(priority > best_priority)
+        {
+            best_vertex = vertex;
+            best_priority = priority;
+        }
+    }
+    if(best_vertex != N3DC_OBJ_MISSING_INDEX) { return best_vertex; }
+    while(*num_dead_ends > 0)
+    {
+        const unsigned int vertex = dead_ends[--(*num_dead_ends)];
+        if(live_triangles[vertex] > 0) { return vertex; }
+    }
+    while(*cursor < num_vertices)
+    {
+        if(live_triangles[*cursor] > 0) { return *cursor; }
+        (*cursor)++;
+    }
+    return N3DC_OBJ_MISSING_INDEX;
+}
+
+// Reorders the triangles in indices for the GPU's post-transform vertex cache with Tipsify
+// (Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw"), then renumbers the vertices in the order the triangles first use them so that
+// vertex fetch is sequential. vertex_corners maps each vertex to its face corner and is permuted
+// to match, so the vertices can be gathered straight into their new order. If there are
+// submeshes, the reordered triangles are then stably sorted back into their submeshes so that
+// each submesh's range keeps its triangles, in the order Tipsify emitted them.
+static int n3dc_obj_optimize_vertex_cache(
+    n3dc_obj_scratch_t* scratch, unsigned int* indices, const unsigned int num_indices, 
+    unsigned int* vertex_corners, const unsigned int num_vertices, const unsigned int cache_size,
+    const n3dc_obj_submesh_t* submeshes, const unsigned int num_submeshes
+){
+    const unsigned int num_triangles = num_indices / 3;
+    const size_t vertex_array_size = sizeof(unsigned int) * ((size_t)num_vertices + 1);
+    const size_t index_array_size = sizeof(unsigned int) * ((size_t)num_indices + 1);
+    // Vertex-to-triangle adjacency in compressed rows.
+    unsigned int* adjacency_offsets = (unsigned int*)n3dc_obj_scratch_allocate(scratch, vertex_array_size);
+    unsigned int* adjacency = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    unsigned int* live_triangles = (unsigned int*)n3dc_obj_scratch_allocate(scratch, vertex_array_size);
+    unsigned int* cache_times = (unsigned int*)n3dc_obj_scratch_allocate(scratch, vertex_array_size);
+    unsigned int* dead_ends = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    unsigned int* candidates = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    unsigned int* ordered_indices = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    unsigned int* ordered_triangles = (unsigned int*)n3dc_obj_scratch_allocate(
+        scratch, sizeof(unsigned int) * ((size_t)num_triangles + 1)
+    );
+    unsigned char* is_emitted = (unsigned char*)n3dc_obj_scratch_allocate(scratch, (size_t)num_triangles + 1);
+    void* arrays[9] = {
+        adjacency_offsets, adjacency, live_triangles, cache_times, 
+        dead_ends, candidates, ordered_indices, ordered_triangles, is_emitted
+    };
+    int error = 0;
+    for(unsigned int i = 0; i < 9; i++) { if(!arrays[i]) { error = -1; } }
+    if(!error)
+    {
+        memset(live_triangles, 0, vertex_array_size);
+        for(unsigned int i = 0; i < num_triangles * 3; i++) { live_triangles[indices[i]]++; }
+        adjacency_offsets[0] = 0;
+        for(unsigned int i = 0; i < num_vertices; i++)
+        {
+            adjacency_offsets[i + 1] = adjacency_offsets[i] + live_triangles[i];
+        }
+        memcpy(cache_times, adjacency_offsets, vertex_array_size);
+        for(unsigned int i = 0; i < num_triangles * 3; i++) { adjacency[cache_times[indices[i]]++] = i / 3; }
+        memset(cache_times, 0, vertex_array_size);
+        memset(is_emitted, 0, (size_t)num_triangles + 1);
+
+        unsigned int time = cache_size + 1;
+        unsigned int num_dead_ends = 0;
+        unsigned int cursor = 0;
+        unsigned int num_ordered = 0;
+        unsigned int vertex = num_triangles > 0 ? indices[0] : N3DC_OBJ_MISSING_INDEX;
+        while(vertex != N3DC_OBJ_MISSING_INDEX)
+        {
+            unsigned int num_candidates = 0;
+            for(unsigned int i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++)
+            {
+                const unsigned int triangle = adjacency[i];
+                if(is_emitted[triangle]) { continue; }
+                is_emitted[triangle] = 1;
+                ordered_triangles[num_ordered++] = triangle;
+                for(unsigned int j = 0; j < 3; j++)
+                {
+                    const unsigned int triangle_vertex = indices[(size_t)triangle * 3 + j];
+                    dead_ends[num_dead_ends++] = triangle_vertex;
+                    candidates[num_candidates++] = triangle_vertex;
+                    live_triangles[triangle_vertex]--;
+                    if(time - cache_times[triangle_vertex] > cache_size) { cache_times[triangle_vertex] = time++; }
+                }
+            }
+            vertex = n3dc_obj_get_next_fanning_vertex(
+                candidates, num_candidates, live_triangles, cache_times, time, cache_size,
+                dead_ends, &num_dead_ends, &cursor, num_vertices
+            );
+        }
+
+        // Counting sort the triangles by submesh, reusing the arrays that are no longer needed.
+        // Submeshes cover the triangles in order, so each one's triangles start at its first index.
+        if(num_submeshes > 1)
+        {
+            unsigned int* triangle_submeshes = dead_ends;
+            unsigned int* next_triangles = adjacency;
+            unsigned int* sorted_triangles = candidates;
+            for(unsigned int i = 0; i < num_submeshes; i++)
+            {
+                const unsigned int first_triangle = submeshes[i].first_index / 3;
+                const unsigned int end_triangle = first_triangle + submeshes[i].num_indices / 3;
+                for(unsigned int j = first_triangle; j < end_triangle; j++) { triangle_submeshes[j] = i; }
+                next_triangles[i] = first_triangle;
+            }
+            for(unsigned int i = 0; i < num_ordered; i++)
+            {
+                const unsigned int triangle = ordered_triangles[i];
+                sorted_triangles[next_triangles[triangle_submeshes[triangle]]++] = triangle;
+            }
+            memcpy(ordered_triangles, sorted_triangles, sizeof(unsigned int) * num_ordered);
+        }
+        for(unsigned int i = 0; i < num_ordered; i++)
+        {
+            const unsigned int triangle = ordered_triangles[i];
+            ordered_indices[(size_t)i * 3] = indices[(size_t)triangle * 3];
+            ordered_indices[(size_t)i * 3 + 1] = indices[(size_t)triangle * 3 + 1];
+            ordered_indices[(size_t)i * 3 + 2] = indices[(size_t)triangle * 3 + 2];
+        }
+
+        // Renumber the vertices in first-use order, reusing the arrays that are no longer needed.
+        unsigned int* new_vertices = live_triangles;
+        unsigned int* new_vertex_corners = cache_times;
+        memset(new_vertices, 0xFF, vertex_array_size);
+        unsigned int num_new_vertices = 0;
+        for(unsigned int i = 0; i < num_ordered * 3; i++)
+        {
+            const unsigned int old_vertex = ordered_indices[i];
+            if(new_vertices[old_vertex] == N3DC_OBJ_MISSING_INDEX)
+            {
+                new_vertex_corners[num_new_vertices] = vertex_corners[old_vertex];
+                new_vertices[old_vertex] = num_new_vertices++;
+            }
+            indices[i] = new_vertices[old_vertex];
+        }
+        memcpy(vertex_corners, new_vertex_corners, sizeof(unsigned int) * num_new_vertices);
+    }
+    for(unsigned int i = 0; i < 9; i++) { if(arrays[i]) { n3dc_obj_scratch_deallocate(scratch, arrays[i]); } }
+    return error;
+}
+
+// A range of triangles or vertices that one thread generates normals for.
+typedef struct
+{
+    const n3dc_obj_parse_state_t* state;
+    unsigned int first;
+    unsigned int end;
+    // Per-vertex sums for smooth normals, or per-triangle normals for flat normals.
+    float* normals;
+    // For smooth normals on several threads, every triangle's normal, and the face corners of
+    // each vertex in corner order, starting at corner_offsets[vertex].
+    const float* triangle_normals;
+    const unsigned int* corner_offsets;
+    const unsigned int* corners;
+    int error;
+} n3dc_obj_normal_task_t;
+
+// Computes the cross product of a triangle's edges, whose length is twice the triangle's area.
+// Returns -1 if the triangle has a vertex index that doesn't refer to a parsed vertex.
+static int n3dc_obj_get_triangle_normal(
+    const n3dc_obj_parse_state_t* state, const unsigned int triangle, float* normal
+){
+    const unsigned int* vertex_indices = &state->vertex_indices[(size_t)triangle * 3];
+    if(vertex_indices[0] >= state->parsed_vertices 
+        || vertex_indices[1] >= state->parsed_vertices 
+        || vertex_indices[2] >= state->parsed_vertices)
+    {
+        return -1;
+    }
+    const float* p0 = &state->vertices[(size_t)vertex_indices[0] * 3];
+    const float* p1 = &state->vertices[(size_t)vertex_indices[1] * 3];
+    const float* p2 = &state->vertices[(size_t)vertex_indices[2] * 3];
+    const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    return 0;
+}
+
+// 1 / sqrt(x) for x > 0 without depending on libm. The initial guess comes from the float's bits
+// and three Newton-Raphson steps bring it to within a couple of ulps.
+static float n3dc_obj_reciprocal_sqrt(const float x)
+{
+    unsigned int bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F375A86u - (bits >> 1);
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+    const float half_x = 0.5f * x;
+    y = y * (1.5f - half_x * y * y);
+    y = y * (1.5f - half_x * y * y);
+    y = y * (1.5f - half_x * y * y);
+    return y;
+}
+
+static float n3dc_obj_abs(const float x) { return x < 0.0f ? -x : x; }
+
+static void n3dc_obj_normalize_normals(float* normals, const unsigned int num_normals)
+{
+    for(size_t i = 0; i < (size_t)num_normals * 3; i += 3)
+    {
+        // Dividing by the largest component first keeps tiny and huge normals from underflowing or
+        // overflowing when they're squared.
+        float largest = n3dc_obj_abs(normals[i]);
+        if(n3dc_obj_abs(normals[i+1]) > largest) { largest = n3dc_obj_abs(normals[i+1]); }
+        if(n3dc_obj_abs(normals[i+2]) > largest) { largest = n3dc_obj_abs(normals[i+2]); }
+        if(!(largest > 0.0f))
+        {
+            normals[i] = normals[i+1] = normals[i+2] = 0.0f;
+            continue;
+        }
+        const float x = normals[i] / largest;
+        const float y = normals[i+1] / largest;
+        const float z = normals[i+2] / largest;
+        const float scale = n3dc_obj_reciprocal_sqrt(x * x + y * y + z * z);
+        normals[i] = x * scale;
+        normals[i+1] = y * scale;
+        normals[i+2] = z * scale;
+    }
+}
+
+// Adds the area-weighted normal of every triangle to its vertices' sums, on one thread.
+static void n3dc_obj_accumulate_smooth_normals(n3dc_obj_normal_task_t* t)
+{
+    memset(t->normals, 0, sizeof(float) * 3 * t->state->parsed_vertices);
+    for(unsigned int i = t->first; i < t->end && !t->error; i++)
+    {
+        float normal[3];
+        t->error = n3dc_obj_get_triangle_normal(t->state, i, normal);
+        for(unsigned int j = 0; j < 3 && !t->error; j++)
+        {
+            float* sum = &t->normals[(size_t)t->state->vertex_indices[(size_t)i * 3 + j] * 3];
+            sum[0] += normal[0];
+            sum[1] += normal[1];
+            sum[2] += normal[2];
+        }
+    }
+    if(!t->error) { n3dc_obj_normalize_normals(t->normals, t->state->parsed_vertices); }
+}
+
+// Sums the normals of each vertex's triangles for the task's range of vertices, then normalizes
+// them. The triangles are added in the order n3dc_obj_accumulate_smooth_normals adds them, so
+// the sums round the same way whatever the number of threads.
+static void n3dc_obj_sum_smooth_normals(void* task)
+{
+    n3dc_obj_normal_task_t* t = (n3dc_obj_normal_task_t*)task;
+    for(unsigned int i = t->first; i < t->end; i++)
+    {
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        for(unsigned int j = t->corner_offsets[i]; j < t->corner_offsets[i + 1]; j++)
+        {
+            const float* normal = &t->triangle_normals[(size_t)(t->corners[j] / 3) * 3];
+            sum[0] += normal[0];
+            sum[1] += normal[1];
+            sum[2] += normal[2];
+        }
+        memcpy(&t->normals[(size_t)i * 3], sum, sizeof(sum));
+    }
+    n3dc_obj_normalize_normals(&t->normals[(size_t)t->first * 3], t->end - t->first);
+}
+
+static void n3dc_obj_compute_triangle_normals(void* task)
+{
+    n3dc_obj_normal_task_t* t = (n3dc_obj_normal_task_t*)task;
+    for(unsigned int i = t->first; i < t->end && !t->error; i++)
+    {
+        t->error = n3dc_obj_get_triangle_normal(t->state, i, &t->normals[(size_t)i * 3]);
+    }
+}
+
+static void n3dc_obj_compute_flat_normals(void* task)
+{
+    n3dc_obj_normal_task_t* t = (n3dc_obj_normal_task_t*)task;
+    n3dc_obj_compute_triangle_normals(task);
+    if(!t->error) { n3dc_obj_normalize_normals(&t->normals[(size_t)t->first * 3], t->end - t->first); }
+}
+
+// Sorts the face corners by vertex with a counting sort, keeping corner order within each vertex.
+// corner_offsets needs room for parsed_vertices + 1 offsets. Every vertex index must have been
+// checked already.
+static void n3dc_obj_sort_corners_by_vertex(
+    const n3dc_obj_parse_state_t* state, const unsigned int num_corners,
+    unsigned int* corner_offsets, unsigned int* corners
+){
+    memset(corner_offsets, 0, sizeof(unsigned int) * ((size_t)state->parsed_vertices + 1));
+    for(unsigned int i = 0; i < num_corners; i++) { corner_offsets[state->vertex_indices[i] + 1]++; }
+    for(unsigned int i = 0; i < state->parsed_vertices; i++) { corner_offsets[i + 1] += corner_offsets[i]; }
+    for(unsigned int i = 0; i < num_corners; i++) { corners[corner_offsets[state->vertex_indices[i]]++] = i; }
+    // Filling in the corners moved each offset to the start of the next vertex's corners.
+    for(unsigned int i = state->parsed_vertices; i > 0; i--) { corner_offsets[i] = corner_offsets[i - 1]; }
+    corner_offsets[0] = 0;
+}
+
+// Generates normals for the face corners that don't have a normal index. The generated normals
+// are appended to a copy of the state's normals, and the corners' normal indices are pointed at
+// them, so the rest of the load (including welding) treats them like normals from the file.
+// On several threads, smooth normals are summed per vertex from the triangles' normals so that
+// threads never write to the same vertex, and so that they match a serial load exactly.
+static int n3dc_obj_generate_normals(
+    n3dc_obj_parse_state_t* state, const n3dc_obj_normal_mode_t normal_mode, unsigned int num_threads
+){
+    if(normal_mode == N3DC_OBJ_NORMALS_FROM_FILE) { return 0; }
+    unsigned int num_missing = 0;
+    for(unsigned int i = 0; i < state->parsed_indices; i++)
+    {
+        num_missing += (state->normal_indices[i] == N3DC_OBJ_MISSING_INDEX);
+    }
+    if(num_missing == 0) { return 0; }
+
+    const unsigned int num_triangles = state->parsed_indices / 3;
+    const unsigned int num_generated = (normal_mode == N3DC_OBJ_NORMALS_FLAT) 
+        ? num_triangles : state->parsed_vertices;
+    if(num_generated > (unsigned int)-2 - state->parsed_normals)
+    {
+        return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_TOO_MANY_NORMALS);
+    }
+    num_threads = n3dc_obj_clamp_threads(num_threads, num_triangles, N3DC_OBJ_MIN_TASK_SIZE);
+    const int smooth = normal_mode == N3DC_OBJ_NORMALS_SMOOTH;
+    // Smooth normals on several threads sort the face corners by vertex.
+    const int sorted = smooth && num_threads > 1;
+
+    if(state->generated_normals) { n3dc_obj_scratch_deallocate(state->scratch, state->generated_normals); }
+    const size_t normals_size = sizeof(float) * 3 * ((size_t)state->parsed_normals + num_generated);
+    float* normals = (float*)n3dc_obj_scratch_allocate(state->scratch, normals_size > 0 ? normals_size : 1);
+    state->generated_normals = normals;
+    n3dc_obj_normal_task_t* tasks = (n3dc_obj_normal_task_t*)n3dc_obj_scratch_allocate(
+        state->scratch, sizeof(n3dc_obj_normal_task_t) * num_threads
+    );
+    float* triangle_normals = NULL;
+    unsigned int* corner_offsets = NULL;
+    unsigned int* corners = NULL;
+    if(sorted)
+    {
+        triangle_normals = (float*)n3dc_obj_scratch_allocate(state->scratch, sizeof(float) * 3 * num_triangles);
+        corner_offsets = (unsigned int*)n3dc_obj_scratch_allocate(
+            state->scratch, sizeof(unsigned int) * ((size_t)state->parsed_vertices + 1)
+        );
+        corners = (unsigned int*)n3dc_obj_scratch_allocate(state->scratch, sizeof(unsigned int) * num_triangles * 3);
+    }
+    int error = (!normals || !tasks || (sorted && (!triangle_normals || !corner_offsets || !corners))) ? -1 : 0;
+    if(error) { n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    else
+    {
+        memset(tasks, 0, sizeof(n3dc_obj_normal_task_t) * num_threads);
+        memcpy(normals, state->normals, sizeof(float) * 3 * state->parsed_normals);
+        float* generated_normals = &normals[(size_t)state->parsed_normals * 3];
+        for(unsigned int i = 0; i < num_threads; i++)
+        {
+            tasks[i].state = state;
+            tasks[i].first = (unsigned int)((unsigned long long)num_triangles * i / num_threads);
+            tasks[i].end = (unsigned int)((unsigned long long)num_triangles * (i + 1) / num_threads);
+            tasks[i].normals = triangle_normals ? triangle_normals : generated_normals;
+            tasks[i].triangle_normals = triangle_normals;
+            tasks[i].corner_offsets = corner_offsets;
+            tasks[i].corners = corners;
+        }
+        if(smooth && num_threads == 1) { n3dc_obj_accumulate_smooth_normals(&tasks[0]); }
+        else
+        {
+            n3dc_obj_run_tasks(
+                state->scratch, tasks, sizeof(n3dc_obj_normal_task_t), num_threads, 
+                smooth ? n3dc_obj_compute_triangle_normals : n3dc_obj_compute_flat_normals
+            );
+        }
+        for(unsigned int i = 0; i < num_threads && !error; i++) { error = tasks[i].error; }
+        if(error) { n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE); }
+        else if(sorted)
+        {
+            n3dc_obj_sort_corners_by_vertex(state, num_triangles * 3, corner_offsets, corners);
+            for(unsigned int i = 0; i < num_threads; i++)
+            {
+                tasks[i].first = (unsigned int)((unsigned long long)state->parsed_vertices * i / num_threads);
+                tasks[i].end = (unsigned int)((unsigned long long)state->parsed_vertices * (i + 1) / num_threads);
+                tasks[i].normals = generated_normals;
+            }
+            n3dc_obj_run_tasks(
+                state->scratch, tasks, sizeof(n3dc_obj_normal_task_t), num_threads, n3dc_obj_sum_smooth_normals
+            );
+        }
+    }
+    if(corners) { n3dc_obj_scratch_deallocate(state->scratch, corners); }
+    if(corner_offsets) { n3dc_obj_scratch_deallocate(state->scratch, corner_offsets); }
+    if(triangle_normals) { n3dc_obj_scratch_deallocate(state->scratch, triangle_normals); }
+    if(tasks) { n3dc_obj_scratch_deallocate(state->scratch, tasks); }
+    if(error) { return -1; }
+
+    for(unsigned int i = 0; i < state->parsed_indices; i++)
+    {
+        if(state->normal_indices[i] != N3DC_OBJ_MISSING_INDEX) { continue; }
+        state->normal_indices[i] = state->parsed_normals 
+            + ((normal_mode == N3DC_OBJ_NORMALS_FLAT) ? i / 3 : state->vertex_indices[i]);
+    }
+    state->normals = normals;
+    state->parsed_normals += num_generated;
+    return 0;
+}
+
+// An edge collapse that moves position from onto position to.
+typedef struct
+{
+    float cost;
+    unsigned int from;
+    unsigned int to;
+} n3dc_obj_collapse_t;
+
+// Sorts collapses by cost with a radix sort over the bits of the costs, which sort like unsigned
+// integers since they're never negative. Returns whichever of collapses and temp holds the result.
+static n3dc_obj_collapse_t* n3dc_obj_sort_collapses(
+    n3dc_obj_collapse_t* collapses, n3dc_obj_collapse_t* temp, const unsigned int num_collapses
+){
+    unsigned int counts[2048];
+    for(unsigned int shift = 0; shift < 32; shift += 11)
+    {
+        memset(counts, 0, sizeof(counts));
+        for(unsigned int i = 0; i < num_collapses; i++)
+        {
+            unsigned int bits;
+            memcpy(&bits, &collapses[i].cost, sizeof(bits));
+            counts[(bits >> shift) & 2047]++;
+        }
+        unsigned int offset = 0;
+        for(unsigned int i = 0; i < 2048; i++)
+        {
+            const unsigned int count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+        for(unsigned int i = 0; i < num_collapses; i++)
+        {
+            unsigned int bits;
+            memcpy(&bits, &collapses[i].cost, sizeof(bits));
+            temp[counts[(bits >> shift) & 2047]++] = collapses[i];
+        }
+        n3dc_obj_collapse_t* sorted = temp;
+        temp = collapses;
+        collapses = sorted;
+    }
+    return collapses;
+}
+
+// Working arrays for n3dc_obj_generate_lods. The mesh is simplified over the positions of the
+// welded vertices rather than the welded vertices themselves, so that collapses don't tear the
+// mesh apart along texture and normal seams. Positions are the OBJ file's vertex indices.
+typedef struct
+{
+    const n3dc_obj_parse_state_t* state;
+    unsigned int num_vertices;
+    // The position of each welded vertex.
+    unsigned int* positions;
+    // The error quadric of each position, as the 10 unique values of the symmetric 4x4 matrix.
+    double* quadrics;
+    // Positions on a border or non-manifold edge, which are never moved.
+    unsigned char* is_locked;
+    // Positions that were moved or that neighbor a moved position in the current round.
+    unsigned char* is_round_locked;
+    unsigned int* collapse_targets;
+    // A welded vertex of each collapse target position, for welded vertices that don't share a
+    // triangle with the target.
+    unsigned int* fallbacks;
+    unsigned int* adjacency_offsets;
+    unsigned int* adjacency;
+    unsigned int* remap;
+    n3dc_obj_collapse_t* collapses;
+    n3dc_obj_collapse_t* sorted_collapses;
+} n3dc_obj_simplifier_t;
+
+static void n3dc_obj_add_plane_quadric(double* quadric, const float* plane, const float weight)
+{
+    const double a = plane[0], b = plane[1], c = plane[2], d = plane[3];
+    quadric[0] += weight * a * a;
+    quadric[1] += weight * a * b;
+    quadric[2] += weight * a * c;
+    quadric[3] += weight * a * d;
+    quadric[4] += weight * b * b;
+    quadric[5] += weight * b * c;
+    quadric[6] += weight * b * d;
+    quadric[7] += weight * c * c;
+    quadric[8] += weight * c * d;
+    quadric[9] += weight * d * d;
+}
+
+// The sum of squared distances from p to the quadric's planes.
+static float n3dc_obj_get_quadric_error(const double* q, const double* q2, const float* p)
+{
+    double sums[10];
+    for(unsigned int i = 0; i < 10; i++) { sums[i] = q[i] + q2[i]; }
+    const double x = p[0], y = p[1], z = p[2];
+    const double error = sums[0] * x * x + 2.0 * sums[1] * x * y + 2.0 * sums[2] * x * z + 2.0 * sums[3] * x
+        + sums[4] * y * y + 2.0 * sums[5] * y * z + 2.0 * sums[6] * y
+        + sums[7] * z * z + 2.0 * sums[8] * z
+        + sums[9];
+    return error > 0.0 ? (float)error : 0.0f;
+}
+
+static const float* n3dc_obj_get_position(const n3dc_obj_simplifier_t* s, const unsigned int position)
+{
+    return &s->state->vertices[(size_t)position * 3];
+}
+
+static void n3dc_obj_get_cross_product(const float* p0, const float* p1, const float* p2, float* normal)
+{
+    const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Builds the position-to-triangle adjacency of the triangles in compressed rows.
+static void n3dc_obj_build_position_adjacency(
+    n3dc_obj_simplifier_t* s, const unsigned int* triangles, const unsigned int num_indices
+){
+    const unsigned int num_positions = s->state->parsed_vertices;
+    memset(s->adjacency_offsets, 0, sizeof(unsigned int) * ((size_t)num_positions + 1));
+    for(unsigned int i = 0; i < num_indices; i++) { s->adjacency_offsets[s->positions[triangles[i]]]++; }
+    for(unsigned int i = 1; i < num_positions; i++) { s->adjacency_offsets[i] += s->adjacency_offsets[i - 1]; }
+    s->adjacency_offsets[num_positions] = num_indices;
+    // Fill each row from its end so that the offsets end up at the row starts.
+    for(unsigned int i = num_indices; i-- > 0;)
+    {
+        s->adjacency[--s->adjacency_offsets[s->positions[triangles[i]]]] = i / 3;
+    }
+}
+
+// Returns the number of triangles around position a that also use position b.
+static unsigned int n3dc_obj_count_edge_triangles(
+    const n3dc_obj_simplifier_t* s, const unsigned int* triangles, const unsigned int a, const unsigned int b
+){
+    unsigned int count = 0;
+    for(unsigned int i = s->adjacency_offsets[a]; i < s->adjacency_offsets[a + 1]; i++)
+    {
+        const unsigned int* triangle = &triangles[(size_t)s->adjacency[i] * 3];
+        count += s->positions[triangle[0]] == b || s->positions[triangle[1]] == b || s->positions[triangle[2]] == b;
+    }
+    return count;
+}
+
+// Returns 1 if position from can be moved onto position to. The move is rejected if it would
+// flip or collapse one of the triangles around from that are kept, or if one of from's welded
+// vertices doesn't share a triangle with to, since that vertex's attributes (e.g. the far side of
+// a texture seam) would have nowhere sensible to go.
+static int n3dc_obj_is_valid_collapse(
+    const n3dc_obj_simplifier_t* s, const unsigned int* triangles, const unsigned int from, const unsigned int to
+){
+    // The welded vertices of from in the triangles that the collapse removes.
+    unsigned int edge_vertices[4];
+    unsigned int num_edge_vertices = 0;
+    for(unsigned int i = s->adjacency_offsets[from]; i < s->adjacency_offsets[from + 1]; i++)
+    {
+        const unsigned int* triangle = &triangles[(size_t)s->adjacency[i] * 3];
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            if(s->positions[triangle[j]] != to) { continue; }
+            if(num_edge_vertices == 4) { return 0; }
+            for(unsigned int k = 0; k < 3; k++)
+            {
+                if(s->positions[triangle[k]] == from) { edge_vertices[num_edge_vertices++] = triangle[k]; }
+            }
+        }
+    }
+    for(unsigned int i = s->adjacency_offsets[from]; i < s->adjacency_offsets[from + 1]; i++)
+    {
+        const unsigned int* triangle = &triangles[(size_t)s->adjacency[i] * 3];
+        const unsigned int corner_positions[3] = {
+            s->positions[triangle[0]], s->positions[triangle[1]], s->positions[triangle[2]]
+        };
+        if(corner_positions[0] == to || corner_positions[1] == to || corner_positions[2] == to) { continue; }
+        const unsigned int from_vertex = triangle[corner_positions[0] == from ? 0 : (corner_positions[1] == from ? 1 : 2)];
+        int has_edge_vertex = 0;
+        for(unsigned int j = 0; j < num_edge_vertices; j++) { has_edge_vertex |= edge_vertices[j] == from_vertex; }
+        if(!has_edge_vertex) { return 0; }
+        const float* old_points[3];
+        const float* new_points[3];
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            old_points[j] = n3dc_obj_get_position(s, corner_positions[j]);
+            new_points[j] = n3dc_obj_get_position(s, corner_positions[j] == from ? to : corner_positions[j]);
+        }
+        float old_normal[3];
+        float new_normal[3];
+        n3dc_obj_get_cross_product(old_points[0], old_points[1], old_points[2], old_normal);
+        n3dc_obj_get_cross_product(new_points[0], new_points[1], new_points[2], new_normal);
+        // Reject turning a triangle by more than about 75 degrees, since a string of smaller
+        // turns can still fold the surface over.
+        // Doubles keep the products of large coordinates from overflowing.
+        double dot = 0.0;
+        double old_length_squared = 0.0;
+        double new_length_squared = 0.0;
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            dot += (double)old_normal[j] * new_normal[j];
+            old_length_squared += (double)old_normal[j] * old_normal[j];
+            new_length_squared += (double)new_normal[j] * new_normal[j];
+        }
+        if(old_length_squared > 0.0 && (dot <= 0.0 || dot * dot < 0.0625 * old_length_squared * new_length_squared))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Runs one round of edge collapses on triangles. The cheapest collapses are taken first, and a
+// collapse locks the 1-ring of the position it moves for the rest of the round so that every
+// flip check sees the final positions of its neighbors. Returns the new number of indices.
+static unsigned int n3dc_obj_simplify_round(
+    n3dc_obj_simplifier_t* s, unsigned int* triangles, const unsigned int num_indices, 
+    const unsigned int target_indices
+){
+    const unsigned int num_positions = s->state->parsed_vertices;
+    n3dc_obj_build_position_adjacency(s, triangles, num_indices);
+    unsigned int num_collapses = 0;
+    for(unsigned int i = 0; i < num_indices; i++)
+    {
+        const unsigned int a = s->positions[triangles[i]];
+        const unsigned int b = s->positions[triangles[i - i % 3 + (i + 1) % 3]];
+        // Interior edges show up once in each direction, and border edges are locked anyway.
+        if(a >= b) { continue; }
+        const double* quadric_a = &s->quadrics[(size_t)a * 10];
+        const double* quadric_b = &s->quadrics[(size_t)b * 10];
+        n3dc_obj_collapse_t collapse = {0.0f, a, b};
+        const float cost_ab = n3dc_obj_get_quadric_error(quadric_a, quadric_b, n3dc_obj_get_position(s, b));
+        const float cost_ba = n3dc_obj_get_quadric_error(quadric_a, quadric_b, n3dc_obj_get_position(s, a));
+        if(!s->is_locked[a] && (s->is_locked[b] || cost_ab <= cost_ba)) { collapse.cost = cost_ab; }
+        else if(!s->is_locked[b])
+        {
+            collapse.cost = cost_ba;
+            collapse.from = b;
+            collapse.to = a;
+        }
+        else { continue; }
+        s->collapses[num_collapses++] = collapse;
+    }
+    const n3dc_obj_collapse_t* collapses = n3dc_obj_sort_collapses(s->collapses, s->sorted_collapses, num_collapses);
+
+    memset(s->is_round_locked, 0, num_positions);
+    memset(s->collapse_targets, 0xFF, sizeof(unsigned int) * num_positions);
+    unsigned int removed_indices = 0;
+    for(unsigned int i = 0; i < num_collapses && num_indices - removed_indices > target_indices; i++)
+    {
+        const unsigned int from = collapses[i].from;
+        const unsigned int to = collapses[i].to;
+        if(s->is_round_locked[from] || s->is_round_locked[to]) { continue; }
+        if(!n3dc_obj_is_valid_collapse(s, triangles, from, to)) { continue; }
+        s->collapse_targets[from] = to;
+        removed_indices += n3dc_obj_count_edge_triangles(s, triangles, from, to) * 3;
+        for(unsigned int j = s->adjacency_offsets[from]; j < s->adjacency_offsets[from + 1]; j++)
+        {
+            const unsigned int* triangle = &triangles[(size_t)s->adjacency[j] * 3];
+            for(unsigned int k = 0; k < 3; k++) { s->is_round_locked[s->positions[triangle[k]]] = 1; }
+        }
+        double* quadric_to = &s->quadrics[(size_t)to * 10];
+        const double* quadric_from = &s->quadrics[(size_t)from * 10];
+        for(unsigned int j = 0; j < 10; j++) { quadric_to[j] += quadric_from[j]; }
+    }
+    if(removed_indices == 0) { return num_indices; }
+
+    // Each welded vertex of a moved position becomes the welded vertex of the target position
+    // that it shares a triangle with, so that attributes follow the collapse where they can.
+    memset(s->remap, 0xFF, sizeof(unsigned int) * s->num_vertices);
+    for(unsigned int i = 0; i < num_indices; i++)
+    {
+        const unsigned int vertex = triangles[i];
+        const unsigned int target = s->collapse_targets[s->positions[vertex]];
+        if(target == N3DC_OBJ_MISSING_INDEX) { continue; }
+        for(unsigned int j = i - i % 3; j < i - i % 3 + 3; j++)
+        {
+            if(s->positions[triangles[j]] != target) { continue; }
+            if(s->remap[vertex] == N3DC_OBJ_MISSING_INDEX) { s->remap[vertex] = triangles[j]; }
+            s->fallbacks[target] = triangles[j];
+        }
+    }
+    unsigned int num_kept = 0;
+    for(unsigned int i = 0; i < num_indices; i += 3)
+    {
+        unsigned int triangle[3];
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            const unsigned int vertex = triangles[i + j];
+            const unsigned int target = s->collapse_targets[s->positions[vertex]];
+            triangle[j] = vertex;
+            if(target == N3DC_OBJ_MISSING_INDEX) { continue; }
+            triangle[j] = s->remap[vertex] != N3DC_OBJ_MISSING_INDEX ? s->remap[vertex] : s->fallbacks[target];
+        }
+        const unsigned int p0 = s->positions[triangle[0]];
+        const unsigned int p1 = s->positions[triangle[1]];
+        const unsigned int p2 = s->positions[triangle[2]];
+        if(p0 == p1 || p1 == p2 || p2 == p0) { continue; }
+        memcpy(&triangles[num_kept], triangle, sizeof(triangle));
+        num_kept += 3;
+    }
+    return num_kept;
+}
+
+// Generates the requested LODs of the welded triangles in indices by quadric edge collapse
+// (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"). Each LOD
+// continues simplifying from the one before it, so every LOD only uses vertices of the finer
+// ones, and the vertices are then reordered so that the coarsest LOD's vertices come first. A
+// prefix of the vertex buffer is then enough to draw any LOD. vertex_corners is permuted to
+// match, like n3dc_obj_optimize_vertex_cache does.
+static int n3dc_obj_generate_lods(
+    n3dc_obj_parse_state_t* state, n3dc_obj_t* obj, unsigned int* vertex_corners, 
+    const unsigned int num_vertices, const n3dc_obj_load_options_t* options
+){
+    const n3dc_obj_allocator_t* allocator = options->allocator;
+    n3dc_obj_scratch_t* scratch = state->scratch;
+    const unsigned int num_positions = state->parsed_vertices;
+    const size_t position_array_size = sizeof(unsigned int) * ((size_t)num_positions + 1);
+    const size_t index_array_size = sizeof(unsigned int) * ((size_t)obj->num_indices + 1);
+    obj->lods = (n3dc_obj_lod_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_lod_t) * options->num_lods);
+    if(obj->lods) 
+    {
+        memset(obj->lods, 0, sizeof(n3dc_obj_lod_t) * options->num_lods);
+        obj->num_lods = options->num_lods;
+    }
+    n3dc_obj_simplifier_t s;
+    memset(&s, 0, sizeof(n3dc_obj_simplifier_t));
+    s.state = state;
+    s.num_vertices = num_vertices;
+    s.positions = (unsigned int*)n3dc_obj_scratch_allocate(scratch, sizeof(unsigned int) * ((size_t)num_vertices + 1));
+    s.quadrics = (double*)n3dc_obj_scratch_allocate(scratch, sizeof(double) * 10 * ((size_t)num_positions + 1));
+    s.is_locked = (unsigned char*)n3dc_obj_scratch_allocate(scratch, (size_t)num_positions + 1);
+    s.is_round_locked = (unsigned char*)n3dc_obj_scratch_allocate(scratch, (size_t)num_positions + 1);
+    s.collapse_targets = (unsigned int*)n3dc_obj_scratch_allocate(scratch, position_array_size);
+    s.fallbacks = (unsigned int*)n3dc_obj_scratch_allocate(scratch, position_array_size);
+    s.adjacency_offsets = (unsigned int*)n3dc_obj_scratch_allocate(scratch, position_array_size);
+    s.adjacency = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    s.remap = (unsigned int*)n3dc_obj_scratch_allocate(scratch, sizeof(unsigned int) * ((size_t)num_vertices + 1));
+    s.collapses = (n3dc_obj_collapse_t*)n3dc_obj_scratch_allocate(
+        scratch, sizeof(n3dc_obj_collapse_t) * ((size_t)obj->num_indices + 1)
+    );
+    s.sorted_collapses = (n3dc_obj_collapse_t*)n3dc_obj_scratch_allocate(
+        scratch, sizeof(n3dc_obj_collapse_t) * ((size_t)obj->num_indices + 1)
+    );
+    unsigned int* triangles = (unsigned int*)n3dc_obj_scratch_allocate(scratch, index_array_size);
+    unsigned int* band_starts = (unsigned int*)n3dc_obj_scratch_allocate(
+        scratch, sizeof(unsigned int) * ((size_t)options->num_lods + 2)
+    );
+    void* arrays[14] = {
+        obj->lods, s.positions, s.quadrics, s.is_locked, s.is_round_locked, s.collapse_targets, 
+        s.fallbacks, s.adjacency_offsets, s.adjacency, s.remap, s.collapses, s.sorted_collapses, 
+        triangles, band_starts
+    };
+    int error = 0;
+    for(unsigned int i = 0; i < 14; i++) { if(!arrays[i]) { error = -1; } }
+    if(error) { n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    for(unsigned int i = 0; i < num_vertices && !error; i++)
+    {
+        s.positions[i] = state->vertex_indices[vertex_corners[i]];
+        if(s.positions[i] >= num_positions)
+        {
+            error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE);
+        }
+    }
+
+    unsigned int num_indices = 0;
+    if(!error)
+    {
+        // Triangles that are already degenerate have nothing to contribute.
+        for(unsigned int i = 0; i < obj->num_indices; i += 3)
+        {
+            const unsigned int* triangle = &obj->indices[i];
+            const unsigned int p0 = s.positions[triangle[0]];
+            const unsigned int p1 = s.positions[triangle[1]];
+            const unsigned int p2 = s.positions[triangle[2]];
+            if(p0 == p1 || p1 == p2 || p2 == p0) { continue; }
+            memcpy(&triangles[num_indices], triangle, sizeof(unsigned int) * 3);
+            num_indices += 3;
+        }
+        // Every triangle adds its plane to its corners' quadrics, weighted by its area.
+        memset(s.quadrics, 0, sizeof(double) * 10 * num_positions);
+        for(unsigned int i = 0; i < num_indices; i += 3)
+        {
+            const unsigned int corner_positions[3] = {
+                s.positions[triangles[i]], s.positions[triangles[i + 1]], s.positions[triangles[i + 2]]
+            };
+            const float* p0 = n3dc_obj_get_position(&s, corner_positions[0]);
+            float plane[4];
+            n3dc_obj_get_cross_product(
+                p0, n3dc_obj_get_position(&s, corner_positions[1]), n3dc_obj_get_position(&s, corner_positions[2]), plane
+            );
+            const float length_squared = plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2];
+            if(!(length_squared > 0.0f)) { continue; }
+            const float inverse_length = n3dc_obj_reciprocal_sqrt(length_squared);
+            plane[0] *= inverse_length;
+            plane[1] *= inverse_length;
+            plane[2] *= inverse_length;
+            plane[3] = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+            const float area = 0.5f * length_squared * inverse_length;
+            for(unsigned int j = 0; j < 3; j++)
+            {
+                n3dc_obj_add_plane_quadric(&s.quadrics[(size_t)corner_positions[j] * 10], plane, area);
+            }
+        }
+        // Positions on borders and non-manifold edges are locked so that the outline of the
+        // mesh (and of any holes) stays put.
+        memset(s.is_locked, 0, num_positions);
+        n3dc_obj_build_position_adjacency(&s, triangles, num_indices);
+        for(unsigned int i = 0; i < num_indices; i++)
+        {
+            const unsigned int a = s.positions[triangles[i]];
+            const unsigned int b = s.positions[triangles[i - i % 3 + (i + 1) % 3]];
+            if(n3dc_obj_count_edge_triangles(&s, triangles, a, b) != 2) { s.is_locked[a] = s.is_locked[b] = 1; }
+        }
+    }
+
+    for(unsigned int i = 0; i < options->num_lods && !error; i++)
+    {
+        const unsigned int target_indices = (unsigned int)((double)(obj->num_indices / 3) * options->lod_ratios[i]) * 3;
+        while(num_indices > target_indices)
+        {
+            const unsigned int num_kept = n3dc_obj_simplify_round(&s, triangles, num_indices, target_indices);
+            if(num_kept == num_indices) { break; }
+            num_indices = num_kept;
+        }
+        n3dc_obj_lod_t* lod = &obj->lods[i];
+        lod->target_ratio = options->lod_ratios[i];
+        lod->num_indices = num_indices;
+        lod->indices = (unsigned int*)n3dc_obj_allocate(allocator, sizeof(unsigned int) * ((size_t)num_indices + 1));
+        if(!lod->indices) { error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+        else { memcpy(lod->indices, triangles, sizeof(unsigned int) * num_indices); }
+    }
+
+    if(!error)
+    {
+        // Sort the vertices by the coarsest LOD that uses them, keeping their order otherwise.
+        // Vertices that only the full mesh uses get band 0 and LOD i is band i + 1.
+        unsigned int* bands = s.remap;
+        unsigned int* new_vertices = s.positions;
+        unsigned int* new_vertex_corners = triangles;
+        const unsigned int num_bands = options->num_lods + 1;
+        memset(bands, 0, sizeof(unsigned int) * num_vertices);
+        for(unsigned int i = 0; i < options->num_lods; i++)
+        {
+            for(unsigned int j = 0; j < obj->lods[i].num_indices; j++) { bands[obj->lods[i].indices[j]] = i + 1; }
+        }
+        memset(band_starts, 0, sizeof(unsigned int) * (num_bands + 1));
+        for(unsigned int i = 0; i < num_vertices; i++) { band_starts[num_bands - bands[i]]++; }
+        for(unsigned int i = 0; i < num_bands; i++) { band_starts[i + 1] += band_starts[i]; }
+        for(unsigned int i = 0; i < options->num_lods; i++) { obj->lods[i].num_vertices = band_starts[num_bands - i - 1]; }
+        for(unsigned int i = 0; i < num_vertices; i++)
+        {
+            const unsigned int new_vertex = band_starts[num_bands - 1 - bands[i]]++;
+            new_vertices[i] = new_vertex;
+            new_vertex_corners[new_vertex] = vertex_corners[i];
+        }
+        memcpy(vertex_corners, new_vertex_corners, sizeof(unsigned int) * num_vertices);
+        for(unsigned int i = 0; i < obj->num_indices; i++) { obj->indices[i] = new_vertices[obj->indices[i]]; }
+        for(unsigned int i = 0; i < options->num_lods; i++)
+        {
+            for(unsigned int j = 0; j < obj->lods[i].num_indices; j++)
+            {
+                obj->lods[i].indices[j] = new_vertices[obj->lods[i].indices[j]];
+            }
+        }
+    }
+    for(unsigned int i = 1; i < 14; i++) { if(arrays[i]) { n3dc_obj_scratch_deallocate(scratch, arrays[i]); } }
+    return error;
+}
+
+// Every n3dc_obj_t is the first member of one of these so that n3dc_obj_free knows how its
+// arrays were allocated. Freeing an n3dc_obj_t from a default load with free() still works.
+typedef struct
+{
+    n3dc_obj_t obj;
+    n3dc_obj_allocator_t allocator;
+    int has_allocator;
+    int owns_interleaved_vertices;
+    // Set when the arrays point into a mapped cache file instead of being allocated.
+    int is_cached;
+    n3dc_obj_file_view_t cache_view;
+    // The layout of interleaved_vertices, recorded so that it can be written to cache files.
+    n3dc_obj_vertex_layout_t layout;
+    int has_layout;
+    n3dc_obj_normal_mode_t normal_mode;
+    // The cache size the indices were optimized for, or 0 if they weren't optimized.
+    unsigned int vertex_cache_size;
+    // The NUL-terminated names that the submeshes point into, recorded so that they can be
+    // written to cache files. They share the submeshes' allocation unless the obj is cached.
+    int has_submeshes;
+    const char* submesh_names;
+    size_t submesh_names_size;
+    // The attributes that were left out of the load.
+    unsigned int skip_attributes;
+    // Set when a BVH was requested, even if the mesh has no triangles to build it over.
+    int has_bvh;
+    // Set when materials were requested, in which case the resolved paths of the OBJ file's MTL
+    // files are recorded one after another, each ending with a NUL, so that cache files can
+    // attach the materials again.
+    int has_materials;
+    const char* material_library_paths;
+    size_t material_library_paths_size;
+} n3dc_obj_allocation_t;
+
+static n3dc_obj_t* n3dc_obj_allocate_output(const n3dc_obj_allocator_t* allocator)
+{
+    n3dc_obj_allocation_t* allocation = (n3dc_obj_allocation_t*)n3dc_obj_allocate(
+        allocator, sizeof(n3dc_obj_allocation_t)
+    );
+    if(!allocation) { return NULL; }
+    memset(allocation, 0, sizeof(n3dc_obj_allocation_t));
+    if(allocator)
+    {
+        allocation->allocator = *allocator;
+        allocation->has_allocator = 1;
+    }
+    return &allocation->obj;
+}
+
+void n3dc_obj_free(n3dc_obj_t* obj)
+{
+    if(!obj) { return; }
+    n3dc_obj_allocation_t* allocation = (n3dc_obj_allocation_t*)obj;
+    const n3dc_obj_allocator_t allocator_copy = allocation->allocator;
+    const n3dc_obj_allocator_t* allocator = allocation->has_allocator ? &allocator_copy : NULL;
+    if(allocation->is_cached) { n3dc_obj_unmap_text_file(&allocation->cache_view); }
+    else
+    {
+        n3dc_obj_deallocate(allocator, obj->vertices);
+        n3dc_obj_deallocate(allocator, obj->normals);
+        n3dc_obj_deallocate(allocator, obj->texture_coords);
+        n3dc_obj_deallocate(allocator, obj->indices);
+        if(allocation->owns_interleaved_vertices) { n3dc_obj_deallocate(allocator, obj->interleaved_vertices); }
+        for(unsigned int i = 0; obj->lods && i < obj->num_lods; i++) { n3dc_obj_deallocate(allocator, obj->lods[i].indices); }
+        n3dc_obj_deallocate(allocator, obj->bvh_nodes);
+        n3dc_obj_deallocate(allocator, obj->bvh_triangles);
+        n3dc_obj_deallocate(allocator, (void*)allocation->material_library_paths);
+    }
+    n3dc_obj_deallocate(allocator, obj->materials);
+    n3dc_obj_deallocate(allocator, obj->submeshes);
+    n3dc_obj_deallocate(allocator, obj->lods);
+    n3dc_obj_deallocate(allocator, allocation);
+}
+
+// Splits the parsed faces into submeshes wherever an o, g, or usemtl event comes between faces,
+// and computes each submesh's bounding box from its face corners. Vertex lines don't belong to
+// any group (faces can use vertices from anywhere in the file), so the bounds can only be
+// found once the faces are known. The submeshes and a copy of their names share one allocation.
+static int n3dc_obj_build_submeshes(
+    n3dc_obj_parse_state_t* state, n3dc_obj_t* obj, const n3dc_obj_allocator_t* allocator
+){
+    n3dc_obj_allocation_t* allocation = (n3dc_obj_allocation_t*)obj;
+    allocation->has_submeshes = 1;
+    unsigned int num_submeshes = 0;
+    unsigned int range_start = 0;
+    for(size_t i = 0; i < state->num_events; i++)
+    {
+        // mtllib lines don't change the faces' names.
+        if(state->events[i].type == N3DC_OBJ_LINE_MATERIAL_LIBRARY) { continue; }
+        if(state->events[i].first_index > range_start)
+        {
+            num_submeshes++;
+            range_start = state->events[i].first_index;
+        }
+    }
+    if(state->parsed_indices > range_start) { num_submeshes++; }
+    if(num_submeshes == 0) { return 0; }
+
+    const size_t submeshes_size = sizeof(n3dc_obj_submesh_t) * num_submeshes;
+    unsigned char* block = (unsigned char*)n3dc_obj_allocate(allocator, submeshes_size + state->names_length);
+    if(!block) { return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    char* names = (char*)&block[submeshes_size];
+    if(state->names_length > 0) { memcpy(names, state->names, state->names_length); }
+    obj->submeshes = (n3dc_obj_submesh_t*)block;
+    obj->num_submeshes = num_submeshes;
+    allocation->submesh_names = names;
+    allocation->submesh_names_size = state->names_length;
+
+    const char* current_names[3] = {NULL, NULL, NULL};
+    unsigned int submesh_index = 0;
+    range_start = 0;
+    for(size_t i = 0; i <= state->num_events; i++)
+    {
+        if(i < state->num_events && state->events[i].type == N3DC_OBJ_LINE_MATERIAL_LIBRARY) { continue; }
+        const unsigned int range_end = (i < state->num_events) ? state->events[i].first_index : state->parsed_indices;
+        if(range_end > range_start)
+        {
+            n3dc_obj_submesh_t* submesh = &obj->submeshes[submesh_index++];
+            memset(submesh, 0, sizeof(n3dc_obj_submesh_t));
+            submesh->first_index = range_start;
+            submesh->num_indices = range_end - range_start;
+            submesh->object_name = current_names[0];
+            submesh->group_name = current_names[1];
+            submesh->material_name = current_names[2];
+            submesh->material_index = N3DC_OBJ_MISSING_INDEX;
+            int has_bounds = 0;
+            for(unsigned int j = range_start; j < range_end; j++)
+            {
+                const unsigned int vertex_index = state->vertex_indices[j];
+                if(vertex_index >= state->parsed_vertices) { continue; }
+                const float* vertex = &state->vertices[(size_t)vertex_index * 3];
+                for(unsigned int k = 0; k < 3; k++)
+                {
+                    if(!has_bounds || vertex[k] < submesh->bounds_min[k]) { submesh->bounds_min[k] = vertex[k]; }
+                    if(!has_bounds || vertex[k] > submesh->bounds_max[k]) { submesh->bounds_max[k] = vertex[k]; }
+                }
+                has_bounds = 1;
+            }
+            range_start = range_end;
+        }
+        if(i < state->num_events)
+        {
+            const n3dc_obj_submesh_event_t* event = &state->events[i];
+            const char* name = &names[event->name_offset];
+            if(event->type == N3DC_OBJ_LINE_OBJECT) { current_names[0] = name; }
+            else if(event->type == N3DC_OBJ_LINE_GROUP) { current_names[1] = name; }
+            else { current_names[2] = name; }
+        }
+    }
+    return 0;
+}
+
+// An MTL file in the material cache. Files that couldn't be read are kept with no materials so
+// that they aren't tried again either.
+typedef struct n3dc_obj_material_library
+{
+    struct n3dc_obj_material_library* next;
+    unsigned int num_materials;
+    n3dc_obj_material_t* materials;
+    // The library's resolved path, followed by the NUL-terminated names and texture paths that
+    // the materials point into.
+    char* strings;
+} n3dc_obj_material_library_t;
+
+// The material cache is shared by every load in the process. The mutex is only held to look up
+// and insert libraries, never while one is read and parsed, so loads that need different
+// libraries don't wait on each other's disk I/O. Without threads there's no mutex, and the
+// caller keeps loads with materials on one thread.
+static n3dc_obj_material_library_t* n3dc_obj_material_libraries = NULL;
+#if defined(N3DC_OBJ_THREADS)
+static n3dc_obj_mutex_t n3dc_obj_material_mutex = N3DC_OBJ_MUTEX_INITIALIZER;
+#endif
+
+// Writes the path of the file called name relative to the directory of the file at base_path (or
+// to the current directory if base_path is NULL) to resolved, followed by a NUL. resolved needs
+// room for strlen(base_path) + name_length + 1 characters. Returns the length of the path.
+static size_t n3dc_obj_resolve_path(
+    const char* base_path, const char* name, const size_t name_length, char* resolved
+){
+    const int is_absolute = name_length > 0
+        && (name[0] == '/' || name[0] == '\\' || (name_length > 1 && name[1] == ':'));
+    size_t directory_length = 0;
+    for(size_t i = 0; base_path && !is_absolute && base_path[i] != '\0'; i++)
+    {
+        if(base_path[i] == '/' || base_path[i] == '\\') { directory_length = i + 1; }
+    }
+    if(directory_length > 0) { memcpy(resolved, base_path, directory_length); }
+    memcpy(&resolved[directory_length], name, name_length);
+    resolved[directory_length + name_length] = '\0';
+    return directory_length + name_length;
+}
+
+// Scans up to num_values space separated floats, stopping at the first word that isn't one.
+// Returns the number of floats scanned.
+static unsigned int n3dc_obj_scan_material_floats(
+    const char* chars, const size_t line_end, size_t offset, float* values, const unsigned int num_values
+){
+    unsigned int num_scanned = 0;
+    while(num_scanned < num_values)
+    {
+        offset = n3dc_obj_skip_spaces(chars, line_end, offset);
+        float value = 0.0f;
+        if(n3dc_obj_scan_float(chars, line_end, offset, &offset, &value)) { break; }
+        values[num_scanned++] = value;
+    }
+    return num_scanned;
+}
+
+// Parses an MTL file into a new library, with the file's materials in file order. Statements that
+// aren't recognized or can't be parsed are skipped. Returns NULL if there's no memory for the
+// library. A file that can't be read gives a library without materials.
+static n3dc_obj_material_library_t* n3dc_obj_parse_material_library(const char* path)
+{
+    const size_t path_length = strlen(path);
+    n3dc_obj_file_view_t view;
+    const int has_file = !n3dc_obj_map_text_file(path, NULL, &view, NULL);
+    const char* chars = has_file ? view.chars : NULL;
+    const size_t length = has_file ? view.length : 0;
+    // Counting every "newmtl" can only overcount the materials. Every name and texture path comes
+    // from a different line, and texture paths can gain the library's directory and a NUL.
+    unsigned int num_materials = 0;
+    size_t num_lines = 1;
+    for(size_t i = 0; i < length; i++)
+    {
+        if(chars[i] == '\n') { num_lines++; }
+        if(chars[i] == 'n' && i + 6 <= length && !memcmp(&chars[i], "newmtl", 6)) { num_materials++; }
+    }
+    n3dc_obj_material_library_t* library = (n3dc_obj_material_library_t*)malloc(sizeof(n3dc_obj_material_library_t));
+    char* strings = (char*)malloc(path_length + 1 + length + num_lines * (path_length + 1));
+    n3dc_obj_material_t* materials = (n3dc_obj_material_t*)malloc(
+        sizeof(n3dc_obj_material_t) * (num_materials > 0 ? num_materials : 1)
+    );
+    if(!library || !strings || !materials)
+    {
+        free(library);
+        free(strings);
+        free(materials);
+        if(has_file) { n3dc_obj_unmap_text_file(&view); }
+        return NULL;
+    }
+    memcpy(strings, path, path_length + 1);
+    size_t strings_length = path_length + 1;
+    library->next = NULL;
+    library->num_materials = 0;
+    library->materials = materials;
+    library->strings = strings;
+
+    n3dc_obj_material_t* material = NULL;
+    size_t line_start = 0;
+    while(line_start < length)
+    {
+        size_t line_end = length;
+        if(!n3dc_obj_seek_newline(chars, length, line_start, &line_end)) { line_end = length; }
+        const size_t keyword_start = n3dc_obj_skip_spaces(chars, line_end, line_start);
+        size_t keyword_end = keyword_start;
+        while(keyword_end < line_end && !n3dc_obj_is_space(chars[keyword_end])) { keyword_end++; }
+        const char* keyword = &chars[keyword_start];
+        const size_t keyword_length = keyword_end - keyword_start;
+        // The rest of the line without the surrounding spaces.
+        size_t value_start = n3dc_obj_skip_spaces(chars, line_end, keyword_end);
+        size_t value_end = line_end;
+        while(value_end > value_start && n3dc_obj_is_space(chars[value_end - 1])) { value_end--; }
+        line_start = line_end + 1;
+
+        if(keyword_length == 6 && !memcmp(keyword, "newmtl", 6) && library->num_materials < num_materials)
+        {
+            material = &materials[library->num_materials++];
+            memset(material, 0, sizeof(n3dc_obj_material_t));
+            material->dissolve = 1.0f;
+            material->index_of_refraction = 1.0f;
+            material->name = &strings[strings_length];
+            memcpy(&strings[strings_length], &chars[value_start], value_end - value_start);
+            strings_length += value_end - value_start;
+            strings[strings_length++] = '\0';
+            continue;
+        }
+        if(!material || keyword_length == 0) { continue; }
+        float* color = NULL;
+        if(keyword_length == 2 && keyword[0] == 'K')
+        {
+            if(keyword[1] == 'a') { color = material->ambient; }
+            else if(keyword[1] == 'd') { color = material->diffuse; }
+            else if(keyword[1] == 's') { color = material->specular; }
+            else if(keyword[1] == 'e') { color = material->emissive; }
+        }
+        if(color)
+        {
+            // A color with only one value is gray.
+            float values[3];
+            const unsigned int num_values = n3dc_obj_scan_material_floats(chars, line_end, value_start, values, 3);
+            for(unsigned int i = 0; num_values > 0 && i < 3; i++) { color[i] = values[i < num_values ? i : 0]; }
+            continue;
+        }
+        float value = 0.0f;
+        const int has_value = n3dc_obj_scan_material_floats(chars, line_end, value_start, &value, 1) == 1;
+        if(keyword_length == 2 && !memcmp(keyword, "Ns", 2)) { if(has_value) { material->shininess = value; } }
+        else if(keyword_length == 2 && !memcmp(keyword, "Ni", 2)) { if(has_value) { material->index_of_refraction = value; } }
+        else if(keyword_length == 1 && keyword[0] == 'd') { if(has_value) { material->dissolve = value; } }
+        else if(keyword_length == 2 && !memcmp(keyword, "Tr", 2)) { if(has_value) { material->dissolve = 1.0f - value; } }
+        else if(keyword_length == 5 && !memcmp(keyword, "illum", 5))
+        {
+            unsigned int illumination_model = 0;
+            size_t number_end = 0;
+            if(!n3dc_obj_scan_uint(chars, line_end, value_start, &number_end, &illumination_model))
+            {
+                material->illumination_model = illumination_model;
+            }
+        }
+        else
+        {
+            const char** texture = NULL;
+            if(keyword_length == 6 && !memcmp(keyword, "map_Ka", 6)) { texture = &material->ambient_texture; }
+            else if(keyword_length == 6 && !memcmp(keyword, "map_Kd", 6)) { texture = &material->diffuse_texture; }
+            else if(keyword_length == 6 && !memcmp(keyword, "map_Ks", 6)) { texture = &material->specular_texture; }
+            else if(keyword_length == 6 && !memcmp(keyword, "map_Ke", 6)) { texture = &material->emissive_texture; }
+            else if(keyword_length == 6 && !memcmp(keyword, "map_Ns", 6)) { texture = &material->shininess_texture; }
+            else if(keyword_length == 5 && !memcmp(keyword, "map_d", 5)) { texture = &material->dissolve_texture; }
+            else if((keyword_length == 8 && (!memcmp(keyword, "map_bump", 8) || !memcmp(keyword, "map_Bump", 8)))
+                || (keyword_length == 4 && !memcmp(keyword, "bump", 4)))
+            {
+                texture = &material->bump_texture;
+            }
+            if(!texture || value_end == value_start) { continue; }
+            // Options such as -bm 0.5 come before the file name, so the name is the last word.
+            size_t name_start = value_end;
+            while(name_start > value_start && !n3dc_obj_is_space(chars[name_start - 1])) { name_start--; }
+            *texture = &strings[strings_length];
+            strings_length += n3dc_obj_resolve_path(
+                path, &chars[name_start], value_end - name_start, &strings[strings_length]
+            ) + 1;
+        }
+    }
+    if(has_file) { n3dc_obj_unmap_text_file(&view); }
+    return library;
+}
+
+static void n3dc_obj_free_material_library(n3dc_obj_material_library_t* library)
+{
+    free(library->materials);
+    free(library->strings);
+    free(library);
+}
+
+// Returns the cached library at path, or NULL if it isn't cached. The material mutex must be held.
+static n3dc_obj_material_library_t* n3dc_obj_find_material_library(const char* path)
+{
+    for(n3dc_obj_material_library_t* library = n3dc_obj_material_libraries; library; library = library->next)
+    {
+        if(!strcmp(library->strings, path)) { return library; }
+    }
+    return NULL;
+}
+
+// Returns the cached library at path, parsing it into the cache first if it isn't there. The
+// file is parsed without the material mutex held. If another thread cached the same library in
+// the meantime, that one is kept and this parse is freed. Returns NULL if there's no memory for
+// the library.
+static const n3dc_obj_material_library_t* n3dc_obj_get_material_library(const char* path)
+{
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_lock(&n3dc_obj_material_mutex);
+#endif
+    n3dc_obj_material_library_t* library = n3dc_obj_find_material_library(path);
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_unlock(&n3dc_obj_material_mutex);
+#endif
+    if(library) { return library; }
+    n3dc_obj_material_library_t* parsed_library = n3dc_obj_parse_material_library(path);
+    if(!parsed_library) { return NULL; }
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_lock(&n3dc_obj_material_mutex);
+#endif
+    library = n3dc_obj_find_material_library(path);
+    if(!library)
+    {
+        parsed_library->next = n3dc_obj_material_libraries;
+        n3dc_obj_material_libraries = parsed_library;
+    }
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_unlock(&n3dc_obj_material_mutex);
+#endif
+    if(library)
+    {
+        n3dc_obj_free_material_library(parsed_library);
+        return library;
+    }
+    return parsed_library;
+}
+
+void n3dc_obj_clear_material_cache(void)
+{
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_lock(&n3dc_obj_material_mutex);
+#endif
+    n3dc_obj_material_library_t* library = n3dc_obj_material_libraries;
+    n3dc_obj_material_libraries = NULL;
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_unlock(&n3dc_obj_material_mutex);
+#endif
+    while(library)
+    {
+        n3dc_obj_material_library_t* next = library->next;
+        n3dc_obj_free_material_library(library);
+        library = next;
+    }
+}
+
+// Gives the obj the materials of the libraries in its material_library_paths, in order, and points
+// each submesh at the first material with its material name.
+static int n3dc_obj_attach_materials(n3dc_obj_t* obj, const n3dc_obj_allocator_t* allocator)
+{
+    const n3dc_obj_allocation_t* allocation = (const n3dc_obj_allocation_t*)obj;
+    const char* paths = allocation->material_library_paths;
+    const size_t paths_size = allocation->material_library_paths_size;
+    size_t num_libraries = 0;
+    for(size_t offset = 0; offset < paths_size; offset += strlen(&paths[offset]) + 1) { num_libraries++; }
+    const n3dc_obj_material_library_t** libraries = NULL;
+    if(num_libraries > 0)
+    {
+        libraries = (const n3dc_obj_material_library_t**)n3dc_obj_allocate(
+            allocator, sizeof(n3dc_obj_material_library_t*) * num_libraries
+        );
+        if(!libraries) { return -1; }
+    }
+    // Find (or parse) every library first to count their materials, then copy them out.
+    int error = 0;
+    size_t num_materials = 0;
+    size_t library_index = 0;
+    for(size_t offset = 0; offset < paths_size && !error; offset += strlen(&paths[offset]) + 1)
+    {
+        const n3dc_obj_material_library_t* library = n3dc_obj_get_material_library(&paths[offset]);
+        libraries[library_index++] = library;
+        if(library) { num_materials += library->num_materials; }
+        else { error = -1; }
+    }
+    if(!error && num_materials > 0)
+    {
+        obj->materials = (n3dc_obj_material_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_material_t) * num_materials);
+        if(!obj->materials) { error = -1; }
+    }
+    for(size_t i = 0; i < num_libraries && !error && obj->materials; i++)
+    {
+        const n3dc_obj_material_library_t* library = libraries[i];
+        memcpy(&obj->materials[obj->num_materials], library->materials, sizeof(n3dc_obj_material_t) * library->num_materials);
+        obj->num_materials += library->num_materials;
+    }
+    n3dc_obj_deallocate(allocator, (void*)libraries);
+    for(unsigned int i = 0; !error && i < obj->num_submeshes; i++)
+    {
+        n3dc_obj_submesh_t* submesh = &obj->submeshes[i];
+        submesh->material_index = N3DC_OBJ_MISSING_INDEX;
+        for(unsigned int j = 0; submesh->material_name && j < obj->num_materials; j++)
+        {
+            if(!strcmp(obj->materials[j].name, submesh->material_name))
+            {
+                submesh->material_index = j;
+                break;
+            }
+        }
+    }
+    return error;
+}
+
+// Records the resolved paths of the MTL files named by the state's mtllib events and attaches
+// their materials to the obj. Each mtllib line can name several files separated by spaces.
+static int n3dc_obj_load_materials(
+    n3dc_obj_parse_state_t* state, n3dc_obj_t* obj, const n3dc_obj_allocator_t* allocator
+){
+    n3dc_obj_allocation_t* allocation = (n3dc_obj_allocation_t*)obj;
+    allocation->has_materials = 1;
+    const size_t base_path_length = state->path ? strlen(state->path) : 0;
+    size_t paths_size = 0;
+    for(int pass = 0; pass < 2; pass++)
+    {
+        char* paths = NULL;
+        if(pass == 1)
+        {
+            if(paths_size == 0) { break; }
+            paths = (char*)n3dc_obj_allocate(allocator, paths_size);
+            if(!paths) { return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+            allocation->material_library_paths = paths;
+            paths_size = 0;
+        }
+        for(size_t i = 0; i < state->num_events; i++)
+        {
+            if(state->events[i].type != N3DC_OBJ_LINE_MATERIAL_LIBRARY) { continue; }
+            const char* names = &state->names[state->events[i].name_offset];
+            size_t name_start = 0;
+            while(names[name_start] != '\0')
+            {
+                size_t name_end = name_start;
+                while(names[name_end] != '\0' && !n3dc_obj_is_space(names[name_end])) { name_end++; }
+                const size_t name_length = name_end - name_start;
+                if(pass == 0) { paths_size += base_path_length + name_length + 1; }
+                else
+                {
+                    paths_size += n3dc_obj_resolve_path(state->path, &names[name_start], name_length, &paths[paths_size]) + 1;
+                }
+                name_start = n3dc_obj_skip_spaces(names, (size_t)-1, name_end);
+            }
+        }
+    }
+    allocation->material_library_paths_size = paths_size;
+    if(n3dc_obj_attach_materials(obj, allocator))
+    {
+        return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+    }
+    return 0;
+}
+
+// Most bins for the binned SAH split search. 16 bins come close to the quality of trying every
+// split. Nodes with fewer triangles use one bin per triangle, which keeps the search from costing
+// more than binning the triangles near the leaves.
+#define N3DC_OBJ_BVH_NUM_BINS 16
+// Nodes with more triangles than this are always split, so that every leaf's num_triangles fits
+// in 16 bits and rays never test long lists of triangles.
+#define N3DC_OBJ_BVH_MAX_LEAF_TRIANGLES 8
+
+// An axis-aligned box. Empty boxes have min above max.
+typedef struct
+{
+    float min[3];
+    float max[3];
+} n3dc_obj_bvh_box_t;
+
+static void n3dc_obj_bvh_reset_box(n3dc_obj_bvh_box_t* box)
+{
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        box->min[i] = 3.402823466e+38f;
+        box->max[i] = -3.402823466e+38f;
+    }
+}
+
+// Selects rather than branches so that the compiler can use min and max instructions.
+static void n3dc_obj_bvh_grow_box(n3dc_obj_bvh_box_t* box, const float* min, const float* max)
+{
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        box->min[i] = min[i] < box->min[i] ? min[i] : box->min[i];
+        box->max[i] = max[i] > box->max[i] ? max[i] : box->max[i];
+    }
+}
+
+// Half the surface area of a box, which is all the SAH needs since it only compares areas.
+static float n3dc_obj_bvh_half_area(const n3dc_obj_bvh_box_t* box)
+{
+    const float dx = box->max[0] - box->min[0];
+    const float dy = box->max[1] - box->min[1];
+    const float dz = box->max[2] - box->min[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+// Centers are the sums of a triangle box's min and max, which bin the same as the midpoints
+// without the multiply.
+static void n3dc_obj_bvh_get_center(const n3dc_obj_bvh_box_t* box, float* center)
+{
+    center[0] = box->min[0] + box->max[0];
+    center[1] = box->min[1] + box->max[1];
+    center[2] = box->min[2] + box->max[2];
+}
+
+// A node of the BVH while it's being built. Leaves and nodes that haven't been split yet cover
+// count triangles starting at first, and split nodes have a count of 0 and their children at
+// first_child and first_child + 1.
+typedef struct
+{
+    n3dc_obj_bvh_box_t bounds;
+    n3dc_obj_bvh_box_t center_bounds;
+    unsigned int first;
+    unsigned int count;
+    unsigned int first_child;
+    unsigned int split_axis;
+} n3dc_obj_bvh_build_node_t;
+
+typedef struct
+{
+    n3dc_obj_bvh_box_t bounds;
+    unsigned int count;
+} n3dc_obj_bvh_bin_t;
+
+// How the triangles of a node are binned: along the axis that their centers spread out the
+// most on, in num_bins bins between center_min and the largest center.
+typedef struct
+{
+    unsigned int axis;
+    unsigned int num_bins;
+    float center_min;
+    float scale;
+} n3dc_obj_bvh_binning_t;
+
+// The arrays shared by every thread of a BVH build. Threads only touch the triangles and nodes
+// of their own subtrees. triangle_boxes[i] is the box of triangles[i], and the boxes are
+// partitioned along with the triangles so that every node's boxes are read in order.
+typedef struct
+{
+    n3dc_obj_bvh_box_t* triangle_boxes;
+    unsigned int* triangles;
+    n3dc_obj_bvh_build_node_t* nodes;
+} n3dc_obj_bvh_builder_t;
+
+// Gets the binning of a node. num_bins is 0 if the node's centers are all the same (or aren't
+// finite), in which case the node can't be split by binning.
+static n3dc_obj_bvh_binning_t n3dc_obj_bvh_get_binning(const n3dc_obj_bvh_build_node_t* node)
+{
+    n3dc_obj_bvh_binning_t binning;
+    memset(&binning, 0, sizeof(n3dc_obj_bvh_binning_t));
+    float largest_extent = 0.0f;
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        const float extent = node->center_bounds.max[i] - node->center_bounds.min[i];
+        if(extent > largest_extent && extent < 3.402823466e+38f)
+        {
+            largest_extent = extent;
+            binning.axis = i;
+        }
+    }
+    if(largest_extent > 0.0f)
+    {
+        binning.num_bins = node->count < N3DC_OBJ_BVH_NUM_BINS ? node->count : N3DC_OBJ_BVH_NUM_BINS;
+        binning.center_min = node->center_bounds.min[binning.axis];
+        binning.scale = (float)binning.num_bins * 0.99999f / largest_extent;
+    }
+    return binning;
+}
+
+static unsigned int n3dc_obj_bvh_get_bin(const n3dc_obj_bvh_binning_t* binning, const float center)
+{
+    const float bin = (center - binning->center_min) * binning->scale;
+    // NaN and infinite coordinates land in the first or last bin.
+    if(!(bin > 0.0f)) { return 0; }
+    return bin < (float)(binning->num_bins - 1) ? (unsigned int)bin : binning->num_bins - 1;
+}
+
+// Adds the triangles first to end of builder->triangles to the bins.
+static void n3dc_obj_bvh_bin_triangles(
+    const n3dc_obj_bvh_builder_t* builder, const n3dc_obj_bvh_binning_t* binning,
+    const unsigned int first, const unsigned int end, n3dc_obj_bvh_bin_t* bins
+){
+    for(unsigned int i = 0; i < binning->num_bins; i++)
+    {
+        n3dc_obj_bvh_reset_box(&bins[i].bounds);
+        bins[i].count = 0;
+    }
+    if(binning->num_bins == 0) { return; }
+    for(unsigned int i = first; i < end; i++)
+    {
+        const n3dc_obj_bvh_box_t* box = &builder->triangle_boxes[i];
+        const float center = box->min[binning->axis] + box->max[binning->axis];
+        n3dc_obj_bvh_bin_t* bin = &bins[n3dc_obj_bvh_get_bin(binning, center)];
+        n3dc_obj_bvh_grow_box(&bin->bounds, box->min, box->max);
+        bin->count++;
+    }
+}
+
+// Finds the split between bins with the lowest SAH cost, where the bins before split go to the
+// first child. Returns -1 if no split leaves triangles on both sides.
+static int n3dc_obj_bvh_find_split(
+    const n3dc_obj_bvh_bin_t* bins, const unsigned int num_bins, unsigned int* split, float* split_cost
+){
+    if(num_bins < 2) { return -1; }
+    // Sweep from the right to get the area and count of every possible second child.
+    float right_areas[N3DC_OBJ_BVH_NUM_BINS];
+    unsigned int right_counts[N3DC_OBJ_BVH_NUM_BINS];
+    n3dc_obj_bvh_box_t box;
+    n3dc_obj_bvh_reset_box(&box);
+    unsigned int count = 0;
+    for(unsigned int i = num_bins - 1; i > 0; i--)
+    {
+        n3dc_obj_bvh_grow_box(&box, bins[i].bounds.min, bins[i].bounds.max);
+        count += bins[i].count;
+        right_areas[i] = count > 0 ? n3dc_obj_bvh_half_area(&box) : 0.0f;
+        right_counts[i] = count;
+    }
+    int found = 0;
+    n3dc_obj_bvh_reset_box(&box);
+    count = 0;
+    for(unsigned int i = 1; i < num_bins; i++)
+    {
+        n3dc_obj_bvh_grow_box(&box, bins[i - 1].bounds.min, bins[i - 1].bounds.max);
+        count += bins[i - 1].count;
+        if(count == 0 || right_counts[i] == 0) { continue; }
+        const float cost = n3dc_obj_bvh_half_area(&box) * (float)count + right_areas[i] * (float)right_counts[i];
+        if(!found || cost < *split_cost)
+        {
+            found = 1;
+            *split = i;
+            *split_cost = cost;
+        }
+    }
+    return found ? 0 : -1;
+}
+
+// Gets the bounds and center bounds of the triangles first to end of builder->triangles.
+static void n3dc_obj_bvh_get_bounds(
+    const n3dc_obj_bvh_builder_t* builder, const unsigned int first, const unsigned int end,
+    n3dc_obj_bvh_box_t* bounds, n3dc_obj_bvh_box_t* center_bounds
+){
+    n3dc_obj_bvh_reset_box(bounds);
+    n3dc_obj_bvh_reset_box(center_bounds);
+    for(unsigned int i = first; i < end; i++)
+    {
+        const n3dc_obj_bvh_box_t* box = &builder->triangle_boxes[i];
+        float center[3];
+        n3dc_obj_bvh_get_center(box, center);
+        n3dc_obj_bvh_grow_box(bounds, box->min, box->max);
+        n3dc_obj_bvh_grow_box(center_bounds, center, center);
+    }
+}
+
+// Splits the node at the lowest cost binned SAH split, given the node's bins, or leaves it as a
+// leaf if testing its triangles is cheaper than traversing two children (with a traversal
+// costing as much as a triangle test). Nodes whose triangles can't be told apart by their centers
+// are split in half if they're too big for a leaf. The children are allocated at *num_nodes.
+// Returns 1 if the node was split.
+static int n3dc_obj_bvh_split_node(
+    const n3dc_obj_bvh_builder_t* builder, const unsigned int node_index,
+    const n3dc_obj_bvh_binning_t* binning, const n3dc_obj_bvh_bin_t* bins, unsigned int* num_nodes
+){
+    n3dc_obj_bvh_build_node_t* node = &builder->nodes[node_index];
+    if(node->count <= 1) { return 0; }
+    unsigned int split = 0;
+    float split_cost = 0.0f;
+    const int found = !n3dc_obj_bvh_find_split(bins, binning->num_bins, &split, &split_cost);
+    if(node->count <= N3DC_OBJ_BVH_MAX_LEAF_TRIANGLES
+        && (!found || split_cost >= ((float)node->count - 1.0f) * n3dc_obj_bvh_half_area(&node->bounds)))
+    {
+        return 0;
+    }
+
+    // The children's bounds come from the bins, and their center bounds are found while the
+    // triangles are partitioned.
+    const unsigned int first = node->first;
+    const unsigned int end = node->first + node->count;
+    unsigned int middle = first;
+    n3dc_obj_bvh_build_node_t* children = &builder->nodes[*num_nodes];
+    if(found)
+    {
+        n3dc_obj_bvh_reset_box(&children[0].center_bounds);
+        n3dc_obj_bvh_reset_box(&children[1].center_bounds);
+        unsigned int right = end;
+        while(middle < right)
+        {
+            const n3dc_obj_bvh_box_t box = builder->triangle_boxes[middle];
+            float center[3];
+            n3dc_obj_bvh_get_center(&box, center);
+            if(n3dc_obj_bvh_get_bin(binning, center[binning->axis]) < split)
+            {
+                n3dc_obj_bvh_grow_box(&children[0].center_bounds, center, center);
+                middle++;
+                continue;
+            }
+            n3dc_obj_bvh_grow_box(&children[1].center_bounds, center, center);
+            right--;
+            const unsigned int triangle = builder->triangles[middle];
+            builder->triangles[middle] = builder->triangles[right];
+            builder->triangles[right] = triangle;
+            builder->triangle_boxes[middle] = builder->triangle_boxes[right];
+            builder->triangle_boxes[right] = box;
+        }
+    }
+    if(found && middle > first && middle < end)
+    {
+        n3dc_obj_bvh_reset_box(&children[0].bounds);
+        n3dc_obj_bvh_reset_box(&children[1].bounds);
+        for(unsigned int i = 0; i < binning->num_bins; i++)
+        {
+            n3dc_obj_bvh_grow_box(&children[i < split ? 0 : 1].bounds, bins[i].bounds.min, bins[i].bounds.max);
+        }
+    }
+    else
+    {
+        middle = first + node->count / 2;
+        n3dc_obj_bvh_get_bounds(builder, first, middle, &children[0].bounds, &children[0].center_bounds);
+        n3dc_obj_bvh_get_bounds(builder, middle, end, &children[1].bounds, &children[1].center_bounds);
+    }
+    children[0].first = first;
+    children[0].count = middle - first;
+    children[1].first = middle;
+    children[1].count = end - middle;
+    node->count = 0;
+    node->first_child = *num_nodes;
+    node->split_axis = binning->axis;
+    *num_nodes += 2;
+    return 1;
+}
+
+// Builds the subtrees under the nodes in roots on the calling thread, with their nodes allocated
+// from *num_nodes onward. stack needs room for as many entries as the subtrees have triangles.
+static void n3dc_obj_bvh_build_subtrees(
+    const n3dc_obj_bvh_builder_t* builder, const unsigned int* roots, const unsigned int num_roots,
+    unsigned int* stack, unsigned int* num_nodes
+){
+    n3dc_obj_bvh_bin_t bins[N3DC_OBJ_BVH_NUM_BINS];
+    for(unsigned int i = 0; i < num_roots; i++)
+    {
+        unsigned int stack_size = 0;
+        stack[stack_size++] = roots[i];
+        while(stack_size > 0)
+        {
+            const unsigned int node_index = stack[--stack_size];
+            const n3dc_obj_bvh_build_node_t* node = &builder->nodes[node_index];
+            if(node->count <= 1) { continue; }
+            const n3dc_obj_bvh_binning_t binning = n3dc_obj_bvh_get_binning(node);
+            n3dc_obj_bvh_bin_triangles(builder, &binning, node->first, node->first + node->count, bins);
+            if(n3dc_obj_bvh_split_node(builder, node_index, &binning, bins, num_nodes))
+            {
+                // Every entry on the stack covers different triangles, so it never outgrows them.
+                stack[stack_size++] = builder->nodes[node_index].first_child + 1;
+                stack[stack_size++] = builder->nodes[node_index].first_child;
+            }
+        }
+    }
+}
+
+// The output triangles that one thread finds the boxes of, along with their combined bounds.
+typedef struct
+{
+    const n3dc_obj_parse_state_t* state;
+    const unsigned int* corners;
+    const n3dc_obj_t* obj;
+    n3dc_obj_bvh_box_t* triangle_boxes;
+    unsigned int* triangles;
+    unsigned int first;
+    unsigned int end;
+    n3dc_obj_bvh_box_t bounds;
+    n3dc_obj_bvh_box_t center_bounds;
+} n3dc_obj_bvh_box_task_t;
+
+// Finds the box of each output triangle in the task's range. Positions are read from the obj's
+// vertices if it has them, and otherwise from the parsed vertices of each output vertex's corner,
+// which are full precision even when the interleaved vertices are quantized.
+static void n3dc_obj_bvh_box_task(void* task)
+{
+    n3dc_obj_bvh_box_task_t* t = (n3dc_obj_bvh_box_task_t*)task;
+    const n3dc_obj_t* obj = t->obj;
+    n3dc_obj_bvh_reset_box(&t->bounds);
+    n3dc_obj_bvh_reset_box(&t->center_bounds);
+    for(unsigned int i = t->first; i < t->end; i++)
+    {
+        n3dc_obj_bvh_box_t* box = &t->triangle_boxes[i];
+        n3dc_obj_bvh_reset_box(box);
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            const size_t vertex = obj->indices ? obj->indices[(size_t)i * 3 + j] : (size_t)i * 3 + j;
+            const float* position = obj->vertices ? &obj->vertices[vertex * 3]
+                : &t->state->vertices[(size_t)t->state->vertex_indices[t->corners ? t->corners[vertex] : vertex] * 3];
+            n3dc_obj_bvh_grow_box(box, position, position);
+        }
+        float center[3];
+        n3dc_obj_bvh_get_center(box, center);
+        n3dc_obj_bvh_grow_box(&t->bounds, box->min, box->max);
+        n3dc_obj_bvh_grow_box(&t->center_bounds, center, center);
+        t->triangles[i] = i;
+    }
+}
+
+// The triangles of one node near the top of the BVH that one thread bins.
+typedef struct
+{
+    const n3dc_obj_bvh_builder_t* builder;
+    const n3dc_obj_bvh_binning_t* binning;
+    unsigned int first;
+    unsigned int end;
+    n3dc_obj_bvh_bin_t bins[N3DC_OBJ_BVH_NUM_BINS];
+} n3dc_obj_bvh_bin_task_t;
+
+static void n3dc_obj_bvh_bin_task(void* task)
+{
+    n3dc_obj_bvh_bin_task_t* t = (n3dc_obj_bvh_bin_task_t*)task;
+    n3dc_obj_bvh_bin_triangles(t->builder, t->binning, t->first, t->end, t->bins);
+}
+
+// A run of subtrees that one thread builds into its own range of the nodes.
+typedef struct
+{
+    const n3dc_obj_bvh_builder_t* builder;
+    const unsigned int* roots;
+    unsigned int num_roots;
+    unsigned int* stack;
+    unsigned int first_node;
+    unsigned int num_nodes;
+} n3dc_obj_bvh_subtree_task_t;
+
+static void n3dc_obj_bvh_subtree_task(void* task)
+{
+    n3dc_obj_bvh_subtree_task_t* t = (n3dc_obj_bvh_subtree_task_t*)task;
+    t->num_nodes = t->first_node;
+    n3dc_obj_bvh_build_subtrees(t->builder, t->roots, t->num_roots, t->stack, &t->num_nodes);
+    t->num_nodes -= t->first_node;
+}
+
+// Builds a BVH over the obj's triangles with binned SAH splits (Wald, "On fast Construction of
+// SAH-based Bounding Volume Hierarchies"), reading the positions while the output is still in
+// cache. Each node is binned along the axis its triangles' centers spread out the most on. The
+// nodes near the root are split on the calling thread with their triangles binned on up to
+// num_threads threads, until every unsplit node has at most a quarter of a thread's share of the
+// triangles. Those subtrees are then shared out in order between the threads, each of which
+// builds its subtrees into its own range of nodes, since a subtree with n triangles never needs
+// more than 2n - 2 nodes below its root. Finally the nodes are flattened depth first so that
+// each node's first child directly follows it.
+static int n3dc_obj_build_bvh(
+    n3dc_obj_parse_state_t* state, n3dc_obj_t* obj, const unsigned int* corners,
+    unsigned int num_threads, const n3dc_obj_allocator_t* allocator
+){
+    ((n3dc_obj_allocation_t*)obj)->has_bvh = 1;
+    const unsigned int num_triangles = (obj->indices ? obj->num_indices : obj->num_vertices) / 3;
+    if(num_triangles == 0) { return 0; }
+    num_threads = n3dc_obj_clamp_threads(num_threads, num_triangles, N3DC_OBJ_MIN_TASK_SIZE);
+
+    n3dc_obj_scratch_t* scratch = state->scratch;
+    const size_t max_nodes = (size_t)num_triangles * 2 - 1;
+    n3dc_obj_bvh_builder_t builder;
+    builder.triangle_boxes = (n3dc_obj_bvh_box_t*)n3dc_obj_scratch_allocate(scratch, sizeof(n3dc_obj_bvh_box_t) * num_triangles);
+    builder.nodes = (n3dc_obj_bvh_build_node_t*)n3dc_obj_scratch_allocate(scratch, sizeof(n3dc_obj_bvh_build_node_t) * max_nodes);
+    // The triangles are partitioned in place, so they end up in leaf order.
+    builder.triangles = (unsigned int*)n3dc_obj_allocate(allocator, sizeof(unsigned int) * num_triangles);
+    obj->bvh_triangles = builder.triangles;
+    // The stack holds pairs while the nodes are flattened.
+    unsigned int* stack = (unsigned int*)n3dc_obj_scratch_allocate(scratch, sizeof(unsigned int) * 2 * (size_t)num_triangles);
+    unsigned int* roots = (unsigned int*)n3dc_obj_scratch_allocate(scratch, sizeof(unsigned int) * num_triangles);
+    size_t task_size = sizeof(n3dc_obj_bvh_box_task_t);
+    if(sizeof(n3dc_obj_bvh_bin_task_t) > task_size) { task_size = sizeof(n3dc_obj_bvh_bin_task_t); }
+    if(sizeof(n3dc_obj_bvh_subtree_task_t) > task_size) { task_size = sizeof(n3dc_obj_bvh_subtree_task_t); }
+    void* tasks = n3dc_obj_scratch_allocate(scratch, task_size * num_threads);
+    void* arrays[5] = {builder.triangle_boxes, builder.nodes, stack, roots, tasks};
+    int error = builder.triangles ? 0 : -1;
+    for(unsigned int i = 0; i < 5; i++) { if(!arrays[i]) { error = -1; } }
+
+    unsigned int num_nodes = 0;
+    if(!error)
+    {
+        n3dc_obj_bvh_box_task_t* box_tasks = (n3dc_obj_bvh_box_task_t*)tasks;
+        for(unsigned int i = 0; i < num_threads; i++)
+        {
+            box_tasks[i].state = state;
+            box_tasks[i].corners = corners;
+            box_tasks[i].obj = obj;
+            box_tasks[i].triangle_boxes = builder.triangle_boxes;
+            box_tasks[i].triangles = builder.triangles;
+            box_tasks[i].first = (unsigned int)((unsigned long long)num_triangles * i / num_threads);
+            box_tasks[i].end = (unsigned int)((unsigned long long)num_triangles * (i + 1) / num_threads);
+        }
+        n3dc_obj_run_tasks(scratch, box_tasks, sizeof(n3dc_obj_bvh_box_task_t), num_threads, n3dc_obj_bvh_box_task);
+        n3dc_obj_bvh_build_node_t* root = &builder.nodes[num_nodes++];
+        n3dc_obj_bvh_reset_box(&root->bounds);
+        n3dc_obj_bvh_reset_box(&root->center_bounds);
+        for(unsigned int i = 0; i < num_threads; i++)
+        {
+            n3dc_obj_bvh_grow_box(&root->bounds, box_tasks[i].bounds.min, box_tasks[i].bounds.max);
+            n3dc_obj_bvh_grow_box(&root->center_bounds, box_tasks[i].center_bounds.min, box_tasks[i].center_bounds.max);
+        }
+        root->first = 0;
+        root->count = num_triangles;
+    }
+
+    // Split the nodes near the root, deferring the rest to the subtree threads.
+    unsigned int num_roots = 0;
+    if(!error)
+    {
+        const unsigned int max_subtree_triangles = num_threads > 1 ? num_triangles / (num_threads * 4) : num_triangles;
+        n3dc_obj_bvh_bin_task_t* bin_tasks = (n3dc_obj_bvh_bin_task_t*)tasks;
+        unsigned int stack_size = 0;
+        stack[stack_size++] = 0;
+        while(stack_size > 0)
+        {
+            const unsigned int node_index = stack[--stack_size];
+            const n3dc_obj_bvh_build_node_t* node = &builder.nodes[node_index];
+            if(node->count <= max_subtree_triangles)
+            {
+                roots[num_roots++] = node_index;
+                continue;
+            }
+            const n3dc_obj_bvh_binning_t binning = n3dc_obj_bvh_get_binning(node);
+            const unsigned int num_bin_tasks = n3dc_obj_clamp_threads(num_threads, node->count, N3DC_OBJ_MIN_TASK_SIZE);
+            for(unsigned int i = 0; i < num_bin_tasks; i++)
+            {
+                bin_tasks[i].builder = &builder;
+                bin_tasks[i].binning = &binning;
+                bin_tasks[i].first = node->first + (unsigned int)((unsigned long long)node->count * i / num_bin_tasks);
+                bin_tasks[i].end = node->first + (unsigned int)((unsigned long long)node->count * (i + 1) / num_bin_tasks);
+            }
+            n3dc_obj_run_tasks(scratch, bin_tasks, sizeof(n3dc_obj_bvh_bin_task_t), num_bin_tasks, n3dc_obj_bvh_bin_task);
+            for(unsigned int i = 1; i < num_bin_tasks; i++)
+            {
+                for(unsigned int j = 0; j < binning.num_bins; j++)
+                {
+                    n3dc_obj_bvh_grow_box(&bin_tasks[0].bins[j].bounds, bin_tasks[i].bins[j].bounds.min, bin_tasks[i].bins[j].bounds.max);
+                    bin_tasks[0].bins[j].count += bin_tasks[i].bins[j].count;
+                }
+            }
+            if(n3dc_obj_bvh_split_node(&builder, node_index, &binning, bin_tasks[0].bins, &num_nodes))
+            {
+                stack[stack_size++] = builder.nodes[node_index].first_child + 1;
+                stack[stack_size++] = builder.nodes[node_index].first_child;
+            }
+        }
+    }
+
+    // Build the deferred subtrees, giving each thread a run of them with about the same number
+    // of triangles. Their nodes and stacks go after those of the subtrees before them.
+    if(!error)
+    {
+        n3dc_obj_bvh_subtree_task_t* subtree_tasks = (n3dc_obj_bvh_subtree_task_t*)tasks;
+        unsigned int root_index = 0;
+        unsigned int first_node = num_nodes;
+        unsigned int first_triangle = 0;
+        for(unsigned int i = 0; i < num_threads; i++)
+        {
+            const unsigned int end_triangle = (unsigned int)((unsigned long long)num_triangles * (i + 1) / num_threads);
+            subtree_tasks[i].builder = &builder;
+            subtree_tasks[i].roots = &roots[root_index];
+            subtree_tasks[i].num_roots = 0;
+            subtree_tasks[i].stack = &stack[first_triangle];
+            subtree_tasks[i].first_node = first_node;
+            while(root_index < num_roots && (first_triangle < end_triangle || i == num_threads - 1))
+            {
+                const unsigned int count = builder.nodes[roots[root_index++]].count;
+                subtree_tasks[i].num_roots++;
+                first_node += count * 2 - 2;
+                first_triangle += count;
+            }
+        }
+        n3dc_obj_run_tasks(scratch, subtree_tasks, sizeof(n3dc_obj_bvh_subtree_task_t), num_threads, n3dc_obj_bvh_subtree_task);
+        for(unsigned int i = 0; i < num_threads; i++) { num_nodes += subtree_tasks[i].num_nodes; }
+        obj->bvh_nodes = (n3dc_obj_bvh_node_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_bvh_node_t) * num_nodes);
+        if(!obj->bvh_nodes) { error = -1; }
+        else { obj->num_bvh_nodes = num_nodes; }
+    }
+
+    // Flatten the nodes depth first. Each stack entry is a node and the flattened node whose
+    // second child it is, if it is one.
+    if(!error)
+    {
+        const unsigned int no_parent = (unsigned int)-1;
+        unsigned int num_flat_nodes = 0;
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+        stack[stack_size++] = no_parent;
+        while(stack_size > 0)
+        {
+            const unsigned int parent = stack[--stack_size];
+            const n3dc_obj_bvh_build_node_t* node = &builder.nodes[stack[--stack_size]];
+            if(parent != no_parent) { obj->bvh_nodes[parent].offset = num_flat_nodes; }
+            n3dc_obj_bvh_node_t* flat_node = &obj->bvh_nodes[num_flat_nodes];
+            memcpy(flat_node->bounds_min, node->bounds.min, sizeof(flat_node->bounds_min));
+            memcpy(flat_node->bounds_max, node->bounds.max, sizeof(flat_node->bounds_max));
+            flat_node->offset = node->first;
+            flat_node->num_triangles = (unsigned short)node->count;
+            flat_node->split_axis = 0;
+            if(node->count == 0)
+            {
+                flat_node->split_axis = (unsigned short)node->split_axis;
+                stack[stack_size++] = node->first_child + 1;
+                stack[stack_size++] = num_flat_nodes;
+                stack[stack_size++] = node->first_child;
+                stack[stack_size++] = no_parent;
+            }
+            num_flat_nodes++;
+        }
+    }
+    for(unsigned int i = 0; i < 5; i++) { if(arrays[i]) { n3dc_obj_scratch_deallocate(scratch, arrays[i]); } }
+    if(error) { return n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+    return 0;
+}
+
+// Builds the n3dc_obj_t for a parsed OBJ file in the requested output mode, generating any
+// requested normals first. The parse state is left for the caller to free.
+static n3dc_obj_t* n3dc_obj_build_output(
+    n3dc_obj_parse_state_t* state, const n3dc_obj_load_options_t* options
+){
+    const n3dc_obj_output_mode_t output_mode = options ? options->output_mode : N3DC_OBJ_OUTPUT_DEINDEXED;
+    const n3dc_obj_normal_mode_t normal_mode = options ? options->normal_mode : N3DC_OBJ_NORMALS_FROM_FILE;
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+    if(n3dc_obj_generate_normals(state, normal_mode, options ? options->num_threads : 0)) { return NULL; }
+    n3dc_obj_t* obj = n3dc_obj_allocate_output(allocator);
+    if(!obj)
+    {
+        n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    ((n3dc_obj_allocation_t*)obj)->normal_mode = normal_mode;
+    ((n3dc_obj_allocation_t*)obj)->skip_attributes = state->skip_attributes;
+    if(options && options->record_submeshes && n3dc_obj_build_submeshes(state, obj, allocator))
+    {
+        n3dc_obj_free(obj);
+        return NULL;
+    }
+    if(options && options->load_materials && n3dc_obj_load_materials(state, obj, allocator))
+    {
+        n3dc_obj_free(obj);
+        return NULL;
+    }
+    const unsigned int* corners = NULL;
+    unsigned int* unique_corners = NULL;
+    unsigned int num_output_vertices = state->parsed_indices;
+    if(output_mode == N3DC_OBJ_OUTPUT_INDEXED)
+    {
+        const size_t indices_size = sizeof(unsigned int) * state->parsed_indices;
+        obj->num_indices = state->parsed_indices;
+        obj->indices = (unsigned int*)n3dc_obj_allocate(allocator, indices_size > 0 ? indices_size : 1);
+        unique_corners = (unsigned int*)n3dc_obj_scratch_allocate(state->scratch, indices_size);
+        if(!obj->indices || !unique_corners)
+        {
+            n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+            if(unique_corners) { n3dc_obj_scratch_deallocate(state->scratch, unique_corners); }
+            n3dc_obj_free(obj);
+            return NULL;
+        }
+        num_output_vertices = n3dc_obj_weld_corners(state, obj->indices, unique_corners);
+        int error = 0;
+        if(num_output_vertices == (unsigned int)-1)
+        {
+            error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        }
+        if(!error && options->optimize_vertex_cache)
+        {
+            const unsigned int vertex_cache_size = options->vertex_cache_size ? options->vertex_cache_size : 16;
+            ((n3dc_obj_allocation_t*)obj)->vertex_cache_size = vertex_cache_size;
+            error = n3dc_obj_optimize_vertex_cache(
+                state->scratch, obj->indices, obj->num_indices, 
+                unique_corners, num_output_vertices, vertex_cache_size, 
+                obj->submeshes, obj->num_submeshes
+            );
+            if(error) { n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+        }
+        if(!error && options->num_lods > 0)
+        {
+            error = n3dc_obj_generate_lods(state, obj, unique_corners, num_output_vertices, options);
+        }
+        if(error)
+        {
+            n3dc_obj_scratch_deallocate(state->scratch, unique_corners);
+            n3dc_obj_free(obj);
+            return NULL;
+        }
+        corners = unique_corners;
+    }
+
+    int error = 0;
+    obj->num_vertices = num_output_vertices;
+    const n3dc_obj_vertex_layout_t* layout = options ? options->vertex_layout : NULL;
+    if(layout)
+    {
+        const size_t interleaved_size = (size_t)num_output_vertices * layout->stride;
+        obj->vertex_stride = layout->stride;
+        ((n3dc_obj_allocation_t*)obj)->layout = *layout;
+        ((n3dc_obj_allocation_t*)obj)->has_layout = 1;
+        if(options->interleaved_buffer)
+        {
+            if(interleaved_size > options->interleaved_buffer_size)
+            {
+                error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_BUFFER_TOO_SMALL);
+            }
+            else { obj->interleaved_vertices = options->interleaved_buffer; }
+        }
+        else
+        {
+            obj->interleaved_vertices = n3dc_obj_allocate(allocator, interleaved_size > 0 ? interleaved_size : 1);
+            if(obj->interleaved_vertices)
+            {
+                ((n3dc_obj_allocation_t*)obj)->owns_interleaved_vertices = 1;
+                memset(obj->interleaved_vertices, 0, interleaved_size);
+            }
+            else { error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+        }
+        if(!error && n3dc_obj_gather_corners_interleaved(
+            state, corners, num_output_vertices, layout, (unsigned char*)obj->interleaved_vertices
+        )){
+            error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE);
+        }
+    }
+    else
+    {
+        const size_t ordered_scalars_size = sizeof(float) * (num_output_vertices > 0 ? num_output_vertices : 1);
+        obj->vertices = (float*)n3dc_obj_allocate(allocator, ordered_scalars_size * 3);
+        if(state->texture_indices)
+        {
+            obj->texture_coords = (float*)n3dc_obj_allocate(allocator, ordered_scalars_size * 2);
+            if(!obj->texture_coords) { error = -1; }
+        }
+        if(state->normal_indices)
+        {
+            obj->normals = (float*)n3dc_obj_allocate(allocator, ordered_scalars_size * 3);
+            if(!obj->normals) { error = -1; }
+        }
+        if(!obj->vertices || error) { error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+        else if(n3dc_obj_gather_corners(
+            state, corners, num_output_vertices, options ? options->num_threads : 0, 
+            obj->vertices, obj->texture_coords, obj->normals
+        )){
+            error = n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE);
+        }
+    }
+    if(!error && options && options->build_bvh)
+    {
+        error = n3dc_obj_build_bvh(state, obj, corners, options->num_threads, allocator);
+    }
+    for(unsigned int i = 0; !error && state->position_indices && i < num_output_vertices; i++)
+    {
+        state->position_indices[i] = state->vertex_indices[corners ? corners[i] : i];
+    }
+    if(unique_corners) { n3dc_obj_scratch_deallocate(state->scratch, unique_corners); }
+    if(error)
+    {
+        n3dc_obj_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+// Places an index out of range error from building the output at the index in the file that
+// caused it, which is the first index in the file that is past the end of its records. Indices are
+// only checked once every record has been parsed and corners don't remember where they came
+// from, so the face lines are scanned again for it. Without the data, the first such index is
+// looked for among the forward references instead.
+static N3DC_OBJ_COLD void n3dc_obj_locate_index_error(
+    n3dc_obj_parse_state_t* state, const char* file_chars, const size_t file_chars_length
+){
+    const unsigned int* indices[3] = {state->vertex_indices, state->texture_indices, state->normal_indices};
+    const unsigned int num_records[3] = {state->parsed_vertices, state->parsed_texture_coords, state->parsed_normals};
+    if(!file_chars)
+    {
+        for(size_t i = 0; i < state->num_forward_references; i++)
+        {
+            const n3dc_obj_forward_reference_t* reference = &state->forward_references[i];
+            if(reference->index >= num_records[reference->attribute])
+            {
+                state->error.offset = reference->offset;
+                state->error.line = reference->line;
+                return;
+            }
+        }
+        return;
+    }
+    unsigned int corner = 0;
+    unsigned int attribute = 3;
+    for(; corner < state->parsed_indices && attribute == 3; corner++)
+    {
+        for(unsigned int i = 0; i < 3 && attribute == 3; i++)
+        {
+            if(!indices[i] || indices[i][corner] == N3DC_OBJ_MISSING_INDEX) { continue; }
+            if(indices[i][corner] >= num_records[i]) { attribute = i; }
+        }
+    }
+    if(attribute == 3) { return; }
+    corner--;
+    unsigned int triangle = corner / 3;
+    size_t line_start = 0;
+    while(line_start < file_chars_length)
+    {
+        size_t line_end = file_chars_length;
+        n3dc_obj_seek_newline(file_chars, file_chars_length, line_start, &line_end);
+        if(n3dc_obj_get_line_type(file_chars, file_chars_length, line_start) == N3DC_OBJ_LINE_FACE)
+        {
+            const unsigned int num_triangles = 
+                n3dc_obj_count_face_indices(file_chars, file_chars_length, line_start + 1) / 3;
+            if(triangle < num_triangles)
+            {
+                const unsigned int group = (corner % 3 == 0) ? 0 : triangle + corner % 3;
+                state->error.offset = n3dc_obj_find_face_index(file_chars, line_start, line_end, group, attribute);
+                state->error.line = 1;
+                n3dc_obj_locate_error(&state->error, file_chars, 0, 0);
+                return;
+            }
+            triangle -= num_triangles;
+        }
+        line_start = line_end + 1;
+    }
+}
+
+// Builds the output of a parsed state unless parsing failed, fills in the options' error and
+// stats, and frees the state. file_chars is the data that was parsed, for placing out of range
+// indices found while building the output, or NULL if it wasn't kept.
+static n3dc_obj_t* n3dc_obj_finish_load(
+    n3dc_obj_parse_state_t* state, const int parse_error, const n3dc_obj_load_options_t* options,
+    const char* file_chars, const size_t file_chars_length
+){
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double start_seconds = n3dc_obj_get_seconds();
+#endif
+    n3dc_obj_t* obj = parse_error ? NULL : n3dc_obj_build_output(state, options);
+    if(!obj && !parse_error && state->error.code == N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE)
+    {
+        n3dc_obj_locate_index_error(state, file_chars, file_chars_length);
+    }
+    n3dc_obj_report_error(options, &state->error);
+    if(options && options->stats)
+    {
+        n3dc_obj_stats_t* stats = options->stats;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+        *stats = state->stats;
+        stats->reorder_seconds = parse_error ? 0.0 : n3dc_obj_get_seconds() - start_seconds;
+        stats->counts.num_vertices = state->parsed_vertices;
+        stats->counts.num_texture_coords = state->parsed_texture_coords;
+        stats->counts.num_normals = state->parsed_normals;
+        stats->counts.num_indices = state->parsed_indices;
+        stats->peak_scratch_bytes = state->scratch->peak_bytes;
+#else
+        memset(stats, 0, sizeof(n3dc_obj_stats_t));
+#endif
+    }
+    n3dc_obj_free_parse_state(state);
+    return obj;
+}
+
+// Loads the characters of the OBJ file at path, which mtllib names are resolved against. path is
+// NULL for data that didn't come from a file.
+static n3dc_obj_t* n3dc_obj_load_from_memory_at_path(
+    const char* path,
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    if(n3dc_obj_validate_options(options)) { return NULL; }
+    const unsigned int num_threads = options ? options->num_threads : 0;
+    const int count_first = options ? options->count_first : 0;
+
+    n3dc_obj_scratch_t scratch;
+    n3dc_obj_init_scratch(&scratch, options);
+    n3dc_obj_parse_state_t state;
+    memset(&state, 0, sizeof(n3dc_obj_parse_state_t));
+    state.scratch = &scratch;
+    state.max_vertices = max_vertices;
+    state.max_texture_coords = max_indices;
+    state.max_normals = max_normals;
+    state.max_indices = max_indices;
+    state.record_submeshes = options ? options->record_submeshes : 0;
+    state.load_materials = options ? options->load_materials : 0;
+    state.skip_attributes = options ? options->skip_attributes : 0;
+    state.path = path;
+    const int error = n3dc_obj_parse_file(file_chars, file_chars_length, &state, num_threads, count_first);
+    return n3dc_obj_finish_load(&state, error, options, file_chars, file_chars_length);
+}
+
+n3dc_obj_t* n3dc_obj_load(
+    const char* path, 
+    const unsigned int max_vertices, 
+    const unsigned int max_normals,
+    const unsigned int max_indices
+){
+    return n3dc_obj_load_with_options(path, max_vertices, max_normals, max_indices, NULL);
+}
+
+n3dc_obj_t* n3dc_obj_load_with_options(
+    const char* path, 
+    const unsigned int max_vertices, 
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    if(n3dc_obj_validate_options(options)) { return NULL; }
+    n3dc_obj_file_view_t file_view;
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double read_start_seconds = n3dc_obj_get_seconds();
+#endif
+    const int file_read_error = n3dc_obj_map_text_file(
+        path, allocator, &file_view, options ? options->error : NULL
+    );
+    if(file_read_error)
+    {
+        if(options && options->stats) { memset(options->stats, 0, sizeof(n3dc_obj_stats_t)); }
+        return NULL;
+    }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double read_seconds = n3dc_obj_get_seconds() - read_start_seconds;
+#endif
+    n3dc_obj_t* obj = n3dc_obj_load_from_memory_at_path(
+        path, file_view.chars, file_view.length, max_vertices, max_normals, max_indices, options
+    );
+    n3dc_obj_unmap_text_file(&file_view);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    // Mapped files are mostly read while they're parsed, so this only covers reading into a buffer.
+    if(options && options->stats) { options->stats->read_seconds = read_seconds; }
+#endif
+    return obj;
+}
+
+n3dc_obj_t* n3dc_obj_load_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices
+){
+    return n3dc_obj_load_from_memory_with_options(
+        file_chars, file_chars_length, max_vertices, max_normals, max_indices, NULL
+    );
+}
+
+n3dc_obj_t* n3dc_obj_load_from_memory_with_options(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    return n3dc_obj_load_from_memory_at_path(
+        NULL, file_chars, file_chars_length, max_vertices, max_normals, max_indices, options
+    );
+}
+
+// Work shared by the threads of n3dc_obj_load_batch.
+typedef struct
+{
+    const char* const* paths;
+    size_t num_paths;
+    unsigned int max_vertices;
+    unsigned int max_normals;
+    unsigned int max_indices;
+    n3dc_obj_load_options_t options;
+    n3dc_obj_t** objs;
+    size_t next_path;
+    // The error of the first path, in path order, that failed to load.
+    n3dc_obj_error_t error;
+    size_t error_path_index;
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_t mutex;
+    int has_mutex;
+#endif
+} n3dc_obj_batch_t;
+
+// Returns the index of the next path that hasn't been claimed by a thread, or num_paths if every
+// path has been claimed.
+static size_t n3dc_obj_claim_batch_path(n3dc_obj_batch_t* batch)
+{
+#if defined(N3DC_OBJ_THREADS)
+    if(batch->has_mutex) { n3dc_obj_mutex_lock(&batch->mutex); }
+#endif
+    const size_t path_index = batch->next_path;
+    if(batch->next_path < batch->num_paths) { batch->next_path++; }
+#if defined(N3DC_OBJ_THREADS)
+    if(batch->has_mutex) { n3dc_obj_mutex_unlock(&batch->mutex); }
+#endif
+    return path_index;
+}
+
+// Keeps error as the batch's error if path_index comes before the path of the current one.
+static N3DC_OBJ_COLD void n3dc_obj_set_batch_error(
+    n3dc_obj_batch_t* batch, const size_t path_index, const n3dc_obj_error_t* error
+){
+#if defined(N3DC_OBJ_THREADS)
+    if(batch->has_mutex) { n3dc_obj_mutex_lock(&batch->mutex); }
+#endif
+    if(path_index < batch->error_path_index)
+    {
+        batch->error = *error;
+        batch->error_path_index = path_index;
+    }
+#if defined(N3DC_OBJ_THREADS)
+    if(batch->has_mutex) { n3dc_obj_mutex_unlock(&batch->mutex); }
+#endif
+}
+
+// Maps the file at path_index and starts reading it ahead. Returns 1 if the file was mapped.
+static int n3dc_obj_open_batch_path(
+    n3dc_obj_batch_t* batch, const size_t path_index, n3dc_obj_file_view_t* view,
+    n3dc_obj_error_t* error
+){
+    memset(error, 0, sizeof(n3dc_obj_error_t));
+    if(path_index >= batch->num_paths) { return 0; }
+    if(n3dc_obj_map_text_file(batch->paths[path_index], batch->options.allocator, view, error))
+    {
+        return 0;
+    }
+    n3dc_obj_prefetch_file_view(view);
+    return 1;
+}
+
+// Loads claimed files until none are left. Each thread keeps one parse state for all of its
+// files, so the parse arrays are only reallocated when a file needs more room than any of the
+// thread's earlier files. The next file is mapped and read ahead before the current one is
+// parsed to keep the disk busy while parsing.
+static void n3dc_obj_load_batch_paths(void* batch_ptr)
+{
+    n3dc_obj_batch_t* batch = (n3dc_obj_batch_t*)batch_ptr;
+    n3dc_obj_scratch_t scratch;
+    n3dc_obj_init_scratch(&scratch, &batch->options);
+    n3dc_obj_parse_state_t state;
+    memset(&state, 0, sizeof(n3dc_obj_parse_state_t));
+    state.scratch = &scratch;
+    state.record_submeshes = batch->options.record_submeshes;
+    state.load_materials = batch->options.load_materials;
+    state.skip_attributes = batch->options.skip_attributes;
+
+    n3dc_obj_file_view_t next_view;
+    n3dc_obj_error_t next_error;
+    size_t next_index = n3dc_obj_claim_batch_path(batch);
+    int next_is_open = n3dc_obj_open_batch_path(batch, next_index, &next_view, &next_error);
+    while(next_index < batch->num_paths)
+    {
+        const size_t path_index = next_index;
+        const int is_open = next_is_open;
+        n3dc_obj_file_view_t file_view = next_view;
+        const n3dc_obj_error_t open_error = next_error;
+        next_index = n3dc_obj_claim_batch_path(batch);
+        next_is_open = n3dc_obj_open_batch_path(batch, next_index, &next_view, &next_error);
+        if(!is_open)
+        {
+            n3dc_obj_set_batch_error(batch, path_index, &open_error);
+            continue;
+        }
+
+        state.parsed_vertices = 0;
+        state.parsed_texture_coords = 0;
+        state.parsed_normals = 0;
+        state.parsed_indices = 0;
+        state.num_events = 0;
+        state.names_length = 0;
+        state.max_vertices = batch->max_vertices;
+        state.max_texture_coords = batch->max_indices;
+        state.max_normals = batch->max_normals;
+        state.max_indices = batch->max_indices;
+        // mtllib names are relative to the OBJ's directory.
+        state.path = batch->paths[path_index];
+        memset(&state.error, 0, sizeof(n3dc_obj_error_t));
+        if(!n3dc_obj_parse_file(file_view.chars, file_view.length, &state, 1, batch->options.count_first))
+        {
+            batch->objs[path_index] = n3dc_obj_build_output(&state, &batch->options);
+            if(!batch->objs[path_index] && state.error.code == N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE)
+            {
+                n3dc_obj_locate_index_error(&state, file_view.chars, file_view.length);
+            }
+        }
+        if(!batch->objs[path_index]) { n3dc_obj_set_batch_error(batch, path_index, &state.error); }
+        n3dc_obj_unmap_text_file(&file_view);
+    }
+    n3dc_obj_free_parse_state(&state);
+}
+
+int n3dc_obj_load_batch(
+    const char* const* paths,
+    const size_t num_paths,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_t** objs
+){
+    for(size_t i = 0; i < num_paths; i++) { objs[i] = NULL; }
+    if(n3dc_obj_validate_options(options)) { return -1; }
+
+    n3dc_obj_batch_t batch;
+    memset(&batch, 0, sizeof(n3dc_obj_batch_t));
+    batch.paths = paths;
+    batch.num_paths = num_paths;
+    batch.max_vertices = max_vertices;
+    batch.max_normals = max_normals;
+    batch.max_indices = max_indices;
+    if(options) { batch.options = *options; }
+    // A single caller buffer can't hold the output of several files, and a single arena or stats
+    // struct can't be shared between threads.
+    batch.options.interleaved_buffer = NULL;
+    batch.options.interleaved_buffer_size = 0;
+    batch.options.scratch_arena = NULL;
+    batch.options.scratch_arena_size = 0;
+    batch.options.stats = NULL;
+    batch.options.error = NULL;
+    batch.objs = objs;
+    batch.error_path_index = num_paths;
+
+#if defined(N3DC_OBJ_THREADS)
+    size_t num_threads = batch.options.num_threads;
+    if(num_threads > num_paths) { num_threads = num_paths; }
+    n3dc_obj_thread_t* threads = NULL;
+    size_t num_started_threads = 0;
+    if(num_threads > 1 && !n3dc_obj_mutex_init(&batch.mutex))
+    {
+        batch.has_mutex = 1;
+        threads = (n3dc_obj_thread_t*)n3dc_obj_allocate(
+            batch.options.allocator, sizeof(n3dc_obj_thread_t) * (num_threads - 1)
+        );
+        // If a thread can't be started its share of the files goes to the other threads.
+        for(size_t i = 0; threads && i < num_threads - 1; i++)
+        {
+            if(n3dc_obj_thread_create(&threads[num_started_threads], n3dc_obj_load_batch_paths, &batch))
+            {
+                break;
+            }
+            num_started_threads++;
+        }
+    }
+    n3dc_obj_load_batch_paths(&batch);
+    for(size_t i = 0; i < num_started_threads; i++) { n3dc_obj_thread_join(&threads[i]); }
+    if(threads) { n3dc_obj_deallocate(batch.options.allocator, threads); }
+    if(batch.has_mutex) { n3dc_obj_mutex_destroy(&batch.mutex); }
+#else
+    n3dc_obj_load_batch_paths(&batch);
+#endif
+
+    if(batch.error_path_index == num_paths) { return 0; }
+    if(options && options->error) { *options->error = batch.error; }
+    return -1;
+}
+
+struct n3dc_obj_async
+{
+    // Only one of path and file_chars is set. path points into the same allocation as the handle.
+    const char* path;
+    const char* file_chars;
+    size_t file_chars_length;
+    unsigned int max_vertices;
+    unsigned int max_normals;
+    unsigned int max_indices;
+    n3dc_obj_load_options_t options;
+    int has_options;
+    n3dc_obj_async_callback_t callback;
+    void* user_data;
+    n3dc_obj_t* obj;
+    int is_done;
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_thread_t thread;
+    int has_thread;
+    n3dc_obj_mutex_t mutex;
+#endif
+};
+
+static void n3dc_obj_run_async_load(void* async_ptr)
+{
+    n3dc_obj_async_t* async = (n3dc_obj_async_t*)async_ptr;
+    const n3dc_obj_load_options_t* options = async->has_options ? &async->options : NULL;
+    n3dc_obj_t* obj = NULL;
+    if(async->path)
+    {
+        n3dc_obj_file_view_t file_view;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+        const double read_start_seconds = n3dc_obj_get_seconds();
+#endif
+        if(!n3dc_obj_map_text_file(async->path, async->options.allocator, &file_view, async->options.error))
+        {
+            // Pull the whole file in now instead of waiting for the parser to fault it in.
+            n3dc_obj_prefetch_file_view(&file_view);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+            const double read_seconds = n3dc_obj_get_seconds() - read_start_seconds;
+#endif
+            obj = n3dc_obj_load_from_memory_at_path(
+                async->path, file_view.chars, file_view.length, 
+                async->max_vertices, async->max_normals, async->max_indices, options
+            );
+            n3dc_obj_unmap_text_file(&file_view);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+            if(options && options->stats) { options->stats->read_seconds = read_seconds; }
+#endif
+        }
+        else if(options && options->stats) { memset(options->stats, 0, sizeof(n3dc_obj_stats_t)); }
+    }
+    else
+    {
+        obj = n3dc_obj_load_from_memory_with_options(
+            async->file_chars, async->file_chars_length, 
+            async->max_vertices, async->max_normals, async->max_indices, options
+        );
+    }
+    if(async->callback) { async->callback(obj, async->user_data); }
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_lock(&async->mutex);
+#endif
+    async->obj = obj;
+    async->is_done = 1;
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_unlock(&async->mutex);
+#endif
+}
+
+static n3dc_obj_async_t* n3dc_obj_submit_async_load(
+    const char* path,
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_async_callback_t callback,
+    void* user_data
+){
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+    n3dc_obj_error_t* error = options ? options->error : NULL;
+    if(error) { memset(error, 0, sizeof(n3dc_obj_error_t)); }
+    const size_t path_size = path ? strlen(path) + 1 : 0;
+    n3dc_obj_async_t* async = (n3dc_obj_async_t*)n3dc_obj_allocate(
+        allocator, sizeof(n3dc_obj_async_t) + path_size
+    );
+    if(!async)
+    {
+        n3dc_obj_set_error(error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    memset(async, 0, sizeof(n3dc_obj_async_t));
+    if(path)
+    {
+        char* path_copy = (char*)(async + 1);
+        memcpy(path_copy, path, path_size);
+        async->path = path_copy;
+    }
+    async->file_chars = file_chars;
+    async->file_chars_length = file_chars_length;
+    async->max_vertices = max_vertices;
+    async->max_normals = max_normals;
+    async->max_indices = max_indices;
+    if(options)
+    {
+        async->options = *options;
+        async->has_options = 1;
+    }
+    async->callback = callback;
+    async->user_data = user_data;
+#if defined(N3DC_OBJ_THREADS)
+    if(n3dc_obj_mutex_init(&async->mutex))
+    {
+        n3dc_obj_set_error(error, N3DC_OBJ_ERROR_THREAD);
+        n3dc_obj_deallocate(allocator, async);
+        return NULL;
+    }
+    async->has_thread = !n3dc_obj_thread_create(&async->thread, n3dc_obj_run_async_load, async);
+    // If a thread can't be started the load runs on the calling thread instead.
+    if(!async->has_thread) { n3dc_obj_run_async_load(async); }
+#else
+    n3dc_obj_run_async_load(async);
+#endif
+    return async;
+}
+
+n3dc_obj_async_t* n3dc_obj_load_async(
+    const char* path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_async_callback_t callback,
+    void* user_data
+){
+    return n3dc_obj_submit_async_load(
+        path, NULL, 0, max_vertices, max_normals, max_indices, options, callback, user_data
+    );
+}
+
+n3dc_obj_async_t* n3dc_obj_load_from_memory_async(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options,
+    n3dc_obj_async_callback_t callback,
+    void* user_data
+){
+    return n3dc_obj_submit_async_load(
+        NULL, file_chars, file_chars_length, 
+        max_vertices, max_normals, max_indices, options, callback, user_data
+    );
+}
+
+int n3dc_obj_async_is_done(n3dc_obj_async_t* async)
+{
+#if defined(N3DC_OBJ_THREADS)
+    n3dc_obj_mutex_lock(&async->mutex);
+    const int is_done = async->is_done;
+    n3dc_obj_mutex_unlock(&async->mutex);
+    return is_done;
+#else
+    return async->is_done;
+#endif
+}
+
+n3dc_obj_t* n3dc_obj_async_wait(n3dc_obj_async_t* async)
+{
+#if defined(N3DC_OBJ_THREADS)
+    if(async->has_thread) { n3dc_obj_thread_join(&async->thread); }
+    n3dc_obj_mutex_destroy(&async->mutex);
+#endif
+    n3dc_obj_t* obj = async->obj;
+    n3dc_obj_deallocate(async->options.allocator, async);
+    return obj;
+}
+
+#define N3DC_OBJ_CACHE_VERSION 3
+
+typedef enum
+{
+    N3DC_OBJ_CACHE_SECTION_VERTICES = 0,
+    N3DC_OBJ_CACHE_SECTION_NORMALS,
+    N3DC_OBJ_CACHE_SECTION_TEXTURE_COORDS,
+    N3DC_OBJ_CACHE_SECTION_INDICES,
+    N3DC_OBJ_CACHE_SECTION_INTERLEAVED_VERTICES,
+    N3DC_OBJ_CACHE_SECTION_SUBMESHES,
+    N3DC_OBJ_CACHE_SECTION_SUBMESH_NAMES,
+    N3DC_OBJ_CACHE_SECTION_LODS,
+    N3DC_OBJ_CACHE_SECTION_LOD_INDICES,
+    N3DC_OBJ_CACHE_SECTION_BVH_NODES,
+    N3DC_OBJ_CACHE_SECTION_BVH_TRIANGLES,
+    N3DC_OBJ_CACHE_SECTION_MATERIAL_LIBRARIES,
+    N3DC_OBJ_CACHE_NUM_SECTION_TYPES
+} n3dc_obj_cache_section_type_t;
+
+// Set in the cache header's flags when the obj was loaded with record_submeshes.
+#define N3DC_OBJ_CACHE_FLAG_SUBMESHES 1u
+// Set in the cache header's flags when the obj was loaded with texture coords or normals skipped.
+#define N3DC_OBJ_CACHE_FLAG_NO_TEXTURE_COORDS 2u
+#define N3DC_OBJ_CACHE_FLAG_NO_NORMALS 4u
+// Set in the cache header's flags when the obj was loaded with build_bvh.
+#define N3DC_OBJ_CACHE_FLAG_BVH 8u
+// Set in the cache header's flags when the obj was loaded with load_materials. Only the MTL files'
+// paths are stored, their materials come from the material cache when the cache file is loaded.
+#define N3DC_OBJ_CACHE_FLAG_MATERIALS 16u
+
+// Cache files are a header, a table of num_sections sections, then the section data. Every
+// section starts on a 64 byte boundary so that the arrays can be used directly from the mapping.
+typedef struct
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int num_sections;
+    unsigned long long source_size;
+    long long source_mtime;
+    unsigned int num_vertices;
+    unsigned int num_indices;
+    unsigned int vertex_stride;
+    int position_offset;
+    int normal_offset;
+    int texture_coord_offset;
+    unsigned int normal_mode;
+    unsigned int vertex_cache_size;
+    unsigned int position_format;
+    unsigned int normal_format;
+    unsigned int texture_coord_format;
+    unsigned int flags;
+} n3dc_obj_cache_header_t;
+
+// A submesh as it's stored in a cache file. Names are offsets into the submesh names section
+// plus 1, or 0 for no name.
+typedef struct
+{
+    unsigned int first_index;
+    unsigned int num_indices;
+    unsigned int object_name;
+    unsigned int group_name;
+    unsigned int material_name;
+    float bounds_min[3];
+    float bounds_max[3];
+} n3dc_obj_cache_submesh_t;
+
+// A LOD as it's stored in a cache file. Its indices start at first_index in the LOD indices
+// section, which holds every LOD's indices back to back.
+typedef struct
+{
+    float target_ratio;
+    unsigned int num_indices;
+    unsigned int num_vertices;
+    unsigned int first_index;
+} n3dc_obj_cache_lod_t;
+
+typedef struct
+{
+    unsigned int type;
+    unsigned int reserved;
+    unsigned long long offset;
+    unsigned long long size;
+} n3dc_obj_cache_section_t;
+
+static const char n3dc_obj_cache_magic[8] = {'N', '3', 'D', 'C', 'O', 'B', 'J', 'C'};
+
+// Gets the size and modification time that cache files are stamped with. The time is as precise as
+// the platform reports it, so that an edit within the same second as the last one (that keeps the
+// size) still makes the cache stale.
+static int n3dc_obj_get_file_stamp(const char* path, unsigned long long* size, long long* mtime)
+{
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if(!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) { return -1; }
+    *size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    *mtime = (long long)(((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) 
+        | attributes.ftLastWriteTime.dwLowDateTime);
+    return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct stat file_stat;
+    if(stat(path, &file_stat)) { return -1; }
+    *size = (unsigned long long)file_stat.st_size;
+    // st_mtime is a macro for the seconds of the nanosecond timespec where the system has one.
+#if defined(__APPLE__) && defined(st_mtime)
+    const long long nanoseconds = (long long)file_stat.st_mtimespec.tv_nsec;
+#elif defined(st_mtime)
+    const long long nanoseconds = (long long)file_stat.st_mtim.tv_nsec;
+#elif defined(__GLIBC__)
+    // Strict ISO C modes hide the timespec, but glibc still has the nanoseconds beside st_mtime.
+    const long long nanoseconds = (long long)file_stat.st_mtimensec;
+#else
+    const long long nanoseconds = 0;
+#endif
+    *mtime = (long long)file_stat.st_mtime * 1000000000 + nanoseconds;
+    return 0;
+#else
+    // Without a portable way to get the modification time, only the size is checked.
+    FILE* fp = fopen(path, "rb");
+    if(!fp) { return -1; }
+    fseek(fp, 0, SEEK_END);
+    *size = (unsigned long long)ftell(fp);
+    fclose(fp);
+    *mtime = 0;
+    return 0;
+#endif
+}
+
+static int n3dc_obj_write_padding(FILE* fp, unsigned long long* offset)
+{
+    static const char zeros[64] = {0};
+    const size_t padding = (size_t)((64 - (*offset & 63)) & 63);
+    *offset += padding;
+    return (fwrite(zeros, 1, padding, fp) == padding) ? 0 : -1;
+}
+
+// Writes a cache file stamped with a source file stamp that the caller took before loading it, so
+// that a source edited while it was being parsed leaves a stale cache rather than a wrong one.
+static int n3dc_obj_cache_write_stamped(
+    const n3dc_obj_t* obj, const char* cache_path, const unsigned long long source_size, const long long source_mtime
+){
+    n3dc_obj_cache_header_t header;
+    memset(&header, 0, sizeof(n3dc_obj_cache_header_t));
+    memcpy(header.magic, n3dc_obj_cache_magic, sizeof(header.magic));
+    header.version = N3DC_OBJ_CACHE_VERSION;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.num_vertices = obj->num_vertices;
+    header.num_indices = obj->num_indices;
+    header.vertex_stride = obj->vertex_stride;
+
+    const n3dc_obj_allocation_t* allocation = (const n3dc_obj_allocation_t*)obj;
+    n3dc_obj_cache_submesh_t* cache_submeshes = NULL;
+    if(obj->num_submeshes > 0)
+    {
+        cache_submeshes = (n3dc_obj_cache_submesh_t*)malloc(sizeof(n3dc_obj_cache_submesh_t) * obj->num_submeshes);
+        if(!cache_submeshes) { return -1; }
+        for(unsigned int i = 0; i < obj->num_submeshes; i++)
+        {
+            const n3dc_obj_submesh_t* submesh = &obj->submeshes[i];
+            n3dc_obj_cache_submesh_t* cache_submesh = &cache_submeshes[i];
+            const char* names[3] = {submesh->object_name, submesh->group_name, submesh->material_name};
+            unsigned int name_offsets[3];
+            for(unsigned int j = 0; j < 3; j++)
+            {
+                name_offsets[j] = names[j] ? (unsigned int)(names[j] - allocation->submesh_names) + 1 : 0;
+            }
+            cache_submesh->first_index = submesh->first_index;
+            cache_submesh->num_indices = submesh->num_indices;
+            cache_submesh->object_name = name_offsets[0];
+            cache_submesh->group_name = name_offsets[1];
+            cache_submesh->material_name = name_offsets[2];
+            memcpy(cache_submesh->bounds_min, submesh->bounds_min, sizeof(cache_submesh->bounds_min));
+            memcpy(cache_submesh->bounds_max, submesh->bounds_max, sizeof(cache_submesh->bounds_max));
+        }
+    }
+    if(allocation->has_submeshes) { header.flags |= N3DC_OBJ_CACHE_FLAG_SUBMESHES; }
+    if(allocation->skip_attributes & N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS) { header.flags |= N3DC_OBJ_CACHE_FLAG_NO_TEXTURE_COORDS; }
+    if(allocation->skip_attributes & N3DC_OBJ_ATTRIBUTE_NORMALS) { header.flags |= N3DC_OBJ_CACHE_FLAG_NO_NORMALS; }
+    if(allocation->has_bvh) { header.flags |= N3DC_OBJ_CACHE_FLAG_BVH; }
+    if(allocation->has_materials) { header.flags |= N3DC_OBJ_CACHE_FLAG_MATERIALS; }
+    n3dc_obj_cache_lod_t* cache_lods = NULL;
+    unsigned int* lod_indices = NULL;
+    size_t num_lod_indices = 0;
+    if(obj->num_lods > 0)
+    {
+        for(unsigned int i = 0; i < obj->num_lods; i++) { num_lod_indices += obj->lods[i].num_indices; }
+        cache_lods = (n3dc_obj_cache_lod_t*)malloc(sizeof(n3dc_obj_cache_lod_t) * obj->num_lods);
+        lod_indices = (unsigned int*)malloc(sizeof(unsigned int) * (num_lod_indices + 1));
+        if(!cache_lods || !lod_indices)
+        {
+            free(cache_submeshes);
+            free(cache_lods);
+            free(lod_indices);
+            return -1;
+        }
+        unsigned int first_index = 0;
+        for(unsigned int i = 0; i < obj->num_lods; i++)
+        {
+            const n3dc_obj_lod_t* lod = &obj->lods[i];
+            cache_lods[i].target_ratio = lod->target_ratio;
+            cache_lods[i].num_indices = lod->num_indices;
+            cache_lods[i].num_vertices = lod->num_vertices;
+            cache_lods[i].first_index = first_index;
+            memcpy(&lod_indices[first_index], lod->indices, sizeof(unsigned int) * lod->num_indices);
+            first_index += lod->num_indices;
+        }
+    }
+
+    const void* section_data[N3DC_OBJ_CACHE_NUM_SECTION_TYPES];
+    n3dc_obj_cache_section_t sections[N3DC_OBJ_CACHE_NUM_SECTION_TYPES];
+    const size_t num_vertices = obj->num_vertices;
+    const void* arrays[N3DC_OBJ_CACHE_NUM_SECTION_TYPES] = {
+        obj->vertices, obj->normals, obj->texture_coords, obj->indices, obj->interleaved_vertices,
+        cache_submeshes, allocation->submesh_names_size > 0 ? allocation->submesh_names : NULL,
+        cache_lods, num_lod_indices > 0 ? lod_indices : NULL, obj->bvh_nodes, obj->bvh_triangles,
+        allocation->material_library_paths
+    };
+    const size_t array_sizes[N3DC_OBJ_CACHE_NUM_SECTION_TYPES] = {
+        sizeof(float) * num_vertices * 3, sizeof(float) * num_vertices * 3, sizeof(float) * num_vertices * 2,
+        sizeof(unsigned int) * obj->num_indices, num_vertices * obj->vertex_stride,
+        sizeof(n3dc_obj_cache_submesh_t) * obj->num_submeshes, allocation->submesh_names_size,
+        sizeof(n3dc_obj_cache_lod_t) * obj->num_lods, sizeof(unsigned int) * num_lod_indices,
+        sizeof(n3dc_obj_bvh_node_t) * obj->num_bvh_nodes, 
+        sizeof(unsigned int) * ((obj->indices ? obj->num_indices : obj->num_vertices) / 3),
+        allocation->material_library_paths_size
+    };
+    for(unsigned int i = 0; i < N3DC_OBJ_CACHE_NUM_SECTION_TYPES; i++)
+    {
+        if(!arrays[i]) { continue; }
+        memset(&sections[header.num_sections], 0, sizeof(n3dc_obj_cache_section_t));
+        sections[header.num_sections].type = i;
+        sections[header.num_sections].size = array_sizes[i];
+        section_data[header.num_sections] = arrays[i];
+        header.num_sections++;
+    }
+    header.position_offset = -1;
+    header.normal_offset = -1;
+    header.texture_coord_offset = -1;
+    if(allocation->has_layout)
+    {
+        header.position_offset = allocation->layout.position_offset;
+        header.normal_offset = allocation->layout.normal_offset;
+        header.texture_coord_offset = allocation->layout.texture_coord_offset;
+        header.position_format = (unsigned int)allocation->layout.position_format;
+        header.normal_format = (unsigned int)allocation->layout.normal_format;
+        header.texture_coord_format = (unsigned int)allocation->layout.texture_coord_format;
+    }
+    header.normal_mode = (unsigned int)allocation->normal_mode;
+    header.vertex_cache_size = allocation->vertex_cache_size;
+
+    unsigned long long offset = sizeof(n3dc_obj_cache_header_t) 
+        + sizeof(n3dc_obj_cache_section_t) * header.num_sections;
+    for(unsigned int i = 0; i < header.num_sections; i++)
+    {
+        offset = (offset + 63) & ~(unsigned long long)63;
+        sections[i].offset = offset;
+        offset += sections[i].size;
+    }
+
+    // Write to a temporary file first so that readers never see a partially written cache.
+    const size_t cache_path_length = strlen(cache_path);
+    char* temp_path = (char*)malloc(cache_path_length + 5);
+    if(!temp_path)
+    {
+        free(cache_submeshes);
+        free(cache_lods);
+        free(lod_indices);
+        return -1;
+    }
+    memcpy(temp_path, cache_path, cache_path_length);
+    memcpy(&temp_path[cache_path_length], ".tmp", 5);
+    FILE* fp = fopen(temp_path, "wb");
+    if(!fp)
+    {
+        free(temp_path);
+        free(cache_submeshes);
+        free(cache_lods);
+        free(lod_indices);
+        return -1;
+    }
+    int error = 0;
+    error |= fwrite(&header, sizeof(n3dc_obj_cache_header_t), 1, fp) != 1;
+    error |= fwrite(sections, sizeof(n3dc_obj_cache_section_t), header.num_sections, fp) != header.num_sections;
+    offset = sizeof(n3dc_obj_cache_header_t) + sizeof(n3dc_obj_cache_section_t) * header.num_sections;
+    for(unsigned int i = 0; i < header.num_sections && !error; i++)
+    {
+        error |= n3dc_obj_write_padding(fp, &offset);
+        error |= fwrite(section_data[i], 1, (size_t)sections[i].size, fp) != sections[i].size;
+        offset += sections[i].size;
+    }
+    error |= fclose(fp) != 0;
+#if defined(_WIN32)
+    if(!error) { error = !MoveFileExA(temp_path, cache_path, MOVEFILE_REPLACE_EXISTING); }
+#else
+    if(!error) { error = rename(temp_path, cache_path) != 0; }
+#endif
+    if(error) { remove(temp_path); }
+    free(temp_path);
+    free(cache_submeshes);
+    free(cache_lods);
+    free(lod_indices);
+    return error ? -1 : 0;
+}
+
+int n3dc_obj_cache_write(const n3dc_obj_t* obj, const char* cache_path, const char* source_path)
+{
+    unsigned long long source_size = 0;
+    long long source_mtime = 0;
+    if(n3dc_obj_get_file_stamp(source_path, &source_size, &source_mtime)) { return -1; }
+    return n3dc_obj_cache_write_stamped(obj, cache_path, source_size, source_mtime);
+}
+
+// Unpacks a cache file's submeshes into a newly allocated array whose names point into the
+// mapped names section. Returns -1 if a range or name is out of bounds.
+static int n3dc_obj_cache_load_submeshes(
+    n3dc_obj_t* obj, const n3dc_obj_cache_header_t* header, 
+    const n3dc_obj_cache_section_t* submeshes_section, const n3dc_obj_cache_section_t* names_section,
+    const char* cache_chars, const n3dc_obj_allocator_t* allocator
+){
+    const size_t num_submeshes = (size_t)(submeshes_section->size / sizeof(n3dc_obj_cache_submesh_t));
+    const n3dc_obj_cache_submesh_t* cache_submeshes = 
+        (const n3dc_obj_cache_submesh_t*)(cache_chars + submeshes_section->offset);
+    const char* names = names_section ? cache_chars + names_section->offset : NULL;
+    const size_t names_size = names_section ? (size_t)names_section->size : 0;
+    // Every name ends at a NUL, so checking that the last one does keeps names inside the section.
+    if(num_submeshes == 0 || (names_size > 0 && names[names_size - 1] != '\0')) { return -1; }
+    obj->submeshes = (n3dc_obj_submesh_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_submesh_t) * num_submeshes);
+    if(!obj->submeshes) { return -1; }
+    obj->num_submeshes = (unsigned int)num_submeshes;
+    const unsigned int num_range_indices = header->num_indices > 0 ? header->num_indices : header->num_vertices;
+    for(size_t i = 0; i < num_submeshes; i++)
+    {
+        const n3dc_obj_cache_submesh_t* cache_submesh = &cache_submeshes[i];
+        n3dc_obj_submesh_t* submesh = &obj->submeshes[i];
+        if(cache_submesh->first_index > num_range_indices 
+            || cache_submesh->num_indices > num_range_indices - cache_submesh->first_index)
+        {
+            return -1;
+        }
+        const unsigned int name_offsets[3] = {
+            cache_submesh->object_name, cache_submesh->group_name, cache_submesh->material_name
+        };
+        const char* submesh_names[3] = {NULL, NULL, NULL};
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            if(name_offsets[j] == 0) { continue; }
+            if(name_offsets[j] > names_size) { return -1; }
+            submesh_names[j] = &names[name_offsets[j] - 1];
+        }
+        submesh->first_index = cache_submesh->first_index;
+        submesh->num_indices = cache_submesh->num_indices;
+        submesh->object_name = submesh_names[0];
+        submesh->group_name = submesh_names[1];
+        submesh->material_name = submesh_names[2];
+        submesh->material_index = N3DC_OBJ_MISSING_INDEX;
+        memcpy(submesh->bounds_min, cache_submesh->bounds_min, sizeof(submesh->bounds_min));
+        memcpy(submesh->bounds_max, cache_submesh->bounds_max, sizeof(submesh->bounds_max));
+    }
+    ((n3dc_obj_allocation_t*)obj)->submesh_names = names;
+    ((n3dc_obj_allocation_t*)obj)->submesh_names_size = names_size;
+    return 0;
+}
+
+// Stands in for the LOD indices section when every LOD is empty, since loaded LODs never have
+// NULL indices.
+static unsigned int n3dc_obj_cache_no_lod_indices[1];
+
+// Unpacks a cache file's LODs into a newly allocated array whose indices point into the mapped
+// LOD indices section. Returns -1 if any LOD's indices are out of bounds.
+static int n3dc_obj_cache_load_lods(
+    n3dc_obj_t* obj, const n3dc_obj_cache_header_t* header, 
+    const n3dc_obj_cache_section_t* lods_section, const n3dc_obj_cache_section_t* indices_section,
+    const char* cache_chars, const n3dc_obj_allocator_t* allocator
+){
+    const size_t num_lods = (size_t)(lods_section->size / sizeof(n3dc_obj_cache_lod_t));
+    const n3dc_obj_cache_lod_t* cache_lods = (const n3dc_obj_cache_lod_t*)(cache_chars + lods_section->offset);
+    unsigned int* indices = indices_section 
+        ? (unsigned int*)(cache_chars + indices_section->offset) : n3dc_obj_cache_no_lod_indices;
+    const size_t num_indices = indices_section ? (size_t)(indices_section->size / sizeof(unsigned int)) : 0;
+    if(num_lods == 0) { return -1; }
+    obj->lods = (n3dc_obj_lod_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_lod_t) * num_lods);
+    if(!obj->lods) { return -1; }
+    obj->num_lods = (unsigned int)num_lods;
+    for(size_t i = 0; i < num_lods; i++)
+    {
+        const n3dc_obj_cache_lod_t* cache_lod = &cache_lods[i];
+        if(cache_lod->first_index > num_indices || cache_lod->num_indices > num_indices - cache_lod->first_index
+            || cache_lod->num_vertices > header->num_vertices)
+        {
+            return -1;
+        }
+        obj->lods[i].target_ratio = cache_lod->target_ratio;
+        obj->lods[i].num_indices = cache_lod->num_indices;
+        obj->lods[i].indices = &indices[cache_lod->first_index];
+        obj->lods[i].num_vertices = cache_lod->num_vertices;
+    }
+    return 0;
+}
+
+// Points the obj's BVH at a cache file's mapped BVH sections. Returns -1 unless the sections
+// hold one triangle per triangle of the mesh and every node's children and triangles are in
+// bounds, with children after their parents, so that traversals always stay in the arrays.
+static int n3dc_obj_cache_load_bvh(
+    n3dc_obj_t* obj, const n3dc_obj_cache_header_t* header, 
+    const n3dc_obj_cache_section_t* nodes_section, const n3dc_obj_cache_section_t* triangles_section,
+    const char* cache_chars
+){
+    const size_t num_nodes = (size_t)(nodes_section->size / sizeof(n3dc_obj_bvh_node_t));
+    const size_t num_triangles = triangles_section ? (size_t)(triangles_section->size / sizeof(unsigned int)) : 0;
+    if(num_nodes == 0 || num_nodes > (unsigned int)-1 
+        || num_triangles != (header->num_indices > 0 ? header->num_indices : header->num_vertices) / 3)
+    {
+        return -1;
+    }
+    n3dc_obj_bvh_node_t* nodes = (n3dc_obj_bvh_node_t*)(cache_chars + nodes_section->offset);
+    for(size_t i = 0; i < num_nodes; i++)
+    {
+        const n3dc_obj_bvh_node_t* node = &nodes[i];
+        if(node->num_triangles > 0 
+            ? node->offset > num_triangles || node->num_triangles > num_triangles - node->offset
+            : i + 1 >= num_nodes || node->offset <= i + 1 || node->offset >= num_nodes)
+        {
+            return -1;
+        }
+    }
+    obj->num_bvh_nodes = (unsigned int)num_nodes;
+    obj->bvh_nodes = nodes;
+    obj->bvh_triangles = (unsigned int*)(cache_chars + triangles_section->offset);
+    return 0;
+}
+
+// Returns -1 unless every array section is exactly as large as the header's counts make it, and
+// the interleaved vertices' layout fits inside the header's stride, so that the arrays can be
+// read up to num_vertices and num_indices without leaving their sections.
+static int n3dc_obj_cache_check_arrays(
+    const n3dc_obj_cache_header_t* header, const n3dc_obj_cache_section_t* sections
+){
+    const unsigned long long num_vertices = header->num_vertices;
+    const unsigned long long expected_sizes[N3DC_OBJ_CACHE_SECTION_INTERLEAVED_VERTICES + 1] = {
+        sizeof(float) * num_vertices * 3, sizeof(float) * num_vertices * 3, sizeof(float) * num_vertices * 2,
+        sizeof(unsigned int) * (unsigned long long)header->num_indices, num_vertices * header->vertex_stride
+    };
+    int has_indices = 0;
+    for(unsigned int i = 0; i < header->num_sections; i++)
+    {
+        const n3dc_obj_cache_section_t* section = &sections[i];
+        if(section->type > N3DC_OBJ_CACHE_SECTION_INTERLEAVED_VERTICES) { continue; }
+        if(section->size != expected_sizes[section->type]) { return -1; }
+        has_indices |= section->type == N3DC_OBJ_CACHE_SECTION_INDICES;
+        if(section->type == N3DC_OBJ_CACHE_SECTION_INTERLEAVED_VERTICES)
+        {
+            n3dc_obj_vertex_layout_t layout;
+            layout.stride = header->vertex_stride;
+            layout.position_offset = header->position_offset;
+            layout.normal_offset = header->normal_offset;
+            layout.texture_coord_offset = header->texture_coord_offset;
+            layout.position_format = (n3dc_obj_attribute_format_t)header->position_format;
+            layout.normal_format = (n3dc_obj_attribute_format_t)header->normal_format;
+            layout.texture_coord_format = (n3dc_obj_attribute_format_t)header->texture_coord_format;
+            if(!n3dc_obj_is_valid_vertex_layout(&layout)) { return -1; }
+        }
+    }
+    return (header->num_indices > 0 && !has_indices) ? -1 : 0;
+}
+
+static n3dc_obj_t* n3dc_obj_cache_load_with_allocator(
+    const char* cache_path, const char* source_path, const n3dc_obj_allocator_t* allocator
+){
+    unsigned long long source_size = 0;
+    long long source_mtime = 0;
+    unsigned long long cache_size = 0;
+    long long cache_mtime = 0;
+    // A missing cache isn't an error, so check for it before trying to map it.
+    if(n3dc_obj_get_file_stamp(source_path, &source_size, &source_mtime)
+        || n3dc_obj_get_file_stamp(cache_path, &cache_size, &cache_mtime))
+    {
+        return NULL;
+    }
+    n3dc_obj_file_view_t view;
+    if(n3dc_obj_map_file(cache_path, allocator, 1, &view, NULL)) { return NULL; }
+
+    const n3dc_obj_cache_header_t* header = (const n3dc_obj_cache_header_t*)view.chars;
+    const size_t table_size = view.length >= sizeof(n3dc_obj_cache_header_t) 
+        ? sizeof(n3dc_obj_cache_section_t) * header->num_sections : 0;
+    if(view.length < sizeof(n3dc_obj_cache_header_t) 
+        || memcmp(header->magic, n3dc_obj_cache_magic, sizeof(header->magic)) 
+        || header->version != N3DC_OBJ_CACHE_VERSION
+        || header->source_size != source_size || header->source_mtime != source_mtime
+        || table_size > view.length - sizeof(n3dc_obj_cache_header_t))
+    {
+        n3dc_obj_unmap_text_file(&view);
+        return NULL;
+    }
+    n3dc_obj_t* obj = n3dc_obj_allocate_output(allocator);
+    if(!obj)
+    {
+        n3dc_obj_unmap_text_file(&view);
+        return NULL;
+    }
+    // The arrays point into the mapping from here on, so freeing the obj has to unmap it rather
+    // than deallocate them, including when the cache is rejected.
+    n3dc_obj_allocation_t* allocation = (n3dc_obj_allocation_t*)obj;
+    allocation->is_cached = 1;
+    allocation->cache_view = view;
+    const n3dc_obj_cache_section_t* sections = (const n3dc_obj_cache_section_t*)(header + 1);
+    const n3dc_obj_cache_section_t* submeshes_section = NULL;
+    const n3dc_obj_cache_section_t* names_section = NULL;
+    const n3dc_obj_cache_section_t* lods_section = NULL;
+    const n3dc_obj_cache_section_t* lod_indices_section = NULL;
+    const n3dc_obj_cache_section_t* bvh_nodes_section = NULL;
+    const n3dc_obj_cache_section_t* bvh_triangles_section = NULL;
+    const n3dc_obj_cache_section_t* material_libraries_section = NULL;
+    for(unsigned int i = 0; i < header->num_sections; i++)
+    {
+        const n3dc_obj_cache_section_t* section = &sections[i];
+        if(section->offset > view.length || section->size > view.length - section->offset)
+        {
+            n3dc_obj_free(obj);
+            return NULL;
+        }
+        void* data = (void*)(view.chars + section->offset);
+        switch(section->type)
+        {
+            case N3DC_OBJ_CACHE_SECTION_VERTICES: obj->vertices = (float*)data; break;
+            case N3DC_OBJ_CACHE_SECTION_NORMALS: obj->normals = (float*)data; break;
+            case N3DC_OBJ_CACHE_SECTION_TEXTURE_COORDS: obj->texture_coords = (float*)data; break;
+            case N3DC_OBJ_CACHE_SECTION_INDICES: obj->indices = (unsigned int*)data; break;
+            case N3DC_OBJ_CACHE_SECTION_INTERLEAVED_VERTICES: obj->interleaved_vertices = data; break;
+            case N3DC_OBJ_CACHE_SECTION_SUBMESHES: submeshes_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_SUBMESH_NAMES: names_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_LODS: lods_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_LOD_INDICES: lod_indices_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_BVH_NODES: bvh_nodes_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_BVH_TRIANGLES: bvh_triangles_section = section; break;
+            case N3DC_OBJ_CACHE_SECTION_MATERIAL_LIBRARIES: material_libraries_section = section; break;
+            default: break;
+        }
+    }
+    if(n3dc_obj_cache_check_arrays(header, sections)
+        || (submeshes_section 
+            && n3dc_obj_cache_load_submeshes(obj, header, submeshes_section, names_section, view.chars, allocator))
+        || (lods_section
+            && n3dc_obj_cache_load_lods(obj, header, lods_section, lod_indices_section, view.chars, allocator))
+        || (bvh_nodes_section
+            && n3dc_obj_cache_load_bvh(obj, header, bvh_nodes_section, bvh_triangles_section, view.chars))
+        || (material_libraries_section
+            && (material_libraries_section->size == 0
+                || view.chars[material_libraries_section->offset + material_libraries_section->size - 1] != '\0')))
+    {
+        n3dc_obj_free(obj);
+        return NULL;
+    }
+    obj->num_vertices = header->num_vertices;
+    obj->num_indices = header->num_indices;
+    obj->vertex_stride = header->vertex_stride;
+    allocation->layout.stride = header->vertex_stride;
+    allocation->layout.position_offset = header->position_offset;
+    allocation->layout.normal_offset = header->normal_offset;
+    allocation->layout.texture_coord_offset = header->texture_coord_offset;
+    allocation->layout.position_format = (n3dc_obj_attribute_format_t)header->position_format;
+    allocation->layout.normal_format = (n3dc_obj_attribute_format_t)header->normal_format;
+    allocation->layout.texture_coord_format = (n3dc_obj_attribute_format_t)header->texture_coord_format;
+    allocation->has_layout = obj->interleaved_vertices != NULL;
+    allocation->normal_mode = (n3dc_obj_normal_mode_t)header->normal_mode;
+    allocation->vertex_cache_size = header->vertex_cache_size;
+    allocation->has_submeshes = (header->flags & N3DC_OBJ_CACHE_FLAG_SUBMESHES) != 0;
+    if(header->flags & N3DC_OBJ_CACHE_FLAG_NO_TEXTURE_COORDS) { allocation->skip_attributes |= N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS; }
+    if(header->flags & N3DC_OBJ_CACHE_FLAG_NO_NORMALS) { allocation->skip_attributes |= N3DC_OBJ_ATTRIBUTE_NORMALS; }
+    allocation->has_bvh = (header->flags & N3DC_OBJ_CACHE_FLAG_BVH) != 0;
+    allocation->has_materials = (header->flags & N3DC_OBJ_CACHE_FLAG_MATERIALS) != 0;
+    if(material_libraries_section)
+    {
+        allocation->material_library_paths = view.chars + material_libraries_section->offset;
+        allocation->material_library_paths_size = (size_t)material_libraries_section->size;
+    }
+    if(allocation->has_materials && n3dc_obj_attach_materials(obj, allocator))
+    {
+        n3dc_obj_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+n3dc_obj_t* n3dc_obj_cache_load(const char* cache_path, const char* source_path)
+{
+    return n3dc_obj_cache_load_with_allocator(cache_path, source_path, NULL);
+}
+
+n3dc_obj_t* n3dc_obj_load_cached(
+    const char* path,
+    const char* cache_path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+    const n3dc_obj_vertex_layout_t* layout = options ? options->vertex_layout : NULL;
+    const int indexed = options && options->output_mode == N3DC_OBJ_OUTPUT_INDEXED;
+    const n3dc_obj_normal_mode_t normal_mode = options ? options->normal_mode : N3DC_OBJ_NORMALS_FROM_FILE;
+    unsigned int vertex_cache_size = 0;
+    if(indexed && options->optimize_vertex_cache)
+    {
+        vertex_cache_size = options->vertex_cache_size ? options->vertex_cache_size : 16;
+    }
+    n3dc_obj_t* obj = n3dc_obj_cache_load_with_allocator(cache_path, path, allocator);
+    if(obj)
+    {
+        // Only use the cache if it was built with the same output settings.
+        const n3dc_obj_vertex_layout_t* cache_layout = &((n3dc_obj_allocation_t*)obj)->layout;
+        int matches = indexed == (obj->indices != NULL) && (layout != NULL) == (obj->interleaved_vertices != NULL)
+            && normal_mode == ((n3dc_obj_allocation_t*)obj)->normal_mode
+            && vertex_cache_size == ((n3dc_obj_allocation_t*)obj)->vertex_cache_size
+            && (options && options->record_submeshes) == ((n3dc_obj_allocation_t*)obj)->has_submeshes
+            && (options ? options->skip_attributes : 0) == ((n3dc_obj_allocation_t*)obj)->skip_attributes
+            && (options && options->build_bvh) == ((n3dc_obj_allocation_t*)obj)->has_bvh
+            && (options && options->load_materials) == ((n3dc_obj_allocation_t*)obj)->has_materials
+            && (options ? options->num_lods : 0) == obj->num_lods;
+        for(unsigned int i = 0; matches && i < obj->num_lods; i++)
+        {
+            matches = options->lod_ratios[i] == obj->lods[i].target_ratio;
+        }
+        if(matches && layout)
+        {
+            matches = layout->stride == cache_layout->stride 
+                && layout->position_offset == cache_layout->position_offset
+                && layout->normal_offset == cache_layout->normal_offset
+                && layout->texture_coord_offset == cache_layout->texture_coord_offset
+                && layout->position_format == cache_layout->position_format
+                && layout->normal_format == cache_layout->normal_format
+                && layout->texture_coord_format == cache_layout->texture_coord_format;
+        }
+        if(matches && layout && options->interleaved_buffer)
+        {
+            const size_t interleaved_size = (size_t)obj->num_vertices * obj->vertex_stride;
+            matches = interleaved_size <= options->interleaved_buffer_size;
+            if(matches)
+            {
+                memcpy(options->interleaved_buffer, obj->interleaved_vertices, interleaved_size);
+                obj->interleaved_vertices = options->interleaved_buffer;
+            }
+        }
+        if(matches)
+        {
+            if(options && options->stats) { memset(options->stats, 0, sizeof(n3dc_obj_stats_t)); }
+            if(options && options->error) { memset(options->error, 0, sizeof(n3dc_obj_error_t)); }
+            return obj;
+        }
+        n3dc_obj_free(obj);
+    }
+    // Stamp the source before it's read, so that edits made during the load make the cache stale.
+    unsigned long long source_size = 0;
+    long long source_mtime = 0;
+    const int has_stamp = !n3dc_obj_get_file_stamp(path, &source_size, &source_mtime);
+    obj = n3dc_obj_load_with_options(path, max_vertices, max_normals, max_indices, options);
+    if(obj && has_stamp) { n3dc_obj_cache_write_stamped(obj, cache_path, source_size, source_mtime); }
+    return obj;
+}
+
+struct n3dc_obj_stream
+{
+    n3dc_obj_load_options_t options;
+    int has_options;
+    n3dc_obj_scratch_t scratch;
+    n3dc_obj_parse_state_t state;
+    // The unfinished last line of the previous chunk.
+    char* carry;
+    size_t carry_length;
+    size_t carry_capacity;
+    // Number of characters and newlines in the lines parsed so far, for locating errors.
+    size_t parsed_length;
+    size_t parsed_newlines;
+    int error;
+};
+
+n3dc_obj_stream_t* n3dc_obj_stream_begin(
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    if(n3dc_obj_validate_options(options)) { return NULL; }
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+    n3dc_obj_stream_t* stream = (n3dc_obj_stream_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_stream_t));
+    if(!stream)
+    {
+        n3dc_obj_set_error(options ? options->error : NULL, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    memset(stream, 0, sizeof(n3dc_obj_stream_t));
+    if(options)
+    {
+        stream->options = *options;
+        stream->has_options = 1;
+    }
+    n3dc_obj_init_scratch(&stream->scratch, options);
+    stream->state.scratch = &stream->scratch;
+    stream->state.max_vertices = max_vertices;
+    stream->state.max_texture_coords = max_indices;
+    stream->state.max_normals = max_normals;
+    stream->state.max_indices = max_indices;
+    stream->state.record_submeshes = options ? options->record_submeshes : 0;
+    stream->state.load_materials = options ? options->load_materials : 0;
+    stream->state.skip_attributes = options ? options->skip_attributes : 0;
+    stream->state.record_forward_references = 1;
+    if(n3dc_obj_allocate_parse_state(&stream->state))
+    {
+        n3dc_obj_report_error(options, &stream->state.error);
+        n3dc_obj_deallocate(allocator, stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// Appends characters to the stream's unfinished line.
+static int n3dc_obj_stream_carry(n3dc_obj_stream_t* stream, const char* chars, const size_t length)
+{
+    if(length == 0) { return 0; }
+    if(stream->carry_length + length > stream->carry_capacity)
+    {
+        size_t capacity = stream->carry_capacity ? stream->carry_capacity : 256;
+        while(capacity < stream->carry_length + length) { capacity *= 2; }
+        char* carry = (char*)n3dc_obj_reallocate(
+            stream->scratch.allocator, stream->carry, stream->carry_capacity, capacity
+        );
+        if(!carry)
+        {
+            stream->error = -1;
+            return n3dc_obj_set_error(&stream->state.error, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        }
+        stream->carry = carry;
+        stream->carry_capacity = capacity;
+    }
+    memcpy(&stream->carry[stream->carry_length], chars, length);
+    stream->carry_length += length;
+    return 0;
+}
+
+// Parses lines that continue the ones parsed so far, turning the offsets of the forward references
+// they add into offsets and lines in the whole stream.
+static int n3dc_obj_stream_parse_lines(n3dc_obj_stream_t* stream, const char* lines, const size_t lines_length)
+{
+    n3dc_obj_parse_state_t* state = &stream->state;
+    size_t reference_index = state->num_forward_references;
+    if(n3dc_obj_parse_records(lines, lines_length, state))
+    {
+        n3dc_obj_locate_error(&state->error, lines, stream->parsed_length, stream->parsed_newlines);
+        stream->error = -1;
+        return -1;
+    }
+    size_t offset = 0;
+    size_t newlines = stream->parsed_newlines;
+    for(; reference_index < state->num_forward_references; reference_index++)
+    {
+        n3dc_obj_forward_reference_t* reference = &state->forward_references[reference_index];
+        newlines += n3dc_obj_count_newlines(&lines[offset], reference->offset - offset);
+        offset = reference->offset;
+        reference->offset += stream->parsed_length;
+        reference->line = newlines + 1;
+    }
+    stream->parsed_length += lines_length;
+    stream->parsed_newlines = newlines + n3dc_obj_count_newlines(&lines[offset], lines_length - offset);
+    return 0;
+}
+
+// Parses the complete lines of a chunk and carries its unfinished last line over to the next one.
+static int n3dc_obj_stream_parse(n3dc_obj_stream_t* stream, const char* chunk, const size_t chunk_length)
+{
+    size_t offset = 0;
+    if(stream->carry_length > 0)
+    {
+        // Finish the previous chunk's last line with the start of this chunk.
+        size_t newline = 0;
+        if(!n3dc_obj_seek_newline(chunk, chunk_length, 0, &newline))
+        {
+            return n3dc_obj_stream_carry(stream, chunk, chunk_length);
+        }
+        if(n3dc_obj_stream_carry(stream, chunk, newline + 1)) { return -1; }
+        if(n3dc_obj_stream_parse_lines(stream, stream->carry, stream->carry_length)) { return -1; }
+        stream->carry_length = 0;
+        offset = newline + 1;
+    }
+    // Parse every complete line in place and hold on to the unfinished one.
+    size_t lines_end = chunk_length;
+    while(lines_end > offset && chunk[lines_end - 1] != '\n') { lines_end--; }
+    if(lines_end > offset && n3dc_obj_stream_parse_lines(stream, &chunk[offset], lines_end - offset))
+    {
+        return -1;
+    }
+    return n3dc_obj_stream_carry(stream, &chunk[lines_end], chunk_length - lines_end);
+}
+
+int n3dc_obj_stream_feed(n3dc_obj_stream_t* stream, const char* chunk, const size_t chunk_length)
+{
+    if(stream->error) { return -1; }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double start_seconds = n3dc_obj_get_seconds();
+    const int error = n3dc_obj_stream_parse(stream, chunk, chunk_length);
+    stream->state.stats.parse_seconds += n3dc_obj_get_seconds() - start_seconds;
+    stream->state.stats.bytes_processed += chunk_length;
+    return error;
+#else
+    return n3dc_obj_stream_parse(stream, chunk, chunk_length);
+#endif
+}
+
+n3dc_obj_t* n3dc_obj_stream_end(n3dc_obj_stream_t* stream)
+{
+    // The last line doesn't need to end with a newline.
+    if(!stream->error && stream->carry_length > 0)
+    {
+        n3dc_obj_stream_parse_lines(stream, stream->carry, stream->carry_length);
+    }
+    const n3dc_obj_load_options_t* options = stream->has_options ? &stream->options : NULL;
+    n3dc_obj_t* obj = n3dc_obj_finish_load(&stream->state, stream->error, options, NULL, 0);
+    const n3dc_obj_allocator_t* allocator = stream->scratch.allocator;
+    n3dc_obj_deallocate(allocator, stream->carry);
+    n3dc_obj_deallocate(allocator, stream);
+    return obj;
+}
+
+struct n3dc_obj_sequence
+{
+    n3dc_obj_load_options_t options;
+    int has_options;
+    n3dc_obj_scratch_t scratch;
+    // Parses the v lines of every frame after the first, reusing its arrays from frame to frame.
+    n3dc_obj_parse_state_t state;
+    // The first frame's mesh and the v record of each of its vertices.
+    n3dc_obj_t* obj;
+    unsigned int* position_indices;
+    // Number of v lines in the first frame, which every other frame must have too.
+    unsigned int num_frame_vertices;
+};
+
+// Begins a sequence with the characters of the OBJ file at path, or NULL for data that didn't
+// come from a file, like n3dc_obj_load_from_memory_at_path does.
+static n3dc_obj_sequence_t* n3dc_obj_sequence_begin_at_path(
+    const char* path,
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    if(n3dc_obj_validate_options(options)) { return NULL; }
+    const n3dc_obj_allocator_t* allocator = options ? options->allocator : NULL;
+    n3dc_obj_sequence_t* sequence = (n3dc_obj_sequence_t*)n3dc_obj_allocate(allocator, sizeof(n3dc_obj_sequence_t));
+    if(!sequence)
+    {
+        n3dc_obj_set_error(options ? options->error : NULL, N3DC_OBJ_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    memset(sequence, 0, sizeof(n3dc_obj_sequence_t));
+    if(options)
+    {
+        sequence->options = *options;
+        sequence->has_options = 1;
+    }
+    // Arena allocations are only given back when a load ends, so a sequence allocates its
+    // scratch memory instead.
+    n3dc_obj_init_scratch(&sequence->scratch, options);
+    sequence->scratch.arena = NULL;
+    sequence->scratch.arena_size = 0;
+
+    n3dc_obj_parse_state_t state;
+    memset(&state, 0, sizeof(n3dc_obj_parse_state_t));
+    state.scratch = &sequence->scratch;
+    state.max_vertices = max_vertices;
+    state.max_texture_coords = max_indices;
+    state.max_normals = max_normals;
+    state.max_indices = max_indices;
+    state.record_submeshes = options ? options->record_submeshes : 0;
+    state.load_materials = options ? options->load_materials : 0;
+    state.skip_attributes = options ? options->skip_attributes : 0;
+    state.path = path;
+    int error = n3dc_obj_parse_file(
+        file_chars, file_chars_length, &state, options ? options->num_threads : 0, options ? options->count_first : 0
+    );
+    if(!error)
+    {
+        // There are never more output vertices than face corners.
+        const size_t position_indices_size = sizeof(unsigned int) * state.parsed_indices;
+        sequence->position_indices = (unsigned int*)n3dc_obj_allocate(
+            allocator, position_indices_size > 0 ? position_indices_size : 1
+        );
+        if(!sequence->position_indices) { error = n3dc_obj_set_error(&state.error, N3DC_OBJ_ERROR_OUT_OF_MEMORY); }
+        state.position_indices = sequence->position_indices;
+    }
+    sequence->num_frame_vertices = state.parsed_vertices;
+    sequence->obj = n3dc_obj_finish_load(&state, error, options, file_chars, file_chars_length);
+    if(!sequence->obj)
+    {
+        n3dc_obj_deallocate(allocator, sequence->position_indices);
+        n3dc_obj_deallocate(allocator, sequence);
+        return NULL;
+    }
+
+    // Later frames only parse their positions, straight into arrays sized for the first frame's.
+    sequence->state.scratch = &sequence->scratch;
+    sequence->state.skip_attributes = N3DC_OBJ_ATTRIBUTE_TEXTURE_COORDS | N3DC_OBJ_ATTRIBUTE_NORMALS;
+    sequence->state.positions_only = 1;
+    return sequence;
+}
+
+n3dc_obj_sequence_t* n3dc_obj_sequence_begin(
+    const char* path,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    n3dc_obj_file_view_t file_view;
+    if(n3dc_obj_map_text_file(path, options ? options->allocator : NULL, &file_view, options ? options->error : NULL))
+    {
+        if(options && options->stats) { memset(options->stats, 0, sizeof(n3dc_obj_stats_t)); }
+        return NULL;
+    }
+    n3dc_obj_sequence_t* sequence = n3dc_obj_sequence_begin_at_path(
+        path, file_view.chars, file_view.length, max_vertices, max_normals, max_indices, options
+    );
+    n3dc_obj_unmap_text_file(&file_view);
+    return sequence;
+}
+
+n3dc_obj_sequence_t* n3dc_obj_sequence_begin_from_memory(
+    const char* file_chars,
+    const size_t file_chars_length,
+    const unsigned int max_vertices,
+    const unsigned int max_normals,
+    const unsigned int max_indices,
+    const n3dc_obj_load_options_t* options
+){
+    return n3dc_obj_sequence_begin_at_path(
+        NULL, file_chars, file_chars_length, max_vertices, max_normals, max_indices, options
+    );
+}
+
+n3dc_obj_t* n3dc_obj_sequence_get_obj(const n3dc_obj_sequence_t* sequence) { return sequence->obj; }
+
+// Parses a frame's v lines and gathers them into positions in the order of the first frame's
+// vertices.
+static int n3dc_obj_sequence_parse_frame(
+    n3dc_obj_sequence_t* sequence, const char* file_chars, const size_t file_chars_length, float* positions
+){
+    n3dc_obj_parse_state_t* state = &sequence->state;
+    const unsigned int num_threads = sequence->has_options ? sequence->options.num_threads : 0;
+    state->parsed_vertices = 0;
+    state->max_vertices = sequence->num_frame_vertices;
+    if(n3dc_obj_parse_file(file_chars, file_chars_length, state, num_threads, 0)) { return -1; }
+    // The first frame's faces would refer to vertices that this frame doesn't have, which is
+    // placed at the end of the frame where the missing v lines would have been.
+    if(state->parsed_vertices < sequence->num_frame_vertices)
+    {
+        n3dc_obj_set_parse_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE, file_chars_length);
+        n3dc_obj_locate_error(&state->error, file_chars, 0, 0);
+        return -1;
+    }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double start_seconds = n3dc_obj_get_seconds();
+#endif
+    const n3dc_obj_gather_attribute_t attribute = {
+        state->vertices, state->parsed_vertices, 3, sequence->position_indices, positions
+    };
+    const int error = n3dc_obj_gather_attributes(
+        &sequence->scratch, &attribute, 1, NULL, sequence->obj->num_vertices, num_threads
+    );
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    state->stats.reorder_seconds = n3dc_obj_get_seconds() - start_seconds;
+#endif
+    return error ? n3dc_obj_set_error(&state->error, N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE) : 0;
+}
+
+int n3dc_obj_sequence_load_frame(n3dc_obj_sequence_t* sequence, const char* path, float* positions)
+{
+    const n3dc_obj_load_options_t* options = sequence->has_options ? &sequence->options : NULL;
+    if(options && options->error) { memset(options->error, 0, sizeof(n3dc_obj_error_t)); }
+    n3dc_obj_file_view_t file_view;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double read_start_seconds = n3dc_obj_get_seconds();
+#endif
+    if(n3dc_obj_map_text_file(path, sequence->scratch.allocator, &file_view, options ? options->error : NULL))
+    {
+        if(options && options->stats) { memset(options->stats, 0, sizeof(n3dc_obj_stats_t)); }
+        return -1;
+    }
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    const double read_seconds = n3dc_obj_get_seconds() - read_start_seconds;
+#endif
+    const int error = n3dc_obj_sequence_load_frame_from_memory(sequence, file_view.chars, file_view.length, positions);
+    n3dc_obj_unmap_text_file(&file_view);
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    if(options && options->stats) { options->stats->read_seconds = read_seconds; }
+#endif
+    return error;
+}
+
+int n3dc_obj_sequence_load_frame_from_memory(
+    n3dc_obj_sequence_t* sequence, const char* file_chars, const size_t file_chars_length, float* positions
+){
+    n3dc_obj_parse_state_t* state = &sequence->state;
+    memset(&state->error, 0, sizeof(n3dc_obj_error_t));
+#if defined(N3DC_OBJ_ENABLE_STATS)
+    memset(&state->stats, 0, sizeof(n3dc_obj_stats_t));
+#endif
+    const int error = n3dc_obj_sequence_parse_frame(sequence, file_chars, file_chars_length, positions);
+    const n3dc_obj_load_options_t* options = sequence->has_options ? &sequence->options : NULL;
+    n3dc_obj_report_error(options, &state->error);
+    if(options && options->stats)
+    {
+        n3dc_obj_stats_t* stats = options->stats;
+#if defined(N3DC_OBJ_ENABLE_STATS)
+        *stats = state->stats;
+        stats->counts.num_vertices = state->parsed_vertices;
+        stats->peak_scratch_bytes = sequence->scratch.peak_bytes;
+#else
+        memset(stats, 0, sizeof(n3dc_obj_stats_t));
+#endif
+    }
+    return error;
+}
+
+void n3dc_obj_sequence_end(n3dc_obj_sequence_t* sequence)
+{
+    if(!sequence) { return; }
+    const n3dc_obj_allocator_t* allocator = sequence->scratch.allocator;
+    n3dc_obj_free_parse_state(&sequence->state);
+    n3dc_obj_free(sequence->obj);
+    n3dc_obj_deallocate(allocator, sequence->position_indices);
+    n3dc_obj_deallocate(allocator, sequence);
+}
+
+const char* n3dc_obj_get_error_message(const n3dc_obj_error_code_t code)
+{
+    switch(code)
+    {
+        case N3DC_OBJ_ERROR_NONE: return "No error";
+        case N3DC_OBJ_ERROR_FILE: return "Could not open or read file";
+        case N3DC_OBJ_ERROR_OUT_OF_MEMORY: return "Could not allocate memory";
+        case N3DC_OBJ_ERROR_INVALID_OPTIONS: return "Invalid load options";
+        case N3DC_OBJ_ERROR_UNEXPECTED_END: return "Reached end of OBJ data in the middle of a line";
+        case N3DC_OBJ_ERROR_INVALID_CHARACTER: return "Invalid character in OBJ record";
+        case N3DC_OBJ_ERROR_MISSING_ELEMENT: return "OBJ record has too few elements";
+        case N3DC_OBJ_ERROR_INVALID_INDEX: return "OBJ index group has a missing or invalid index";
+        case N3DC_OBJ_ERROR_INDEX_OUT_OF_RANGE: return "OBJ face index is out of range";
+        case N3DC_OBJ_ERROR_TOO_MANY_VERTICES: return "Exceeded maximum number of vertices";
+        case N3DC_OBJ_ERROR_TOO_MANY_TEXTURE_COORDS: return "Exceeded maximum number of texture coords (max_indices)";
+        case N3DC_OBJ_ERROR_TOO_MANY_NORMALS: return "Exceeded maximum number of normals";
+        case N3DC_OBJ_ERROR_TOO_MANY_INDICES: return "Exceeded maximum number of indices";
+        case N3DC_OBJ_ERROR_BUFFER_TOO_SMALL: return "Interleaved buffer is too small for the vertices";
+        case N3DC_OBJ_ERROR_THREAD: return "Could not create thread or mutex";
+        default: return "Unknown error";
+    }
 }
 
 #endif // N3DC_OBJ_IMPLEMENTATION